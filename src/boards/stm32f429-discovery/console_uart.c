@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bsp/local/stm32f4/stm32f429_hw_usart.h"
+
+#include "hw/types.h"
+
+#include "kern/core/task.h"
+#include "kern/rpc/rpc.h"
+
+#include "core/lock.h"
+
+#include "console_uart_if.h"
+
+/*
+ * Console USART driver.
+ *
+ * This is the driver side of console_uart_if.h; the methods
+ * here are either called directly or by the server task,
+ * depending upon how the interface was built.
+ */
+
+KERN_RPC_SERVER(console_uart, CONSOLE_UART_RPC_METHODS)
+
+static uint8_t console_uart_stack[PLATFORM_DEFAULT_KERN_STACK_SIZE]
+	    __attribute__ ((aligned(PLATFORM_DEFAULT_KERN_STACK_ALIGNMENT)))
+	     = { 0 };
+
+/*
+ * Writes normally all come from the server task, but callers that
+ * can't sleep have them dispatched directly; this keeps those from
+ * interleaving with whatever the server is writing.
+ */
+static platform_spinlock_t console_uart_lock;
+
+uint32_t
+console_uart_putc(uint32_t c)
+{
+	stm32f429_uart_tx_byte(c);
+	return (0);
+}
+
+uint32_t
+console_uart_flush(void)
+{
+	stm32f429_uart_tx_flush();
+	return (0);
+}
+
+/*
+ * Write a string out, optionally doing LF->CRLF translation.
+ * The string belongs to the caller; this is a KERN_RPC_CALL so
+ * it stays valid until we're done with it.
+ */
+uint32_t
+console_uart_write(uint32_t s, uint32_t len, uint32_t crlf)
+{
+	const char *p = (const char *) (uintptr_t) s;
+	uint32_t i;
+
+	platform_spinlock_lock(&console_uart_lock);
+	for (i = 0; i < len; i++) {
+		if (crlf && p[i] == '\n')
+			stm32f429_uart_tx_byte('\r');
+		stm32f429_uart_tx_byte(p[i]);
+	}
+	platform_spinlock_unlock(&console_uart_lock);
+	return (0);
+}
+
+/**
+ * Start the console USART server task.
+ *
+ * This is only needed if the async stubs are being used.
+ */
+bool
+console_uart_server_start(void)
+{
+	if (console_uart_rpc_server.msgq != KERN_MSGQ_ID_NONE)
+		return (true);
+
+	platform_spinlock_init(&console_uart_lock);
+
+	/*
+	 * Run above the default priority so console output
+	 * drains ahead of the tasks generating it.
+	 */
+	return (kern_rpc_server_start(&console_uart_rpc_server,
+	    KERN_MSGQ_MAX_DEPTH, (stack_addr_t) console_uart_stack,
+	    sizeof(console_uart_stack), KERN_TASK_PRIORITY_DEFAULT + 1));
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+#ifndef	__BOARD_CONSOLE_UART_IF_H__
+#define	__BOARD_CONSOLE_UART_IF_H__
+
+#include "kern/rpc/rpc.h"
+
+/*
+ * Console USART driver interface.
+ *
+ * Build with -DCONSOLE_UART_RPC_ASYNC to have console output go via
+ * the console_uart server task rather than being written directly
+ * to the USART by the caller.  The console then uses write, which
+ * is called outside the console spinlock so the caller can sleep
+ * until the server has written the string out.
+ */
+#define	CONSOLE_UART_RPC_METHODS(METHOD)				\
+	METHOD(console_uart, 1, putc, 1, KERN_RPC_ONEWAY)		\
+	METHOD(console_uart, 2, flush, 0, KERN_RPC_CALL)		\
+	METHOD(console_uart, 3, write, 3, KERN_RPC_CALL)
+
+KERN_RPC_INTERFACE(console_uart, CONSOLE_UART_RPC_METHODS)
+
+#ifdef	CONSOLE_UART_RPC_ASYNC
+KERN_RPC_SELECT_ASYNC(CONSOLE_UART_RPC_METHODS)
+#else
+KERN_RPC_SELECT_DIRECT(CONSOLE_UART_RPC_METHODS)
+#endif
+
+extern	bool console_uart_server_start(void);
+
+#endif	/* __BOARD_CONSOLE_UART_IF_H__ */
@@ -29,14 +29,23 @@
 #include "bsp/local/stm32f4/stm32f429_hw_gpio.h"
 #include "bsp/local/stm32f4/stm32f429_hw_exti.h"
 #include "bsp/local/stm32f4/stm32f429_hw_syscfg.h"
+#include "bsp/local/stm32f4/stm32f429_hw_crc.h"
 
 #include "hw/types.h"
 
+#include "kern/libraries/crc32/crc32b.h"
+
 #include "kern/console/console.h"
 #include "kern/core/task.h"
 #include "kern/core/timer.h"
+#include "kern/core/info_page.h"
+#include "kern/core/futex.h"
 #include "kern/core/physmem.h"
+#include "kern/ipc/msgq.h"
+#include "kern/ipc/shm.h"
+#include "kern/ipc/ring.h"
 #include "kern/user/user_exec.h"
+#include "kern/user/user_spawn.h"
 
 /* flash resource */
 #include "kern/flash/flash_resource.h"
@@ -51,6 +60,8 @@
 #include "core/arm_m4_nvic.h"
 #include "core/arm_m4_mpu.h"
 
+#include "console_uart_if.h"
+
 flash_resource_span_t flash_span;
 
 extern uint32_t _estack, _ebss;
@@ -61,6 +72,9 @@ extern uint32_t _flash_resource_start;
 
 extern void setup_test_userland_task(void);
 extern void test_userload(void);
+extern void test_rpc_bench(void);
+extern void test_xip_bench(void);
+extern void test_syscall_bench(void);
 
 /* XXX */
 extern void arm_m4_task_switch();
@@ -72,18 +86,36 @@ extern void board_stm32f429i_discovery_fmc_init(void);
 static void
 cons_putc(char c)
 {
-	stm32f429_uart_tx_byte(c);
+	(void) console_uart_rpc_putc(c);
 }
 
 static void
 cons_flush(void)
 {
+	(void) console_uart_rpc_flush();
+}
+
+#ifdef	CONSOLE_UART_RPC_ASYNC
+/*
+ * With the async console this is called outside the console
+ * spinlock, so callers that can sleep actually hand their output
+ * to the console_uart server task rather than writing it
+ * themselves.
+ */
+static void
+cons_write(const char *s, size_t len, bool crlf)
+{
+	(void) console_uart_rpc_write((uintptr_t) s, len, crlf);
 }
+#endif
 
 /* Console ops for this platform */
 static struct console_ops c_ops = {
 	.putc_fn = cons_putc,
 	.flush_fn = cons_flush,
+#ifdef	CONSOLE_UART_RPC_ASYNC
+	.write_fn = cons_write,
+#endif
 };
 
 static void
@@ -262,9 +294,21 @@ main(void)
     // MPU init
     arm_m4_mpu_init();
 
+    /*
+     * CRC unit, used to verify the flash resources.  The driver
+     * serialises access itself and falls back to software when
+     * it's busy, so kern_crc32b() stays safe to call from anywhere.
+     */
+    stm32f429_hw_crc_init();
+    if (kern_crc32b_set_hw(stm32f429_hw_crc32b) == false) {
+        console_printf("[wtfos] CRC unit doesn't match software CRC;"
+            " not using it\n");
+    }
+
     // Flash resource init
     flash_resource_span_init(&flash_span, (uintptr_t) &_flash_resource_start,
        1048576);
+    user_spawn_init(&flash_span);
 
     /*
      * Physical memory region(s)
@@ -320,6 +364,7 @@ main(void)
      * ready to context switch.
      */
     kern_timer_init();
+    kern_info_page_init();
     kern_timer_set_tick_interval(100);
     arm_m4_systick_enable_interrupt(true);
 
@@ -327,15 +372,38 @@ main(void)
     // by the task / scheduler / timer code if we have any work to do.
     kern_timer_start();
 
+    /* Message queue IPC */
+    kern_msgq_init();
+    kern_shm_init();
+
+    /* Futex wait queues, for userland locks */
+    kern_futex_init();
+
     /* Setup task system, idle task; test tasks, etc but not run them */
     kern_task_setup();
 
+    /* Async syscall rings; starts the ring poller task */
+    kern_ring_init();
+
     /* Our (compiled in, not flash loaded) test userland task */
     setup_test_userland_task();
 
     /* Ok, let's try loading TEST.BIN */
     test_userload();
 
+#ifdef	CONSOLE_UART_RPC_ASYNC
+    /* Console output goes via the console USART server task */
+    (void) console_uart_server_start();
+
+    /*
+     * Driver RPC overhead benchmark; it needs the console server
+     * task and queue, so only run it when they're in use anyway.
+     */
+    test_rpc_bench();
+#endif
+    test_xip_bench();
+    test_syscall_bench();
+
     /* Ready to start context switching */
     kern_task_ready();
 
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "hw/types.h"
+
+#include "kern/console/console.h"
+#include "kern/core/task.h"
+#include "kern/rpc/rpc.h"
+
+#include "core/platform.h"
+
+#include "console_uart_if.h"
+
+/*
+ * Driver RPC benchmark.
+ *
+ * This measures the per-call cost of the direct and async
+ * (message queue + server task) stubs, both for a null method
+ * and for the console USART write method the console uses, so
+ * the right mode can be chosen per driver.
+ */
+
+#define	RPC_BENCH_ITERATIONS		256
+
+#define	RPC_BENCH_RPC_METHODS(METHOD)					\
+	METHOD(rpc_bench, 1, nop, 1, KERN_RPC_CALL)
+
+KERN_RPC_INTERFACE(rpc_bench, RPC_BENCH_RPC_METHODS)
+KERN_RPC_SERVER(rpc_bench, RPC_BENCH_RPC_METHODS)
+
+static struct kern_task rpc_bench_task;
+static uint8_t rpc_bench_stack[PLATFORM_DEFAULT_KERN_STACK_SIZE]
+	    __attribute__ ((aligned(PLATFORM_DEFAULT_KERN_STACK_ALIGNMENT)))
+	     = { 0 };
+static uint8_t rpc_bench_server_stack[PLATFORM_DEFAULT_KERN_STACK_SIZE]
+	    __attribute__ ((aligned(PLATFORM_DEFAULT_KERN_STACK_ALIGNMENT)))
+	     = { 0 };
+
+uint32_t
+rpc_bench_nop(uint32_t a0)
+{
+	return (a0);
+}
+
+static void
+rpc_bench_report(const char *name, uint32_t direct, uint32_t async)
+{
+	console_printf("[rpc_bench] %s: direct %u cycles/call,"
+	    " async %u cycles/call\n", name,
+	    direct / RPC_BENCH_ITERATIONS, async / RPC_BENCH_ITERATIONS);
+}
+
+static void
+rpc_bench_task_fn(void *arg)
+{
+	uint32_t start, direct, async;
+	uint32_t i;
+
+	start = platform_cpu_cycle_count();
+	for (i = 0; i < RPC_BENCH_ITERATIONS; i++)
+		(void) rpc_bench_direct_nop(i);
+	direct = platform_cpu_cycle_count() - start;
+
+	start = platform_cpu_cycle_count();
+	for (i = 0; i < RPC_BENCH_ITERATIONS; i++)
+		(void) rpc_bench_async_nop(i);
+	async = platform_cpu_cycle_count() - start;
+
+	rpc_bench_report("nop", direct, async);
+
+	/*
+	 * The console's own path: an empty write costs just the
+	 * transport, so this doesn't spam the console.
+	 */
+	start = platform_cpu_cycle_count();
+	for (i = 0; i < RPC_BENCH_ITERATIONS; i++)
+		(void) console_uart_direct_write((uintptr_t) "", 0, 0);
+	direct = platform_cpu_cycle_count() - start;
+
+	start = platform_cpu_cycle_count();
+	for (i = 0; i < RPC_BENCH_ITERATIONS; i++)
+		(void) console_uart_async_write((uintptr_t) "", 0, 0);
+	async = platform_cpu_cycle_count() - start;
+
+	rpc_bench_report("console_uart write", direct, async);
+
+	console_printf("[rpc_bench] rpc_bench server: %u calls, %u direct\n",
+	    rpc_bench_rpc_server.calls, rpc_bench_rpc_server.direct);
+
+	kern_task_exit();
+}
+
+void
+test_rpc_bench(void)
+{
+
+	(void) console_uart_server_start();
+	(void) kern_rpc_server_start(&rpc_bench_rpc_server, 4,
+	    (stack_addr_t) rpc_bench_server_stack,
+	    sizeof(rpc_bench_server_stack), KERN_TASK_PRIORITY_DEFAULT);
+
+	kern_task_init(&rpc_bench_task, rpc_bench_task_fn, NULL, "rpc_bench",
+	    (stack_addr_t) rpc_bench_stack, sizeof(rpc_bench_stack), 0);
+	kern_task_start(&rpc_bench_task);
+}
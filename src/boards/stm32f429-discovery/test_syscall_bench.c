@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "hw/types.h"
+
+#include "kern/console/console.h"
+#include "kern/core/task.h"
+#include "kern/core/task_mem.h"
+#include "kern/core/timer.h"
+#include "kern/core/physmem.h"
+#include "kern/core/malloc.h"
+
+#include "core/platform.h"
+
+#include "user/include/wtf_syscall.h"
+#include "user/include/wtf_info.h"
+
+/*
+ * Syscall round trip benchmark.
+ *
+ * This runs a compiled in user task which times a batch of slow path
+ * (thread mode trampoline) no-op syscalls against the same number of
+ * handler mode fast path ones, and both against reading the time
+ * from the kernel info page, using the fast cycle counter syscall
+ * since userland can't read the DWT.  The task can't touch kernel
+ * memory so it formats and prints its own results, then exits.
+ */
+
+#define	SYSCALL_BENCH_ITERATIONS	1024
+
+/*
+ * Append a string / unsigned decimal to buf, returning the new
+ * end.  There's no room checking; the caller sizes buf.
+ */
+static char *
+syscall_bench_str(char *p, const char *str)
+{
+	while (*str != '\0')
+		*p++ = *str++;
+	return (p);
+}
+
+static char *
+syscall_bench_uint(char *p, uint32_t val)
+{
+	char tmp[10];
+	int i = 0;
+
+	do {
+		tmp[i++] = '0' + (val % 10);
+		val /= 10;
+	} while (val != 0);
+	while (i > 0)
+		*p++ = tmp[--i];
+	return (p);
+}
+
+static void
+syscall_bench_task(void *arg)
+{
+	uint32_t start, overhead, slow, fast, info, i;
+	wtf_info_page_t *ip;
+	volatile uint32_t tick;
+	char buf[160], *p;
+
+	ip = wtf_info_page();
+
+	/* Cost of reading the cycle counter itself */
+	start = WTF_SYSCALL(WTF_SYSCALL_FAST_GET_CYCLES, 0, 0, 0, 0);
+	overhead = WTF_SYSCALL(WTF_SYSCALL_FAST_GET_CYCLES, 0, 0, 0, 0) -
+	    start;
+
+	start = WTF_SYSCALL(WTF_SYSCALL_FAST_GET_CYCLES, 0, 0, 0, 0);
+	for (i = 0; i < SYSCALL_BENCH_ITERATIONS; i++)
+		(void) WTF_SYSCALL(WTF_SYSCALL_NOP, 0, 0, 0, 0);
+	slow = WTF_SYSCALL(WTF_SYSCALL_FAST_GET_CYCLES, 0, 0, 0, 0) - start -
+	    overhead;
+
+	start = WTF_SYSCALL(WTF_SYSCALL_FAST_GET_CYCLES, 0, 0, 0, 0);
+	for (i = 0; i < SYSCALL_BENCH_ITERATIONS; i++)
+		(void) WTF_SYSCALL(WTF_SYSCALL_FAST_NOP, 0, 0, 0, 0);
+	fast = WTF_SYSCALL(WTF_SYSCALL_FAST_GET_CYCLES, 0, 0, 0, 0) - start -
+	    overhead;
+
+	start = WTF_SYSCALL(WTF_SYSCALL_FAST_GET_CYCLES, 0, 0, 0, 0);
+	for (i = 0; i < SYSCALL_BENCH_ITERATIONS; i++)
+		tick = wtf_info_tick_msec(ip);
+	info = WTF_SYSCALL(WTF_SYSCALL_FAST_GET_CYCLES, 0, 0, 0, 0) - start -
+	    overhead;
+	(void) tick;
+
+	p = syscall_bench_str(buf, "[syscall_bench] ");
+	p = syscall_bench_uint(p, SYSCALL_BENCH_ITERATIONS);
+	p = syscall_bench_str(p, " calls: slow path ");
+	p = syscall_bench_uint(p, slow / SYSCALL_BENCH_ITERATIONS);
+	p = syscall_bench_str(p, " cycles/call, fast path ");
+	p = syscall_bench_uint(p, fast / SYSCALL_BENCH_ITERATIONS);
+	p = syscall_bench_str(p, " cycles/call, info page time read ");
+	p = syscall_bench_uint(p, info / SYSCALL_BENCH_ITERATIONS);
+	p = syscall_bench_str(p, " cycles\r\n");
+
+	(void) WTF_SYSCALL(WTF_SYSCALL_CONSOLE_WRITE, (uintptr_t) buf,
+	    p - buf, 0, 0);
+	(void) WTF_SYSCALL(WTF_SYSCALL_TASK_EXIT, 0, 0, 0, 0);
+}
+
+void
+test_syscall_bench(void)
+{
+	paddr_t kern_stack, user_stack;
+	struct kern_task *task;
+	struct task_mem tm;
+
+	kern_stack = kern_physmem_alloc(PLATFORM_DEFAULT_KERN_STACK_SIZE,
+	    PLATFORM_DEFAULT_KERN_STACK_ALIGNMENT,
+	    KERN_PHYSMEM_ALLOC_FLAG_ZERO);
+	user_stack = kern_physmem_alloc(512, 512, KERN_PHYSMEM_ALLOC_FLAG_ZERO);
+	task = kern_malloc(sizeof(struct kern_task), 4);
+	if (kern_stack == 0 || user_stack == 0 || task == NULL) {
+		console_printf("[syscall_bench] couldn't allocate task\n");
+		if (kern_stack != 0)
+			kern_physmem_free(kern_stack);
+		if (user_stack != 0)
+			kern_physmem_free(user_stack);
+		if (task != NULL)
+			kern_free(task);
+		return;
+	}
+
+	kern_task_mem_init(&tm);
+	kern_task_mem_set(&tm, TASK_MEM_ID_TEXT,
+	    0x08000000, 0x200000, false);
+	kern_task_mem_set(&tm, TASK_MEM_ID_KERN_STACK,
+	    kern_stack, PLATFORM_DEFAULT_KERN_STACK_SIZE, true);
+	kern_task_mem_set(&tm, TASK_MEM_ID_USER_STACK,
+	    user_stack, 512, true);
+
+	kern_task_user_init(task, (paddr_t) syscall_bench_task,
+	    0, 0, "syscall_bench", &tm,
+	    TASK_FLAGS_DYNAMIC_STRUCT | TASK_FLAGS_ENABLE_MPU);
+	kern_task_start(task);
+}
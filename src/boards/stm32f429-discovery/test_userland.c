@@ -32,16 +32,7 @@
 
 #include "core/platform.h"
 
-/*
- * I'm not yet sure how I return a value here; it's quite possible
- * I need to commit some more naked inline assembly sins to get everything
- * lined up right.
- */
-static __attribute__((noinline)) void
-syscall_test(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4)
-{
-	asm("svc #0x01");
-}
+#include "user/include/wtf_syscall.h"
 
 /**
  * Until we can do SVC's, all we can really do here is spin!
@@ -58,18 +49,18 @@ kern_test_user_task(void *arg)
 		 * Test invalid syscall; for now just for doing diagnostics, it doesn't
 		 * error out at all.
 		 */
-		syscall_test(0x12345678, 0x13579bdf, 0x2468ace0, 0x39647afb);
+		(void) WTF_SYSCALL(0xff, 0x12345678, 0x13579bdf, 0x2468ace0,
+		    0x39647afb);
 
-		/* CONSOLE_WRITE syscall */
-		syscall_test(0x00000001, (uintptr_t) ((count & 1) ? teststr_1 : teststr_2), 16, 0);
+		(void) WTF_SYSCALL(WTF_SYSCALL_CONSOLE_WRITE,
+		    (uintptr_t) ((count & 1) ? teststr_1 : teststr_2), 16, 0, 0);
 
-		/* TIMER_SLEEP syscall, 1 sec */
-		syscall_test(0x00000002, 1000, 0, 0);
+		/* 1 sec */
+		(void) WTF_SYSCALL(WTF_SYSCALL_SLEEP, 1000, 0, 0, 0);
 		count++;
 	}
 
-	/* TASK_EXIT syscall */
-	syscall_test(0x00000004, 0, 0, 0);
+	(void) WTF_SYSCALL(WTF_SYSCALL_TASK_EXIT, 0, 0, 0, 0);
 }
 
 void
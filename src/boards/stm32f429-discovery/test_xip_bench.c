@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "hw/types.h"
+
+#include "kern/console/console.h"
+#include "kern/libraries/mem/mem.h"
+#include "kern/core/physmem.h"
+
+#include "core/platform.h"
+
+/*
+ * XIP vs run-from-RAM benchmark.
+ *
+ * This runs the same hot loop from flash and from an SRAM copy and
+ * reports cycles per iteration, so we can tell whether loading a
+ * user program into RAM is worth the memory.  The loop is
+ * hand-written so it's position independent and can just be copied;
+ * its body is long enough to span several flash lines.
+ */
+
+#define	XIP_BENCH_ITERATIONS		4096
+#define	XIP_BENCH_CODE_SIZE		64
+
+typedef void xip_bench_fn_t(uint32_t n);
+
+static void __attribute__((naked, noinline))
+xip_bench_loop(uint32_t n)
+{
+	__asm__ volatile (
+	    "1:\n"
+	    "	adds r1, r1, r0\n"
+	    "	eors r2, r2, r1\n"
+	    "	adds r3, r3, r2\n"
+	    "	eors r1, r1, r3\n"
+	    "	adds r2, r2, r1\n"
+	    "	eors r3, r3, r2\n"
+	    "	adds r1, r1, r3\n"
+	    "	eors r2, r2, r1\n"
+	    "	adds r3, r3, r1\n"
+	    "	eors r1, r1, r2\n"
+	    "	adds r2, r2, r3\n"
+	    "	eors r3, r3, r1\n"
+	    "	adds r1, r1, r2\n"
+	    "	eors r2, r2, r3\n"
+	    "	adds r3, r3, r1\n"
+	    "	eors r1, r1, r2\n"
+	    "	subs r0, r0, #1\n"
+	    "	bne 1b\n"
+	    "	bx lr\n");
+}
+
+static uint32_t
+xip_bench_run(xip_bench_fn_t *fn)
+{
+	uint32_t start;
+
+	start = platform_cpu_cycle_count();
+	fn(XIP_BENCH_ITERATIONS);
+	return (platform_cpu_cycle_count() - start);
+}
+
+void
+test_xip_bench(void)
+{
+	xip_bench_fn_t *ram_fn;
+	uint32_t xip, ram;
+	uintptr_t src;
+	paddr_t buf;
+
+	buf = kern_physmem_alloc(XIP_BENCH_CODE_SIZE, 32, 0);
+	if (buf == 0) {
+		console_printf("[xip_bench] couldn't allocate RAM\n");
+		return;
+	}
+
+	/* Thumb function pointers have bit 0 set; the code doesn't */
+	src = ((uintptr_t) xip_bench_loop) & ~1;
+	kern_memcpy((void *) buf, (const void *) src, XIP_BENCH_CODE_SIZE);
+	__asm__ volatile ("dsb\n\tisb\n" ::: "memory");
+	ram_fn = (xip_bench_fn_t *) (buf | 1);
+
+	/* Warm the flash accelerator / caches first */
+	(void) xip_bench_run(xip_bench_loop);
+	xip = xip_bench_run(xip_bench_loop);
+	ram = xip_bench_run(ram_fn);
+
+	console_printf("[xip_bench] %u iterations: XIP %u cycles (%u/iter),"
+	    " RAM %u cycles (%u/iter)\n", XIP_BENCH_ITERATIONS,
+	    xip, xip / XIP_BENCH_ITERATIONS,
+	    ram, ram / XIP_BENCH_ITERATIONS);
+
+	kern_physmem_free(buf);
+}
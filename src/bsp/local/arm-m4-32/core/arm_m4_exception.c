@@ -8,6 +8,7 @@
 
 #include <kern/console/console.h>
 #include <kern/core/exception.h>
+#include <kern/core/task.h>
 #include <kern/syscalls/syscall.h>
 
 /**
@@ -94,11 +95,35 @@ arm_m4_exception_set_pendsv(void)
 
 /**
  * Syscall entry point from arm_m4_svc.S.
+ *
+ * The SVC handler stashed the SVC immediate (the syscall id) in the
+ * task; the 64 bit return value goes back to userland in r0/r1.
  */
-uint32_t
+uint64_t
 arm_m4_c_syscall_handler(uint32_t arg1, uint32_t arg2, uint32_t arg3,
     uint32_t arg4)
 {
 
-	return (kern_syscall_handler(arg1, arg2, arg3, arg4));
+	return (kern_syscall_handler(current_task->syscall_id, arg1, arg2,
+	    arg3, arg4));
+}
+
+/**
+ * Fast syscall entry point from arm_m4_svc.S.
+ *
+ * This runs in handler mode on the main stack, straight from the
+ * SVC exception.  frame is the exception stack frame (r0, r1, r2,
+ * r3, r12, lr, pc, xpsr); the arguments are read from it and the
+ * return value written back into the stacked r0/r1, which the
+ * exception return then restores.
+ */
+void
+arm_m4_c_fast_syscall_handler(uint32_t *frame, uint32_t syscall_id)
+{
+	syscall_retval_t ret;
+
+	ret = kern_syscall_fast_handler(syscall_id, frame[0], frame[1],
+	    frame[2], frame[3]);
+	frame[0] = (uint32_t) ret;
+	frame[1] = (uint32_t) (ret >> 32);
 }
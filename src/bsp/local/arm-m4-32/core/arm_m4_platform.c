@@ -13,6 +13,7 @@
 #include <hw/types.h>
 #include <hw/scb_defs.h>
 #include <hw/arm_mpu_defs.h>
+#include <hw/arm_dwt_defs.h>
 #include <asm/asm_defs.h>
 
 #include <kern/console/console.h>
@@ -54,6 +55,46 @@ platform_cpu_init(void)
 	val |= ARM_M4_SCB_REG_FPCCR_LSPEN;
 	val |= ARM_M4_SCB_REG_FPCCR_ASPEN;
 	os_reg_write32(ARM_M4_SCB_REG_BASE, ARM_M4_SCB_REG_FPCCR, val);
+
+	/* Enable the DWT cycle counter for timestamps / profiling */
+	val = os_reg_read32(ARM_DEBUG_BASE, ARM_DEBUG_REG_DEMCR);
+	val |= ARM_DEBUG_REG_DEMCR_TRCENA;
+	os_reg_write32(ARM_DEBUG_BASE, ARM_DEBUG_REG_DEMCR, val);
+
+	val = os_reg_read32(ARM_DWT_BASE, ARM_DWT_REG_CTRL);
+	if ((val & ARM_DWT_REG_CTRL_NOCYCCNT) == 0) {
+		os_reg_write32(ARM_DWT_BASE, ARM_DWT_REG_CYCCNT, 0);
+		val |= ARM_DWT_REG_CTRL_CYCCNTENA;
+		os_reg_write32(ARM_DWT_BASE, ARM_DWT_REG_CTRL, val);
+	} else {
+		console_printf("%s: no DWT cycle counter!\n", __func__);
+	}
+}
+
+/**
+ * Return the free running CPU cycle counter.
+ *
+ * This wraps every 2^32 cycles (about 24 seconds at 180MHz) so
+ * it's only useful for measuring short intervals.
+ */
+uint32_t
+platform_cpu_cycle_count(void)
+{
+
+	return (os_reg_read32(ARM_DWT_BASE, ARM_DWT_REG_CYCCNT));
+}
+
+/**
+ * Return the rate platform_cpu_cycle_count() counts at, in Hz.
+ *
+ * The DWT cycle counter runs off the core clock (HCLK.)  This
+ * returns 0 until the board code has told systick what that is.
+ */
+uint32_t
+platform_cpu_cycle_freq(void)
+{
+
+	return (arm_m4_systick_get_hclk_freq());
 }
 
 /**
@@ -196,7 +237,7 @@ platform_task_stack_setup(stack_addr_t stack, void *entry_point, void *param,
 	ps--;
 	*ps = ((kern_code_exec_addr_t) exit_func) & 0xffffffffe;;		// LR
 	ps = ps - 5;	/* skip r12, r3, r3, r1 */
-	*ps = ((kern_code_exec_addr_t) entry_point); // r0
+	*ps = ((kern_code_exec_addr_t) param); // r0
 	ps--;
 	*ps = MODE_THREAD_PSP;		// INITIAL EXC_RETURN
 	ps--;
@@ -221,6 +262,20 @@ platform_task_stack_setup(stack_addr_t stack, void *entry_point, void *param,
 	return (stack_addr_t) (ps);
 }
 
+/**
+ * Return whether the caller is able to sleep.
+ *
+ * Sleeping isn't possible from an exception handler or with
+ * interrupts disabled (eg with a spinlock held) as the PendSV
+ * context switch can't run.
+ */
+bool
+platform_cpu_can_sleep(void)
+{
+
+	return ((get_ipsr() == 0) && (get_primask() == 0));
+}
+
 /**
  * Kick off a context switch, either now or soon.
  *
@@ -289,6 +344,90 @@ platform_mpu_table_init(platform_mpu_phys_entry_t *table)
 	}
 }
 
+/*
+ * Calculate the MPU region for a block of the given size.
+ *
+ * Power of two sizes map directly onto a region.  Other sizes use
+ * the next power of two region with the trailing subregions
+ * disabled, so the size must be a whole number of subregions
+ * (1/8th of the region) and the region must be at least
+ * ARM_M4_MPU_MIN_SRD_REGION_SIZE.
+ *
+ * @param[in] size block size
+ * @param[out] sf RASR size field
+ * @param[out] srd RASR subregion disable bits
+ * @param[out] region_size size of the whole region, which is also
+ *   the required base address alignment
+ * @retval true if the size can be represented, false otherwise
+ */
+static bool
+arm_m4_mpu_region_calc(uint32_t size, int *sf, uint32_t *srd,
+    uint32_t *region_size)
+{
+	uint32_t rs, sub;
+	int i;
+
+	if (size < ARM_M4_MPU_MIN_REGION_SIZE)
+		return (false);
+
+	for (i = 4; i < 31; i++) {
+		if ((1U << (i + 1)) >= size)
+			break;
+	}
+	if (i == 31)
+		return (false);
+
+	rs = 1U << (i + 1);
+	*sf = i;
+	*region_size = rs;
+	*srd = 0;
+
+	if (rs == size)
+		return (true);
+
+	if (rs < ARM_M4_MPU_MIN_SRD_REGION_SIZE)
+		return (false);
+	sub = rs / ARM_M4_MPU_NUM_SUBREGIONS;
+	if ((size % sub) != 0)
+		return (false);
+
+	/* Disable the subregions past the end of the block */
+	*srd = (0xff << (size / sub)) & 0xff;
+	return (true);
+}
+
+/**
+ * Calculate the size and alignment to allocate for an MPU region
+ * holding 'len' bytes.
+ *
+ * The size is rounded up to a whole number of subregions, rather
+ * than to the next power of two, so only the enabled subregions
+ * need to be allocated.  The alignment is that of the enclosing
+ * power of two region.
+ *
+ * @param[in] len number of bytes needed
+ * @param[out] size number of bytes to allocate
+ * @param[out] alignment alignment to allocate at
+ */
+void
+platform_mpu_region_size_calc(uint32_t len, uint32_t *size,
+    uint32_t *alignment)
+{
+	uint32_t rs, sub;
+
+	rs = ARM_M4_MPU_MIN_REGION_SIZE;
+	while (rs < len && rs < 0x80000000)
+		rs <<= 1;
+
+	*alignment = rs;
+	if (rs < ARM_M4_MPU_MIN_SRD_REGION_SIZE) {
+		*size = rs;
+		return;
+	}
+	sub = rs / ARM_M4_MPU_NUM_SUBREGIONS;
+	*size = ((len + sub - 1) / sub) * sub;
+}
+
 /**
  * Validate if the given base address, size and protection field are valid.
  *
@@ -303,30 +442,17 @@ bool
 platform_mpu_table_entry_validate(uint32_t base_addr, uint32_t size,
     platform_prot_type_t prot)
 {
-	int i, sf = 0;
-	uint32_t mask;
+	uint32_t mask, srd, region_size;
+	int sf;
 
-	/* minimum size */
-	if (size < ARM_M4_MPU_MIN_REGION_SIZE) {
+	/* find the right size / subregions */
+	if (arm_m4_mpu_region_calc(size, &sf, &srd, &region_size) == false) {
 		console_printf("%s: invalid size (%d)!\n", __func__, size);
 		return (false);
 	}
 
-	/* find the right size */
-	for (i = 4; i < 31; i++) {
-		if (1 << (i+1) == size) {
-			sf = i;
-			break;
-		}
-	}
-
-	/* not valid? whoops */
-	if (sf == 0) {
-		return (false);
-	}
-
 	/* calculate address mask */
-	mask = (1 << (sf + 1)) - 1;
+	mask = region_size - 1;
 
 	/* check! */
 	if ((base_addr & mask) != 0) {
@@ -350,8 +476,8 @@ bool
 platform_mpu_table_set(platform_mpu_phys_entry_t *e, uint32_t base_addr,
     uint32_t size, platform_prot_type_t prot)
 {
-	int i, sf = 0;
-	uint32_t mask, rasr_reg;
+	uint32_t mask, rasr_reg, srd, region_size;
+	int sf;
 
 	/* none? mark it blank */
 	if (prot == PLATFORM_PROT_TYPE_NONE) {
@@ -360,27 +486,17 @@ platform_mpu_table_set(platform_mpu_phys_entry_t *e, uint32_t base_addr,
 		return (true);
 	}
 
-	/* minimum size */
-	if (size < ARM_M4_MPU_MIN_REGION_SIZE) {
+	/*
+	 * find the right size; non power of two sizes use a larger
+	 * region with the trailing subregions disabled.
+	 */
+	if (arm_m4_mpu_region_calc(size, &sf, &srd, &region_size) == false) {
 		console_printf("%s: invalid size (%d)!\n", __func__, size);
 		return (false);
 	}
 
-	/* find the right size */
-	for (i = 4; i < 31; i++) {
-		if (1 << (i+1) == size) {
-			sf = i;
-			break;
-		}
-	}
-
-	/* not valid? whoops */
-	if (sf == 0) {
-		return (false);
-	}
-
 	/* calculate address mask */
-	mask = (1 << (sf + 1)) - 1;
+	mask = region_size - 1;
 
 	/* check! */
 	if ((base_addr & mask) != 0) {
@@ -393,7 +509,7 @@ platform_mpu_table_set(platform_mpu_phys_entry_t *e, uint32_t base_addr,
 	/* generate rasr - yeah, this should be a table, done at compile time */
 	rasr_reg = 0;
 	rasr_reg |= RMW(rasr_reg, ARM_M4_MPU_REG_RSAR_SIZE, sf);
-	rasr_reg |= RMW(rasr_reg, ARM_M4_MPU_REG_RSAR_SRD, 0);
+	rasr_reg |= RMW(rasr_reg, ARM_M4_MPU_REG_RSAR_SRD, srd);
 	rasr_reg |= ARM_M4_MPU_REG_RSAR_ENABLE;
 	switch (prot) {
 	case PLATFORM_PROT_TYPE_EXEC_RO:
@@ -424,12 +540,12 @@ platform_mpu_table_set(platform_mpu_phys_entry_t *e, uint32_t base_addr,
 	}
 
 	/* debug! */
-	console_printf("%s: addr=0x%x, size=%d, mask=0x%x, sf=%d, rasr_reg=0x%08x\n",
+	console_printf("%s: addr=0x%x, size=%d, mask=0x%x, sf=%d, srd=0x%02x, rasr_reg=0x%08x\n",
 	    __func__,
 	    base_addr,
 	    size,
 	    mask,
-	    sf, rasr_reg);
+	    sf, srd, rasr_reg);
 
 	e->base_reg = base_addr;
 	e->rasr_reg = rasr_reg;
@@ -130,3 +130,9 @@ arm_m4_systick_set_hclk_freq(uint32_t hclk_freq)
 {
 	systick_hclk_freq = hclk_freq;
 }
+
+uint32_t
+arm_m4_systick_get_hclk_freq(void)
+{
+	return (systick_hclk_freq);
+}
@@ -10,5 +10,6 @@ extern	void arm_m4_systick_stop_counting(void);
 extern	uint32_t arm_m4_systick_get_tenms_calib(void);
 
 extern	void arm_m4_systick_set_hclk_freq(uint32_t hclk_freq);
+extern	uint32_t arm_m4_systick_get_hclk_freq(void);
 
 #endif	/* __ARM_M4_SYSTICK_H__ */
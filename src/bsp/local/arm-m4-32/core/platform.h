@@ -7,6 +7,9 @@
 
 extern	void platform_cpu_init(void);
 extern	void platform_cpu_idle(void);
+extern	uint32_t platform_cpu_cycle_count(void);
+extern	uint32_t platform_cpu_cycle_freq(void);
+extern	bool platform_cpu_can_sleep(void);
 
 extern	void platform_irq_enable(uint32_t irq);
 extern	void platform_irq_disable(uint32_t irq);
@@ -40,5 +43,7 @@ extern	bool platform_mpu_table_set(platform_mpu_phys_entry_t *table,
 	    uint32_t addr, uint32_t size, platform_prot_type_t prot_type);
 extern	void platform_mpu_table_program(const platform_mpu_phys_entry_t *table);
 extern	uint32_t platform_mpu_table_min_region_size(void);
+extern	void platform_mpu_region_size_calc(uint32_t len, uint32_t *size,
+	    uint32_t *alignment);
 
 #endif	/* __ARM_M4_PLATFORM_H__ */
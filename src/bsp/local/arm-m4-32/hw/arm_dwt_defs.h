@@ -0,0 +1,26 @@
+#ifndef	__ARM_DWT_DEFS_H__
+#define	__ARM_DWT_DEFS_H__
+
+#include <os/bit.h>
+
+/*
+ * Data watchpoint and trace unit; only the cycle counter is used.
+ */
+#define	ARM_DWT_BASE			0xe0001000
+
+#define	ARM_DWT_REG_CTRL				0x000
+#define		ARM_DWT_REG_CTRL_CYCCNTENA		BIT_U32(0)
+#define		ARM_DWT_REG_CTRL_NOCYCCNT		BIT_U32(25)
+
+#define	ARM_DWT_REG_CYCCNT				0x004
+
+/*
+ * The DWT block needs enabling via TRCENA in the debug exception
+ * and monitor control register before it can be used.
+ */
+#define	ARM_DEBUG_BASE			0xe000edf0
+
+#define	ARM_DEBUG_REG_DEMCR				0x00c
+#define		ARM_DEBUG_REG_DEMCR_TRCENA		BIT_U32(24)
+
+#endif	/* __ARM_DWT_DEFS_H__ */
@@ -23,6 +23,9 @@
 #define	ARM_M4_MPU_BASE			0xe000ed90
 
 #define	ARM_M4_MPU_MIN_REGION_SIZE		32
+/* Subregions (SRD) can only be used on regions of at least this size */
+#define	ARM_M4_MPU_MIN_SRD_REGION_SIZE		256
+#define	ARM_M4_MPU_NUM_SUBREGIONS		8
 
 #define	ARM_M4_MPU_REG_TYPE		0x0000
 #define		ARM_M4_MPU_REG_TYPE_SEPARATE		BIT_U32(0)
@@ -46,8 +46,8 @@ typedef uint32_t irq_save_t;
 /* syscall arg field (eg if registers) */
 typedef uint32_t syscall_arg_t;
 
-/* syscall return value field (eg if registers) */
-typedef uint32_t syscall_retval_t;
+/* syscall return value field (r0/r1) */
+typedef uint64_t syscall_retval_t;
 
 /* individual MPU entry field, since for now I only care about MPU, not MMU */
 typedef struct {
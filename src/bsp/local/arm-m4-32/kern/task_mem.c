@@ -35,6 +35,7 @@
 #include <kern/core/malloc.h>
 #include <kern/core/logging.h>
 #include <kern/core/physmem.h>
+#include <kern/core/info_page.h>
 #include <kern/console/console.h>
 
 #include <core/platform.h>
@@ -117,9 +118,14 @@ kern_task_mem_cleanup(struct task_mem *tm)
  * Yes, this is hard-coded and very specific to the cortex-M4;
  * chances are it should be migrated into the platform code.
  *
- * TODO: combine the RW and RO segments together when doing
- * physmem allocation and then save on the slots being used
- * here!
+ * Tasks with a user arena use two slots for all of their RAM -
+ * the arena itself read/write, and the GOT at the start of it
+ * read-only.  The GOT slot is numbered higher so it takes
+ * priority over the arena slot.  A shared library's text gets
+ * slot 3 (its per-task RAM lives in the arena.)  Tasks without an
+ * arena get one slot per segment.
+ *
+ * Every task gets the kernel info page read-only in slot 7.
  */
 bool
 kern_task_mem_setup_mpu(struct kern_task *task)
@@ -140,6 +146,46 @@ kern_task_mem_setup_mpu(struct kern_task *task)
 	platform_mpu_table_set(&task->mpu_phys_table[0],
 	    addr, size, PLATFORM_PROT_TYPE_EXEC_RO);
 
+	/* Kernel info page */
+	if (platform_mpu_table_set(&task->mpu_phys_table[7],
+	    kern_info_page_addr(), KERN_INFO_PAGE_SIZE,
+	    PLATFORM_PROT_TYPE_NOEXEC_RO) == false)
+		return (false);
+
+	if (kern_task_mem_get_size(&task->task_mem,
+	    TASK_MEM_ID_USER_ARENA) != 0) {
+		/* User arena - stack, data, bss, heap */
+		addr = kern_task_mem_get_start(&task->task_mem,
+		    TASK_MEM_ID_USER_ARENA);
+		size = kern_task_mem_get_size(&task->task_mem,
+		    TASK_MEM_ID_USER_ARENA);
+		if (platform_mpu_table_set(&task->mpu_phys_table[1],
+		    addr, size, PLATFORM_PROT_TYPE_NOEXEC_RW) == false)
+			return (false);
+
+		/* task GOT, read-only overlay over the arena */
+		addr = kern_task_mem_get_start(&task->task_mem,
+		    TASK_MEM_ID_USER_GOT);
+		size = kern_task_mem_get_size(&task->task_mem,
+		    TASK_MEM_ID_USER_GOT);
+		if (platform_mpu_table_set(&task->mpu_phys_table[2],
+		    addr, size, PLATFORM_PROT_TYPE_NOEXEC_RO) == false)
+			return (false);
+
+		/* Shared library text, if any */
+		size = kern_task_mem_get_size(&task->task_mem,
+		    TASK_MEM_ID_LIB_TEXT);
+		if (size != 0) {
+			addr = kern_task_mem_get_start(&task->task_mem,
+			    TASK_MEM_ID_LIB_TEXT);
+			if (platform_mpu_table_set(&task->mpu_phys_table[3],
+			    addr, size, PLATFORM_PROT_TYPE_EXEC_RO) == false)
+				return (false);
+		}
+
+		return (true);
+	}
+
 	/* User stack */
 	addr = kern_task_mem_get_start(&task->task_mem, TASK_MEM_ID_USER_STACK);
 	size = kern_task_mem_get_size(&task->task_mem, TASK_MEM_ID_USER_STACK);
@@ -171,6 +217,121 @@ kern_task_mem_setup_mpu(struct kern_task *task)
 	return (true);
 }
 
+/*
+ * MPU slots which may be available for dynamic mappings (eg shared
+ * memory.)  kern_task_mem_setup_mpu() uses slot 3 for the shared
+ * library text of arena tasks and for the GOT of tasks without an
+ * arena, and slot 6 for the bss of tasks without an arena; slots
+ * already in use are skipped.  Slot 7 is always the kernel info page.
+ */
+static const uint8_t kern_task_mem_mpu_dynamic_slots[] = { 3, 4, 5, 6 };
+
+/**
+ * Map an extra region into a task's MPU table.
+ *
+ * The region must already be MPU compatible: a power of two size,
+ * or a whole number of subregions of the next power of two up, and
+ * aligned to that power of two (see platform_mpu_region_size_calc().)
+ * If the task is currently running then the MPU is reprogrammed
+ * immediately.
+ *
+ * Tasks that don't use the MPU can already see all of memory, so
+ * for those this succeeds without using a slot.
+ *
+ * @param[in] task task to map into
+ * @param[in] addr region physical address
+ * @param[in] size region size
+ * @param[in] prot protection type
+ * @param[out] slot MPU slot used, or -1 if none was needed
+ * @retval true if mapped, false if no slot was free or the region
+ *   isn't MPU compatible
+ */
+bool
+kern_task_mem_mpu_map(struct kern_task *task, paddr_t addr,
+    paddr_size_t size, platform_prot_type_t prot, int *slot)
+{
+	platform_mpu_phys_entry_t *e;
+	bool ret = false;
+	int i;
+
+	*slot = -1;
+	if ((task->task_flags & TASK_FLAGS_ENABLE_MPU) == 0)
+		return (true);
+
+	kern_task_lock();
+	for (i = 0; i < (int) sizeof(kern_task_mem_mpu_dynamic_slots); i++) {
+		e = &task->mpu_phys_table[kern_task_mem_mpu_dynamic_slots[i]];
+		if (e->rasr_reg != 0)
+			continue;
+		ret = platform_mpu_table_set(e, addr, size, prot);
+		if (ret == true)
+			*slot = kern_task_mem_mpu_dynamic_slots[i];
+		break;
+	}
+	if (ret == true && task == current_task)
+		platform_mpu_table_program(&task->mpu_phys_table[0]);
+	kern_task_unlock();
+
+	return (ret);
+}
+
+/**
+ * Unmap a region previously mapped with kern_task_mem_mpu_map().
+ *
+ * @param[in] task task to unmap from
+ * @param[in] slot MPU slot returned from kern_task_mem_mpu_map()
+ */
+void
+kern_task_mem_mpu_unmap(struct kern_task *task, int slot)
+{
+	if (slot < 0 || slot >= PLATFORM_MPU_PHYS_ENTRY_COUNT)
+		return;
+
+	kern_task_lock();
+	(void) platform_mpu_table_set(&task->mpu_phys_table[slot], 0, 0,
+	    PLATFORM_PROT_TYPE_NONE);
+	if (task == current_task)
+		platform_mpu_table_program(&task->mpu_phys_table[0]);
+	kern_task_unlock();
+}
+
+/**
+ * Update a task's user arena mapping after TASK_MEM_ID_USER_ARENA
+ * has been resized.
+ *
+ * The arena base doesn't move, so growing it just enables more of
+ * the region's subregions (or uses the next size up, if the base is
+ * aligned for it.)  It stays in slot 1.
+ *
+ * @param[in] task task to update
+ * @retval true if remapped, false if the new size can't be mapped;
+ *   the old mapping is left alone
+ */
+bool
+kern_task_mem_arena_remap(struct kern_task *task)
+{
+	paddr_t addr;
+	paddr_size_t size;
+	bool ret;
+
+	if ((task->task_flags & TASK_FLAGS_ENABLE_MPU) == 0)
+		return (true);
+
+	addr = kern_task_mem_get_start(&task->task_mem,
+	    TASK_MEM_ID_USER_ARENA);
+	size = kern_task_mem_get_size(&task->task_mem,
+	    TASK_MEM_ID_USER_ARENA);
+
+	kern_task_lock();
+	ret = platform_mpu_table_set(&task->mpu_phys_table[1], addr, size,
+	    PLATFORM_PROT_TYPE_NOEXEC_RW);
+	if (ret == true && task == current_task)
+		platform_mpu_table_program(&task->mpu_phys_table[0]);
+	kern_task_unlock();
+
+	return (ret);
+}
+
 /*
  * Transfer the given task mem allocations in 'dst' to the task mem in 'src'.
  *
@@ -44,37 +44,62 @@
 
 LOGGING_EXT(LOG_TASKMEM);
 
+/*
+ * MPU regions are a power of two in size, but with subregions
+ * only the enabled eighths of the region need to be allocated;
+ * the alignment is still that of the whole region.
+ */
 static uint32_t
 platform_user_task_mpu_region_size(paddr_size_t len)
 {
-	paddr_size_t mpu_min;
-	paddr_size_t ret_len = 1;
-	int i;
-
-	mpu_min = platform_mpu_table_min_region_size();
-
-	/* Handle 0 -> small allocations */
-	if (len < mpu_min) {
-		return mpu_min;
-	}
+	uint32_t size, alignment;
 
-	/* Align to power of 2, to simplify MPU logic */
-	/* TODO: (ie, not yet doing MPU subregions) */
-	/* TODO: this is from arm_v4_platform.c, make a library */
-	for (i = 0; i < 30; i++) {
-		if (ret_len >= len)
-			return ret_len;
-		ret_len = ret_len << 1;
-	}
-
-	/* Eep, return orig size, hope it fails correctly */
-	return len;
+	platform_mpu_region_size_calc(len, &size, &alignment);
+	return (size);
 }
 
 static uint32_t
 platform_user_task_mpu_region_alignment(paddr_size_t len)
 {
-	return platform_user_task_mpu_region_size(len);
+	uint32_t size, alignment;
+
+	platform_mpu_region_size_calc(len, &size, &alignment);
+	return (alignment);
+}
+
+/*
+ * Round a segment inside the user arena up to the CPU alignment
+ * needed for the stack and doubleword accesses.
+ */
+#define	USER_ARENA_SEGMENT_ALIGN(len)	(((len) + 7) & ~7)
+
+/*
+ * Log how much SRAM a user task is using versus what it asked for,
+ * and what it would've used with one MPU region per segment.
+ */
+static void
+platform_user_task_mem_report(const struct user_exec_program_header *hdr,
+    uint32_t arena_size)
+{
+	uint32_t needed, separate, pow2;
+
+	needed = hdr->got_size + hdr->bss_size + hdr->data_size +
+	    hdr->heap_size + hdr->stack_size;
+	separate = platform_user_task_mpu_region_size(hdr->got_size) +
+	    platform_user_task_mpu_region_size(hdr->bss_size) +
+	    platform_user_task_mpu_region_size(hdr->data_size) +
+	    platform_user_task_mpu_region_size(hdr->heap_size) +
+	    platform_user_task_mpu_region_size(hdr->stack_size);
+	pow2 = platform_user_task_mpu_region_alignment(hdr->got_size) +
+	    platform_user_task_mpu_region_alignment(hdr->bss_size) +
+	    platform_user_task_mpu_region_alignment(hdr->data_size) +
+	    platform_user_task_mpu_region_alignment(hdr->heap_size) +
+	    platform_user_task_mpu_region_alignment(hdr->stack_size);
+
+	KERN_LOG(LOG_TASKMEM, KERN_LOG_LEVEL_NOTICE,
+	    "user task SRAM: %u bytes needed, %u in arena, %u with a region"
+	    " per segment, %u with power of two regions",
+	    needed, arena_size, separate, pow2);
 }
 
 /**
@@ -90,7 +115,22 @@ platform_user_task_mpu_region_alignment(paddr_size_t len)
  * just going to directly reference the location in memory.
  * Those will be setup by the caller after this function runs.
  *
- * All of the other segments are allocated.
+ * All of the other segments are carved out of a single MPU aligned
+ * arena, laid out as:
+ *
+ *   [ GOT ][ stack ][ data ][ bss ][ lib ][ heap ]
+ *
+ * The whole arena is mapped read/write by one MPU region and the GOT
+ * is covered by a second, higher priority read-only region.  The GOT
+ * is padded out to something a single MPU region can cover; since it's
+ * at the start of the arena it inherits the arena alignment.  Putting
+ * the stack right after the GOT means a stack overflow faults rather
+ * than scribbling over data.  Whatever is left over at the end of the
+ * arena after MPU rounding is handed to the heap.  The heap is last so
+ * platform_user_task_heap_grow() can extend it in place.
+ *
+ * lib_size is the per-task RAM for a shared library (its GOT, data
+ * and bss), or 0.  XXX TODO: the library GOT isn't write protected.
  *
  * If require_mpu is set, then an attempt to allocate memory which will
  * meet the alignment requirements for the MPU will be made.  If it can't
@@ -105,9 +145,12 @@ bool
 platform_user_task_mem_allocate(const struct user_exec_program_header *hdr,
     struct user_exec_program_addrs *addrs,
     struct task_mem *tm,
+    uint32_t lib_size,
     bool require_mpu)
 {
-	paddr_t kern_stack;
+	paddr_t kern_stack, arena;
+	uint32_t got_size, stack_size, data_size, bss_size, heap_size;
+	uint32_t arena_len, arena_size, arena_alignment;
 
 	kern_bzero(addrs, sizeof(*addrs));
 
@@ -123,6 +166,8 @@ platform_user_task_mem_allocate(const struct user_exec_program_header *hdr,
 		     "failed to allocate %s", "kernel stack");
 		goto error;
 	}
+	kern_task_mem_set(tm, TASK_MEM_ID_KERN_STACK, kern_stack,
+	    PLATFORM_DEFAULT_KERN_STACK_SIZE, true);
 	console_printf("kstack_addr: 0x%x -> 0x%x\n",
 	    kern_stack, kern_stack + PLATFORM_DEFAULT_KERN_STACK_SIZE - 1);
 
@@ -135,71 +180,54 @@ platform_user_task_mem_allocate(const struct user_exec_program_header *hdr,
 	addrs.rodata_addr = pak.payload_start + hdr.rodata_offset;
 #endif
 
+	/* Segment sizes inside the arena */
+	got_size = platform_user_task_mpu_region_size(hdr->got_size);
+	stack_size = USER_ARENA_SEGMENT_ALIGN(hdr->stack_size);
+	data_size = USER_ARENA_SEGMENT_ALIGN(hdr->data_size);
+	bss_size = USER_ARENA_SEGMENT_ALIGN(hdr->bss_size);
+	heap_size = USER_ARENA_SEGMENT_ALIGN(hdr->heap_size);
+	lib_size = USER_ARENA_SEGMENT_ALIGN(lib_size);
+
+	arena_len = got_size + stack_size + data_size + bss_size + lib_size +
+	    heap_size;
+	platform_mpu_region_size_calc(arena_len, &arena_size,
+	    &arena_alignment);
+
 	/* MPU aligned, sized RAM */
-	addrs->got_addr = kern_physmem_alloc(
-	    platform_user_task_mpu_region_size(hdr->got_size),
-	    platform_user_task_mpu_region_alignment(hdr->got_size),
+	arena = kern_physmem_alloc(arena_size, arena_alignment,
 	    KERN_PHYSMEM_ALLOC_FLAG_ZERO);
-	if (addrs->got_addr == 0) {
+	if (arena == 0) {
 		KERN_LOG(LOG_TASKMEM, KERN_LOG_LEVEL_CRIT,
-		     "failed to allocate %s", "user GOT");
+		     "failed to allocate %s", "user arena");
 		goto error;
 	}
-	console_printf("got_addr: 0x%x -> 0x%x\n",
-	    addrs->got_addr,
-	    addrs->got_addr + platform_user_task_mpu_region_alignment(hdr->got_size) - 1);
+	kern_task_mem_set(tm, TASK_MEM_ID_USER_ARENA, arena, arena_size, true);
+	console_printf("arena_addr: 0x%x -> 0x%x\n",
+	    arena, arena + arena_size - 1);
 
-	addrs->bss_addr = kern_physmem_alloc(
-	    platform_user_task_mpu_region_size(hdr->bss_size),
-	    platform_user_task_mpu_region_alignment(hdr->bss_size),
-	    KERN_PHYSMEM_ALLOC_FLAG_ZERO);
-	if (addrs->bss_addr == 0) {
-		KERN_LOG(LOG_TASKMEM, KERN_LOG_LEVEL_CRIT,
-		     "failed to allocate %s", "user bss");
-		goto error;
-	}
-	console_printf("bss_addr: 0x%x -> 0x%x\n",
-	    addrs->bss_addr,
-	    addrs->bss_addr + platform_user_task_mpu_region_alignment(hdr->bss_size) - 1);
+	/* Hand any MPU rounding slack to the heap */
+	heap_size += arena_size - arena_len;
 
-	addrs->data_addr = kern_physmem_alloc(
-	    platform_user_task_mpu_region_size(hdr->data_size),
-	    platform_user_task_mpu_region_alignment(hdr->data_size),
-	    KERN_PHYSMEM_ALLOC_FLAG_ZERO);
-	if (addrs->data_addr == 0) {
-		KERN_LOG(LOG_TASKMEM, KERN_LOG_LEVEL_CRIT,
-		     "failed to allocate %s", "user data");
-		goto error;
-	}
-	console_printf("data_addr: 0x%x -> 0x%x\n",
-	     addrs->data_addr,
-	     addrs->data_addr + platform_user_task_mpu_region_alignment(hdr->data_size) - 1);
+	addrs->got_addr = arena;
+	addrs->stack_addr = addrs->got_addr + got_size;
+	addrs->data_addr = addrs->stack_addr + stack_size;
+	addrs->bss_addr = addrs->data_addr + data_size;
+	addrs->lib_addr = (lib_size != 0) ? addrs->bss_addr + bss_size : 0;
+	addrs->heap_addr = addrs->bss_addr + bss_size + lib_size;
 
-	addrs->heap_addr = kern_physmem_alloc(
-	    platform_user_task_mpu_region_size(hdr->heap_size),
-	    platform_user_task_mpu_region_alignment(hdr->heap_size),
-	    KERN_PHYSMEM_ALLOC_FLAG_ZERO);
-	if (addrs->heap_addr == 0) {
-		KERN_LOG(LOG_TASKMEM, KERN_LOG_LEVEL_CRIT,
-		     "failed to allocate %s", "user heap");
-		goto error;
-	}
+	console_printf("got_addr: 0x%x -> 0x%x\n",
+	    addrs->got_addr, addrs->got_addr + got_size - 1);
+	console_printf("stack_addr: 0x%x -> 0x%x\n",
+	    addrs->stack_addr, addrs->stack_addr + stack_size - 1);
+	console_printf("data_addr: 0x%x -> 0x%x\n",
+	    addrs->data_addr, addrs->data_addr + data_size - 1);
+	console_printf("bss_addr: 0x%x -> 0x%x\n",
+	    addrs->bss_addr, addrs->bss_addr + bss_size - 1);
+	if (lib_size != 0)
+		console_printf("lib_addr: 0x%x -> 0x%x\n",
+		    addrs->lib_addr, addrs->lib_addr + lib_size - 1);
 	console_printf("heap_addr: 0x%x -> 0x%x\n",
-	    addrs->heap_addr,
-	    addrs->heap_addr + platform_user_task_mpu_region_alignment(hdr->heap_size) - 1);
-
-	/* User stack: requires MPU alignment */
-	addrs->stack_addr = kern_physmem_alloc(
-	    platform_user_task_mpu_region_size(hdr->stack_size),
-	    platform_user_task_mpu_region_alignment(hdr->stack_size),
-	     KERN_PHYSMEM_ALLOC_FLAG_ZERO);
-	if (addrs->stack_addr == 0) {
-		KERN_LOG(LOG_TASKMEM, KERN_LOG_LEVEL_CRIT,
-		     "failed to allocate %s", "user stack");
-		goto error;
-	}
-	console_printf("stack_addr: 0x%x -> 0x%x\n", addrs->stack_addr,
-	    addrs->stack_addr + platform_user_task_mpu_region_alignment(hdr->stack_size) - 1);
+	    addrs->heap_addr, addrs->heap_addr + heap_size - 1);
 
 	/* XIP */
 	/*
@@ -207,33 +235,100 @@ platform_user_task_mem_allocate(const struct user_exec_program_header *hdr,
 	 * board I'm using, and instead should look at the hdr or something.
 	 * (And I should pass in the whole of flash for text if I'm XIP'ing
 	 * and want it to be represented in the MPU.)
+	 *
+	 * Callers loading an MPU aligned pak replace this with just the
+	 * pak payload; see flash_resource_pak_mpu_region().
 	 */
 	kern_task_mem_set(tm, TASK_MEM_ID_TEXT, 0x08000000, 0x200000, false);
 
+	/* These all live in the arena, so aren't freed separately */
 	kern_task_mem_set(tm, TASK_MEM_ID_USER_GOT, addrs->got_addr,
-	    platform_user_task_mpu_region_size(hdr->got_size),
-	    true);
+	    got_size, false);
 	kern_task_mem_set(tm, TASK_MEM_ID_USER_BSS, addrs->bss_addr,
-	    platform_user_task_mpu_region_size(hdr->bss_size),
-	    true);
+	    bss_size, false);
 	kern_task_mem_set(tm, TASK_MEM_ID_USER_DATA, addrs->data_addr,
-	    platform_user_task_mpu_region_size(hdr->data_size),
-	    true);
+	    data_size, false);
 
 	/* XIP */
 	kern_task_mem_set(tm, TASK_MEM_ID_USER_RODATA,
 	    addrs->rodata_addr, hdr->rodata_size, false);
 
 	kern_task_mem_set(tm, TASK_MEM_ID_USER_HEAP, addrs->heap_addr,
-	    platform_user_task_mpu_region_size(hdr->heap_size),
-	    true);
+	    heap_size, false);
 	kern_task_mem_set(tm, TASK_MEM_ID_USER_STACK, addrs->stack_addr,
-	    platform_user_task_mpu_region_size(hdr->stack_size),
-	    true);
-	kern_task_mem_set(tm, TASK_MEM_ID_KERN_STACK, kern_stack,
-	    PLATFORM_DEFAULT_KERN_STACK_SIZE, true);
+	    stack_size, false);
+
+	platform_user_task_mem_report(hdr, arena_size);
 
 	return (true);
 error:
 	return (false);
 }
+
+/**
+ * Grow a user task's heap by at least 'len' bytes.
+ *
+ * The heap is at the end of the arena, and the arena is aligned to
+ * the whole power of two MPU region even though only the enabled
+ * subregions are allocated.  So the arena can grow in place into the
+ * rest of that region and the arena mapping just gets more subregions
+ * enabled; growing never costs another MPU slot.  If the RAM after the
+ * arena is already in use, or the heap would outgrow the region (and
+ * the base isn't aligned for the next size up) then this fails.
+ *
+ * @param[in] task task whose heap to grow
+ * @param[in] len minimum number of bytes to add
+ * @param[out] addr start of the new heap space, right after the
+ *   existing heap
+ * @param[out] size number of bytes added
+ * @retval true if the heap grew, false otherwise
+ */
+bool
+platform_user_task_heap_grow(struct kern_task *task, uint32_t len,
+    paddr_t *addr, paddr_size_t *size)
+{
+	struct task_mem *tm = &task->task_mem;
+	paddr_t arena, heap;
+	uint32_t arena_size, heap_size, new_size, alignment;
+
+	arena = kern_task_mem_get_start(tm, TASK_MEM_ID_USER_ARENA);
+	arena_size = kern_task_mem_get_size(tm, TASK_MEM_ID_USER_ARENA);
+	heap = kern_task_mem_get_start(tm, TASK_MEM_ID_USER_HEAP);
+	heap_size = kern_task_mem_get_size(tm, TASK_MEM_ID_USER_HEAP);
+
+	if (arena_size == 0 || len == 0)
+		return (false);
+	if (heap + heap_size != arena + arena_size)
+		return (false);
+	if (len > 0x80000000 - arena_size)
+		return (false);
+
+	platform_mpu_region_size_calc(arena_size + len, &new_size,
+	    &alignment);
+	if (new_size < arena_size + len || (arena & (alignment - 1)) != 0)
+		return (false);
+
+	if (kern_physmem_extend(arena, new_size,
+	    KERN_PHYSMEM_ALLOC_FLAG_ZERO) == false) {
+		KERN_LOG(LOG_TASKMEM, KERN_LOG_LEVEL_INFO,
+		     "%s: no room after arena 0x%x", __func__, arena);
+		return (false);
+	}
+
+	/*
+	 * If the MPU can't map it then the extra RAM just stays part
+	 * of the arena block until the task exits.
+	 */
+	kern_task_mem_set(tm, TASK_MEM_ID_USER_ARENA, arena, new_size, true);
+	if (kern_task_mem_arena_remap(task) == false) {
+		kern_task_mem_set(tm, TASK_MEM_ID_USER_ARENA, arena,
+		    arena_size, true);
+		return (false);
+	}
+	kern_task_mem_set(tm, TASK_MEM_ID_USER_HEAP, heap,
+	    heap_size + (new_size - arena_size), false);
+
+	*addr = arena + arena_size;
+	*size = new_size - arena_size;
+	return (true);
+}
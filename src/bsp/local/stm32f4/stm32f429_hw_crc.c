@@ -0,0 +1,103 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../os/reg.h"
+#include "../os/bit.h"
+
+#include "stm32f429_hw_map.h"
+#include "stm32f429_hw_rcc_defs.h"
+#include "stm32f429_hw_rcc.h"
+#include "stm32f429_hw_crc_reg.h"
+#include "stm32f429_hw_crc.h"
+
+#include "kern/libraries/crc32/crc32b.h"
+
+#include "core/lock.h"
+
+/*
+ * The STM32F4 CRC unit only does CRC-32/MPEG-2 - the 0x04c11db7
+ * polynomial MSB first, 32 bit words at a time, initialised to
+ * 0xffffffff with no final inversion.  The usual reflected CRC-32
+ * is the same thing with every input word and the result bit
+ * reversed, so RBIT the data going in and the register coming out.
+ *
+ * It can't be seeded, so trailing bytes that don't make up a whole
+ * word are finished in software from the (reflected) register value.
+ *
+ * There's one CRC unit, so it's claimed with a busy flag.  The flag
+ * is only tested and set under a spinlock, so this is safe from
+ * interrupt context too.  The result doesn't depend on who computes
+ * it, so rather than wait, a caller that finds the unit busy just
+ * does the CRC in software.
+ */
+
+static platform_spinlock_t stm32f429_hw_crc_lock;
+static volatile bool stm32f429_hw_crc_busy = false;
+
+static bool
+stm32f429_hw_crc_claim(void)
+{
+	bool ret;
+
+	platform_spinlock_lock(&stm32f429_hw_crc_lock);
+	ret = (stm32f429_hw_crc_busy == false);
+	stm32f429_hw_crc_busy = true;
+	platform_spinlock_unlock(&stm32f429_hw_crc_lock);
+	return (ret);
+}
+
+static void
+stm32f429_hw_crc_release(void)
+{
+
+	platform_spinlock_lock(&stm32f429_hw_crc_lock);
+	stm32f429_hw_crc_busy = false;
+	platform_spinlock_unlock(&stm32f429_hw_crc_lock);
+}
+
+static inline uint32_t
+stm32f429_hw_crc_rbit(uint32_t v)
+{
+	uint32_t r;
+
+	__asm__ ("rbit %0, %1" : "=r" (r) : "r" (v));
+	return (r);
+}
+
+void
+stm32f429_hw_crc_init(void)
+{
+
+	platform_spinlock_init(&stm32f429_hw_crc_lock);
+	stm32f429_rcc_peripheral_enable(STM32F429_RCC_PERPIH_CRC, true);
+}
+
+uint32_t
+stm32f429_hw_crc32b(const char *s, size_t n)
+{
+	const unsigned char *p = (const unsigned char *) s;
+	uint32_t w, crc;
+
+	if (stm32f429_hw_crc_claim() == false)
+		return (kern_crc32b_sw(s, n));
+
+	os_reg_write32(CRC_BASE, STM32F429_HW_CRC_REG_CR,
+	    STM32F429_HW_CRC_REG_CR_RESET);
+
+	while (n >= 4) {
+		w = (uint32_t) p[0] | ((uint32_t) p[1] << 8) |
+		    ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+		os_reg_write32(CRC_BASE, STM32F429_HW_CRC_REG_DR,
+		    stm32f429_hw_crc_rbit(w));
+		p += 4;
+		n -= 4;
+	}
+
+	crc = stm32f429_hw_crc_rbit(os_reg_read32(CRC_BASE,
+	    STM32F429_HW_CRC_REG_DR));
+	stm32f429_hw_crc_release();
+	crc = kern_crc32b_update(crc, (const char *) p, n);
+
+	return (~crc);
+}
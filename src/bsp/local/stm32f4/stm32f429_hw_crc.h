@@ -0,0 +1,7 @@
+#ifndef	__STM32F429_HW_CRC_H__
+#define	__STM32F429_HW_CRC_H__
+
+extern	void stm32f429_hw_crc_init(void);
+extern	uint32_t stm32f429_hw_crc32b(const char *s, size_t n);
+
+#endif	/* __STM32F429_HW_CRC_H__ */
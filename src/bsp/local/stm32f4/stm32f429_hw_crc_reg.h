@@ -0,0 +1,11 @@
+#ifndef	__STM32F429_HW_CRC_REG_H__
+#define	__STM32F429_HW_CRC_REG_H__
+
+#include <os/bit.h>
+
+#define	STM32F429_HW_CRC_REG_DR		0x00000000 /* data register */
+#define	STM32F429_HW_CRC_REG_IDR	0x00000004 /* independent data */
+#define	STM32F429_HW_CRC_REG_CR		0x00000008 /* control register */
+#define		STM32F429_HW_CRC_REG_CR_RESET	BIT_U32(0)
+
+#endif	/* __STM32F429_HW_CRC_REG_H__ */
@@ -59,6 +59,7 @@
 #define		STM32F429_RCC_REG_RCC_AHB1RSTR_GPIOI_RST	BIT_U32(8)
 #define		STM32F429_RCC_REG_RCC_AHB1RSTR_GPIOJ_RST	BIT_U32(9)
 #define		STM32F429_RCC_REG_RCC_AHB1RSTR_GPIOK_RST	BIT_U32(10)
+#define		STM32F429_RCC_REG_RCC_AHB1RSTR_CRC_RST		BIT_U32(12)
 
 #define	STM32F429_RCC_REG_RCC_AHB2RSTR		0x014
 
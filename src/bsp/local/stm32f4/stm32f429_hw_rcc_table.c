@@ -116,6 +116,14 @@ static const struct stm32f429_rcc_table_entry periph_table[] = {
 	  .rcc_clken_reg = STM32F429_RCC_REG_RCC_AHB1ENR,
 	  .rcc_clken_mask = STM32F429_RCC_REG_RCC_AHB1ENR_GPIOK_EN },
 
+	{ .periph = STM32F429_RCC_PERPIH_CRC,
+	  .bus = STM32F429_RCC_BUS_AHB1,
+	  .clock = STM32F429_RCC_CLOCK_AHB1,
+	  .rcc_reset_reg = STM32F429_RCC_REG_RCC_AHB1RSTR,
+	  .rcc_reset_mask = STM32F429_RCC_REG_RCC_AHB1RSTR_CRC_RST,
+	  .rcc_clken_reg = STM32F429_RCC_REG_RCC_AHB1ENR,
+	  .rcc_clken_mask = STM32F429_RCC_REG_RCC_AHB1ENR_CRC_EN },
+
 	/* AHB2 */
 
 	/* AHB3 */
@@ -135,6 +135,17 @@ stm32f429_uart_tx_byte(uint8_t c)
 		;
 }
 
+/*
+ * Wait until the last byte written has been fully transmitted.
+ */
+void
+stm32f429_uart_tx_flush(void)
+{
+
+	while ((os_reg_read32(USART1_BASE, USART_SR) & USART_SR_TC) == 0)
+		;
+}
+
 /**
  * UART interrupt handler.
  *
@@ -4,6 +4,7 @@
 
 #include <kern/console/console.h>
 #include <core/lock.h>
+#include <kern/libraries/string/string.h>
 #include <kern/libraries/printf/mini_printf.h>
 
 static char cons_add_crlf = 1;
@@ -51,6 +52,11 @@ _console_putc_locked(char c)
 void
 console_putc(char c)
 {
+	if (c_ops != NULL && c_ops->write_fn != NULL) {
+		c_ops->write_fn(&c, 1, false);
+		return;
+	}
+
 	platform_spinlock_lock(&console_lock);
 	_console_putc_locked(c);
 	platform_spinlock_unlock(&console_lock);
@@ -66,6 +72,11 @@ console_putc(char c)
 void
 console_puts(const char *s)
 {
+	if (c_ops != NULL && c_ops->write_fn != NULL) {
+		c_ops->write_fn(s, kern_strlen(s), cons_add_crlf == 1);
+		return;
+	}
+
 	platform_spinlock_lock(&console_lock);
 	while (*s != '\0') {
 		if ((cons_add_crlf == 1) && (*s == '\n')) {
@@ -89,6 +100,11 @@ console_putsn(const char *s, size_t len)
 {
 	size_t i;
 
+	if (c_ops != NULL && c_ops->write_fn != NULL) {
+		c_ops->write_fn(s, len, cons_add_crlf == 1);
+		return;
+	}
+
 	platform_spinlock_lock(&console_lock);
 	for (i = 0; i < len; i++) {
 		if ((cons_add_crlf == 1) && (*s == '\n')) {
@@ -3,12 +3,26 @@
 
 #include <stdarg.h>
 
+#include <stdbool.h>
+
 typedef void console_op_putc_fn_t(char c);
 typedef void console_op_flush_fn_t(void);
+typedef void console_op_write_fn_t(const char *s, size_t len, bool crlf);
 
+/*
+ * putc_fn is called with the console spinlock held (so interrupts
+ * masked) and mustn't sleep.
+ *
+ * If write_fn is set then all output goes through it instead, a
+ * string at a time and without the console spinlock held, so it
+ * can sleep - eg hand the string to a driver server task.  The
+ * driver has to keep concurrent writes from interleaving itself and
+ * does the LF->CRLF translation if crlf is true.
+ */
 struct console_ops {
 	console_op_putc_fn_t *putc_fn;
 	console_op_flush_fn_t *flush_fn;
+	console_op_write_fn_t *write_fn;
 };
 
 extern	void console_init(void);
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include <hw/types.h>
+
+#include <kern/libraries/list/list.h>
+#include <kern/libraries/container/container.h>
+
+#include <core/user_ram_access.h>
+
+#include <kern/core/error.h>
+#include <kern/core/signal.h>
+#include <kern/core/task.h>
+#include <kern/core/futex.h>
+#include <kern/core/logging.h>
+
+LOGGING_DEFINE(LOG_FUTEX, "futex", KERN_LOG_LEVEL_INFO);
+
+static struct list_head kern_futex_hash[KERN_FUTEX_HASH_SIZE];
+
+static struct list_head *
+kern_futex_bucket(uaddr_t uaddr)
+{
+
+	return (&kern_futex_hash[(uaddr >> 2) % KERN_FUTEX_HASH_SIZE]);
+}
+
+void
+kern_futex_init(void)
+{
+	int i;
+
+	for (i = 0; i < KERN_FUTEX_HASH_SIZE; i++)
+		list_head_init(&kern_futex_hash[i]);
+}
+
+/**
+ * Sleep until woken if the futex word still holds val.
+ *
+ * The compare and the enqueue are done under the task lock, so a
+ * wakeup from a task which changed the word after we looked at it
+ * can't be missed.
+ *
+ * This is only callable from task context.
+ *
+ * XXX TODO: the address isn't checked against the task's memory
+ * map; the user RAM access routines don't do that yet either.
+ *
+ * @param[in] uaddr address of the futex word; must be word aligned
+ * @param[in] val value the caller expects the word to have
+ * @retval KERN_ERR_OK if woken up, KERN_ERR_AGAIN if the word didn't
+ *   hold val, KERN_ERR_INVALID_ARGS for a bad address
+ */
+kern_error_t
+kern_futex_wait(uaddr_t uaddr, uint32_t val)
+{
+	kern_task_signal_set_t sig;
+	struct list_head *bucket;
+	uint32_t cur;
+
+	if (uaddr == 0 || (uaddr & 3) != 0)
+		return (KERN_ERR_INVALID_ARGS);
+
+	kern_task_lock();
+	if (platform_user_ram_copy_from_user(uaddr, (paddr_t) &cur,
+	    sizeof(cur)) == false) {
+		kern_task_unlock();
+		return (KERN_ERR_INVALID_ARGS);
+	}
+	if (cur != val) {
+		kern_task_unlock();
+		return (KERN_ERR_AGAIN);
+	}
+
+	if (kern_task_sched_running() == false) {
+		kern_task_unlock();
+		KERN_LOG(LOG_FUTEX, KERN_LOG_LEVEL_CRIT,
+		    "%s: would sleep before the scheduler is running",
+		    __func__);
+		return (KERN_ERR_INVALID_ARGS);
+	}
+
+	bucket = kern_futex_bucket(uaddr);
+	current_task->sig_set &= ~KERN_SIGNAL_TASK_KWAIT;
+	current_task->wait_futex_addr = uaddr;
+	current_task->wait_futex = bucket;
+	kern_task_waitq_add_locked(bucket, current_task);
+	kern_task_unlock();
+
+	while (current_task->wait_futex != NULL) {
+		(void) kern_task_wait(KERN_SIGNAL_TASK_KWAIT, &sig);
+	}
+
+	return (KERN_ERR_OK);
+}
+
+/**
+ * Wake up tasks waiting on a futex word, highest priority first.
+ *
+ * This can be called from interrupt context.
+ *
+ * @param[in] uaddr address of the futex word
+ * @param[in] count maximum number of tasks to wake
+ * @retval the number of tasks woken
+ */
+uint32_t
+kern_futex_wake(uaddr_t uaddr, uint32_t count)
+{
+	struct list_head *bucket;
+	struct list_node *node, *next;
+	struct kern_task *task;
+	uint32_t n = 0;
+
+	bucket = kern_futex_bucket(uaddr);
+
+	kern_task_lock();
+	for (node = bucket->head; node != NULL && n < count; node = next) {
+		next = node->next;
+		task = container_of(node, struct kern_task, wait_node);
+		if (task->wait_futex_addr != uaddr)
+			continue;
+		list_delete(bucket, &task->wait_node);
+		task->wait_futex = NULL;
+		kern_task_signal_task_locked(task, KERN_SIGNAL_TASK_KWAIT);
+		n++;
+	}
+	kern_task_unlock();
+
+	return (n);
+}
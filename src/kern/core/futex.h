@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef	__KERN_FUTEX_H__
+#define	__KERN_FUTEX_H__
+
+#include <kern/core/error.h>
+
+/*
+ * Futexes - wait / wake on a 32 bit word in task memory.
+ *
+ * This is what userland builds its locks on; the uncontended case
+ * never enters the kernel.  There's no address translation, so the
+ * word's address is the key and tasks sharing a shared memory
+ * region (see kern/ipc/shm.h) can wait on each other's words.
+ *
+ * Waiters are kept in a small hash of wait queues, highest
+ * priority first.
+ */
+
+#define	KERN_FUTEX_HASH_SIZE		16
+
+extern	void kern_futex_init(void);
+extern	kern_error_t kern_futex_wait(uaddr_t uaddr, uint32_t val);
+extern	uint32_t kern_futex_wake(uaddr_t uaddr, uint32_t count);
+
+#endif	/* __KERN_FUTEX_H__ */
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include <hw/types.h>
+
+#include <kern/libraries/mem/mem.h>
+
+#include <kern/core/info_page.h>
+
+#include <core/platform.h>
+
+static volatile struct kern_info_page kern_info_page
+    __attribute__((aligned(KERN_INFO_PAGE_SIZE)));
+
+/* The 64 bit uptime, only touched by the timer tick */
+static uint64_t kern_info_page_uptime_msec = 0;
+
+void
+kern_info_page_init(void)
+{
+
+	kern_bzero((void *) &kern_info_page, sizeof(kern_info_page));
+	kern_info_page.version = KERN_INFO_PAGE_VERSION;
+	kern_info_page.cpu_freq_hz = platform_cpu_cycle_freq();
+}
+
+/**
+ * Update the time fields; called from the timer tick.
+ *
+ * There's only ever one writer (the tick, with the timer lock held)
+ * and the readers are user tasks on the same CPU, so the volatile
+ * accesses keep things in the right order without barriers.
+ *
+ * @param[in] tick_msec the new kern_timer_tick_msec
+ * @param[in] interval_msec msec since the last tick
+ */
+void
+kern_info_page_tick(uint32_t tick_msec, uint32_t interval_msec)
+{
+
+	kern_info_page_uptime_msec += interval_msec;
+
+	kern_info_page.seq++;
+	kern_info_page.tick_msec = tick_msec;
+	kern_info_page.uptime_msec_lo = (uint32_t) kern_info_page_uptime_msec;
+	kern_info_page.uptime_msec_hi =
+	    (uint32_t) (kern_info_page_uptime_msec >> 32);
+	kern_info_page.tick_interval_msec = interval_msec;
+	/* The CPU clock is set up after we're initialised */
+	kern_info_page.cpu_freq_hz = platform_cpu_cycle_freq();
+	kern_info_page.seq++;
+}
+
+/**
+ * Update the current task id; called on each context switch.
+ */
+void
+kern_info_page_set_task(uint32_t task_id)
+{
+
+	kern_info_page.task_id = task_id;
+}
+
+/**
+ * Address of the info page, for mapping it into tasks.  It's
+ * KERN_INFO_PAGE_SIZE bytes long and aligned to that.
+ */
+paddr_t
+kern_info_page_addr(void)
+{
+
+	return ((paddr_t) &kern_info_page);
+}
@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+#ifndef	__KERN_INFO_PAGE_H__
+#define	__KERN_INFO_PAGE_H__
+
+#include <kern/core/info_page_defs.h>
+
+extern	void kern_info_page_init(void);
+extern	void kern_info_page_tick(uint32_t tick_msec, uint32_t interval_msec);
+extern	void kern_info_page_set_task(uint32_t task_id);
+extern	paddr_t kern_info_page_addr(void);
+
+#endif	/* __KERN_INFO_PAGE_H__ */
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+#ifndef	__KERN_INFO_PAGE_DEFS_H__
+#define	__KERN_INFO_PAGE_DEFS_H__
+
+/*
+ * Layout of the kernel info page.
+ *
+ * This is mapped read-only into every user task so things like the
+ * current time can be read without a syscall.  It's shared with
+ * userland (user/include/wtf_info.h) so only uses plain types.
+ *
+ * The time fields are protected by a sequence count: the kernel
+ * makes seq odd, updates them, then makes seq even again.  Readers
+ * read seq, the fields, then seq again and retry if it was odd or
+ * changed.
+ *
+ * task_id is a single word updated on each context switch; it's
+ * always the id of the task reading it.
+ *
+ * The page is a single MPU region so it has to stay a power of two
+ * in size (KERN_INFO_PAGE_SIZE) and the kernel aligns it to that.
+ */
+
+#define	KERN_INFO_PAGE_VERSION		1
+#define	KERN_INFO_PAGE_SIZE		32
+
+/**
+ * struct kern_info_page - kernel info page.
+ *
+ * @seq sequence count for the time fields
+ * @version KERN_INFO_PAGE_VERSION
+ * @tick_msec kern_timer_tick_msec; wraps
+ * @uptime_msec_lo low 32 bits of the monotonic uptime in msec
+ * @uptime_msec_hi high 32 bits of the monotonic uptime in msec
+ * @tick_interval_msec how often the above are updated
+ * @cpu_freq_hz CPU cycle counter rate, or 0 if not yet known
+ * @task_id the current task's kern_task_id_t
+ */
+struct kern_info_page {
+	uint32_t seq;
+	uint32_t version;
+	uint32_t tick_msec;
+	uint32_t uptime_msec_lo;
+	uint32_t uptime_msec_hi;
+	uint32_t tick_interval_msec;
+	uint32_t cpu_freq_hz;
+	uint32_t task_id;
+};
+
+#endif	/* __KERN_INFO_PAGE_DEFS_H__ */
@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include <hw/types.h>
+
+#include <kern/libraries/list/list.h>
+#include <kern/libraries/container/container.h>
+
+#include <kern/core/signal.h>
+#include <kern/core/task.h>
+#include <kern/core/mutex.h>
+#include <kern/core/sema.h>
+#include <kern/core/logging.h>
+
+LOGGING_DEFINE(LOG_MUTEX, "mutex", KERN_LOG_LEVEL_INFO);
+
+void
+kern_mutex_init(struct kern_mutex *mtx, const char *name)
+{
+	mtx->name = name;
+	mtx->owner = NULL;
+	list_head_init(&mtx->waiters);
+	list_node_init(&mtx->owner_node);
+	mtx->contended = 0;
+}
+
+/**
+ * Calculate the effective priority of a task - its base priority
+ * or the priority of the highest waiter on any mutex it holds.
+ *
+ * Must be called with the task lock held.
+ */
+static uint8_t
+kern_mutex_task_priority_calc_locked(struct kern_task *task)
+{
+	struct list_node *node;
+	struct kern_mutex *mtx;
+	struct kern_task *w;
+	uint8_t prio;
+
+	prio = task->base_priority;
+	for (node = task->held_mutex_list.head; node != NULL;
+	    node = node->next) {
+		mtx = container_of(node, struct kern_mutex, owner_node);
+		/* Waiters are sorted, so the head is the highest */
+		if (mtx->waiters.head == NULL)
+			continue;
+		w = container_of(mtx->waiters.head, struct kern_task,
+		    wait_node);
+		if (w->priority > prio)
+			prio = w->priority;
+	}
+	return (prio);
+}
+
+void
+kern_mutex_task_priority_update_locked(struct kern_task *task)
+{
+	struct kern_mutex *mtx;
+	uint8_t prio;
+	int i;
+
+	for (i = 0; task != NULL && i < KERN_MUTEX_PI_MAX_DEPTH; i++) {
+		prio = kern_mutex_task_priority_calc_locked(task);
+		if (prio == task->priority)
+			break;
+		task->priority = prio;
+
+		/* Keep any wait queue we're on sorted */
+		if (task->wait_sema != NULL) {
+			list_delete(&task->wait_sema->waiters,
+			    &task->wait_node);
+			kern_task_waitq_add_locked(&task->wait_sema->waiters,
+			    task);
+		}
+		if (task->wait_futex != NULL) {
+			list_delete(task->wait_futex, &task->wait_node);
+			kern_task_waitq_add_locked(task->wait_futex, task);
+		}
+
+		/*
+		 * If we're blocked on a mutex then re-sort ourselves
+		 * in its wait queue and have the owner inherit the
+		 * new priority.
+		 */
+		mtx = task->wait_mutex;
+		if (mtx == NULL)
+			break;
+		list_delete(&mtx->waiters, &task->wait_node);
+		kern_task_waitq_add_locked(&mtx->waiters, task);
+		task = mtx->owner;
+	}
+}
+
+/**
+ * Make the given task the owner of the mutex.
+ *
+ * Must be called with the task lock held.
+ */
+static void
+kern_mutex_set_owner_locked(struct kern_mutex *mtx, struct kern_task *task)
+{
+	mtx->owner = task;
+	list_add_tail(&task->held_mutex_list, &mtx->owner_node);
+}
+
+/**
+ * Acquire the given mutex, sleeping until it's available.
+ *
+ * Before the scheduler is running the system is single threaded,
+ * so this (and unlock) do nothing.
+ *
+ * @param[in] mtx mutex to lock
+ */
+void
+kern_mutex_lock(struct kern_mutex *mtx)
+{
+	kern_task_signal_set_t sig;
+
+	if (kern_task_sched_running() == false)
+		return;
+
+	kern_task_lock();
+	if (mtx->owner == NULL) {
+		kern_mutex_set_owner_locked(mtx, current_task);
+		kern_task_unlock();
+		return;
+	}
+
+	if (mtx->owner == current_task) {
+		kern_task_unlock();
+		KERN_LOG(LOG_MUTEX, KERN_LOG_LEVEL_CRIT,
+		    "%s: task 0x%x recursively locking %s",
+		    __func__, current_task, mtx->name);
+		return;
+	}
+
+	/*
+	 * Queue ourselves up and lend our priority to the owner.
+	 * Clear any stale wakeup first; the unlock path will set
+	 * KWAIT after it has handed the mutex to us.
+	 */
+	mtx->contended++;
+	current_task->sig_set &= ~KERN_SIGNAL_TASK_KWAIT;
+	current_task->wait_mutex = mtx;
+	kern_task_waitq_add_locked(&mtx->waiters, current_task);
+	kern_mutex_task_priority_update_locked(mtx->owner);
+	kern_task_unlock();
+
+	while (mtx->owner != current_task) {
+		(void) kern_task_wait(KERN_SIGNAL_TASK_KWAIT, &sig);
+	}
+}
+
+/**
+ * Try to acquire the given mutex without sleeping.
+ *
+ * @param[in] mtx mutex to lock
+ * @retval true if the mutex was acquired, false otherwise
+ */
+bool
+kern_mutex_trylock(struct kern_mutex *mtx)
+{
+	bool ret = false;
+
+	if (kern_task_sched_running() == false)
+		return (true);
+
+	kern_task_lock();
+	if (mtx->owner == NULL) {
+		kern_mutex_set_owner_locked(mtx, current_task);
+		ret = true;
+	}
+	kern_task_unlock();
+	return (ret);
+}
+
+/**
+ * Release the given mutex.
+ *
+ * If there are waiters then ownership is handed directly to the
+ * highest priority waiter, which is then woken up.  Our priority
+ * drops back to whatever the mutexes we still hold require.
+ *
+ * @param[in] mtx mutex to unlock
+ */
+void
+kern_mutex_unlock(struct kern_mutex *mtx)
+{
+	struct kern_task *task;
+
+	if (kern_task_sched_running() == false)
+		return;
+
+	kern_task_lock();
+	if (mtx->owner != current_task) {
+		kern_task_unlock();
+		KERN_LOG(LOG_MUTEX, KERN_LOG_LEVEL_CRIT,
+		    "%s: task 0x%x unlocking %s, owned by 0x%x",
+		    __func__, current_task, mtx->name, mtx->owner);
+		return;
+	}
+
+	list_delete(&current_task->held_mutex_list, &mtx->owner_node);
+
+	if (mtx->waiters.head != NULL) {
+		task = container_of(mtx->waiters.head, struct kern_task,
+		    wait_node);
+		list_delete(&mtx->waiters, &task->wait_node);
+		task->wait_mutex = NULL;
+		kern_mutex_set_owner_locked(mtx, task);
+		kern_mutex_task_priority_update_locked(task);
+		kern_task_signal_task_locked(task, KERN_SIGNAL_TASK_KWAIT);
+	} else {
+		mtx->owner = NULL;
+	}
+
+	kern_mutex_task_priority_update_locked(current_task);
+	kern_task_unlock();
+}
+
+/**
+ * Return whether the current task owns the given mutex.
+ */
+bool
+kern_mutex_owned(const struct kern_mutex *mtx)
+{
+	if (kern_task_sched_running() == false)
+		return (true);
+	return (mtx->owner == current_task);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+#ifndef	__KERN_MUTEX_H__
+#define	__KERN_MUTEX_H__
+
+struct kern_task;
+
+/*
+ * Limit on how far priority inheritance will walk a chain of
+ * blocked mutex owners.  It also stops a deadlock cycle from
+ * looping forever.
+ */
+#define	KERN_MUTEX_PI_MAX_DEPTH		8
+
+/**
+ * struct kern_mutex - a sleeping kernel mutex.
+ *
+ * @name name, for debugging
+ * @owner task currently holding the mutex, or NULL
+ * @waiters tasks waiting for the mutex, highest priority first
+ * @owner_node node on the owner's held mutex list
+ * @contended number of times a lock attempt had to sleep
+ *
+ * Unlike the platform spinlock this doesn't disable interrupts
+ * whilst held, so it must only be used from task context and
+ * never from an interrupt handler.
+ *
+ * Mutexes implement priority inheritance - a task holding a
+ * mutex runs at the highest priority of any task waiting on
+ * a mutex it holds.  Unlock hands the mutex directly to the
+ * highest priority waiter.
+ */
+struct kern_mutex {
+	const char *name;
+	struct kern_task * volatile owner;
+	struct list_head waiters;
+	struct list_node owner_node;
+	uint32_t contended;
+};
+
+extern	void kern_mutex_init(struct kern_mutex *mtx, const char *name);
+extern	void kern_mutex_lock(struct kern_mutex *mtx);
+extern	bool kern_mutex_trylock(struct kern_mutex *mtx);
+extern	void kern_mutex_unlock(struct kern_mutex *mtx);
+extern	bool kern_mutex_owned(const struct kern_mutex *mtx);
+
+/**
+ * Recalculate the effective priority of the given task and push
+ * any change along the chain of mutex owners it's blocked on.
+ *
+ * Must be called with the task lock held.
+ */
+extern	void kern_mutex_task_priority_update_locked(struct kern_task *task);
+
+#endif	/* __KERN_MUTEX_H__ */
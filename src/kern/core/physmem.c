@@ -30,6 +30,8 @@
 #include <kern/libraries/mem/mem.h>
 
 #include <kern/core/exception.h>
+#include <kern/core/task.h>
+#include <kern/core/mutex.h>
 #include <kern/core/physmem.h>
 
 #include <kern/core/logging.h>
@@ -64,7 +66,12 @@ struct kern_physmem_free_entry {
 
 static struct list_head kern_physmem_free_list;
 
-static platform_spinlock_t kern_physmem_spinlock;
+/*
+ * Walking the free list can take a while, so this is a sleeping
+ * mutex rather than a spinlock; interrupts stay enabled.  It does
+ * mean physmem can't be called from interrupt context.
+ */
+static struct kern_mutex kern_physmem_mtx;
 
 static uint32_t
 kern_physmem_magic_calculate(const struct kern_physmem_free_entry *e)
@@ -94,7 +101,7 @@ void
 kern_physmem_init(void)
 {
 	list_head_init(&kern_physmem_free_list);
-	platform_spinlock_init(&kern_physmem_spinlock);
+	kern_mutex_init(&kern_physmem_mtx, "physmem");
 }
 
 static struct kern_physmem_free_entry *
@@ -115,7 +122,7 @@ kern_physmem_init_memory_region_node(paddr_t start, paddr_t size)
 /**
  * Add entry to free list.
  *
- * This must be called with the physmem spinlock held.
+ * This must be called with the physmem mutex held.
  */
 static void
 kern_physmem_add_to_free_list_locked(paddr_t start, paddr_t size)
@@ -181,9 +188,9 @@ kern_physmem_add_range(paddr_t start, paddr_t end, uint32_t flags)
 	 * an SDRAM bank.)
 	 */
 	if (flags == (KERN_PHYSMEM_FLAG_NORMAL | KERN_PHYSMEM_FLAG_SRAM)) {
-		platform_spinlock_lock(&kern_physmem_spinlock);
+		kern_mutex_lock(&kern_physmem_mtx);
 		kern_physmem_add_to_free_list_locked(start, size);
-		platform_spinlock_unlock(&kern_physmem_spinlock);
+		kern_mutex_unlock(&kern_physmem_mtx);
 	}
 }
 
@@ -228,7 +235,7 @@ kern_physmem_alloc(size_t size, uint32_t alignment, uint32_t flags)
 	}
 #endif
 
-	platform_spinlock_lock(&kern_physmem_spinlock);
+	kern_mutex_lock(&kern_physmem_mtx);
 
 	/*
 	 * I'm going to just find the first sized block here
@@ -280,7 +287,7 @@ kern_physmem_alloc(size_t size, uint32_t alignment, uint32_t flags)
 		/* Figure out alignment, bump start as needed */
 		if (alignment != 0) {
 			uint32_t m;
-			m = alignment - (alloc_start % alignment);
+			m = (alignment - (alloc_start % alignment)) % alignment;
 			alloc_start += m;
 			alloc_size += m;
 		}
@@ -339,6 +346,22 @@ kern_physmem_alloc(size_t size, uint32_t alignment, uint32_t flags)
 			e_size = alloc_size;
 		}
 
+		/*
+		 * Large alignments (eg MPU regions) can leave a lot of
+		 * padding in front of the allocation.  If there's enough
+		 * of it to be useful then return it to the freelist and
+		 * start the allocated block at the metadata header.
+		 */
+		if ((alloc_start - sizeof(*e) - e_start) >
+		    (KERN_PHYSMEM_MINIMUM_ALLOCATION_SIZE + sizeof(*e))) {
+			uintptr_t pad;
+
+			pad = alloc_start - sizeof(*e) - e_start;
+			kern_physmem_add_to_free_list_locked(e_start, pad);
+			e_start += pad;
+			e_size -= pad;
+		}
+
 		KERN_LOG(LOG_PHYSMEM, KERN_LOG_LEVEL_DEBUG,
 		    "[malloc] allocating 0x%x, %d bytes",
 		    (uint32_t) e_start, e_size);
@@ -367,7 +390,7 @@ kern_physmem_alloc(size_t size, uint32_t alignment, uint32_t flags)
 		break;
 	}
 
-	platform_spinlock_unlock(&kern_physmem_spinlock);
+	kern_mutex_unlock(&kern_physmem_mtx);
 
 	KERN_LOG(LOG_PHYSMEM, KERN_LOG_LEVEL_INFO,
 	    "[alloc] return 0x%08x",
@@ -376,6 +399,88 @@ kern_physmem_alloc(size_t size, uint32_t alignment, uint32_t flags)
 	return retaddr;
 }
 
+/**
+ * Grow an allocated block in place so it covers at least 'size' bytes
+ * from 'addr'.
+ *
+ * This only works if the free block directly after the allocation is
+ * big enough; nothing is moved.  If the allocation already covers
+ * 'size' bytes (eg from not fragmenting a small leftover) then this
+ * succeeds without doing anything.
+ *
+ * @param[in] addr address returned from kern_physmem_alloc()
+ * @param[in] size new size, from addr
+ * @param[in] flags KERN_PHYSMEM_ALLOC_FLAG_*; ZERO zeroes the new space
+ * @retval true if the block now covers size bytes, false otherwise
+ */
+bool
+kern_physmem_extend(paddr_t addr, size_t size, uint32_t flags)
+{
+	struct kern_physmem_free_entry *e, *ee;
+	struct list_node *n;
+	paddr_t end, need, ee_start, ee_size;
+	bool ret = false;
+
+	kern_mutex_lock(&kern_physmem_mtx);
+	e = (void *) (uintptr_t) addr;
+	e = e - 1;
+
+	if (! kern_physmem_magic_verify(e)) {
+		KERN_LOG(LOG_PHYSMEM, KERN_LOG_LEVEL_CRIT,
+		    "[extend] magic failed");
+		goto done;
+	}
+
+	end = e->start + e->size;
+	if (addr + size <= end) {
+		ret = true;
+		goto done;
+	}
+	need = addr + size - end;
+
+	/* Find the free block starting right where we end */
+	ee = NULL;
+	for (n = kern_physmem_free_list.head; n != NULL; n = n->next) {
+		ee = container_of(n, struct kern_physmem_free_entry, node);
+		if (ee->start == end)
+			break;
+	}
+	if (n == NULL || ee->size < need)
+		goto done;
+
+	/*
+	 * Take it off the freelist and hand back whatever is left
+	 * over, unless it's too small to be worth keeping.  The
+	 * freelist header lives at the start of the block we're
+	 * taking, so save its fields first.
+	 */
+	list_delete(&kern_physmem_free_list, &ee->node);
+	ee_start = ee->start;
+	ee_size = ee->size;
+	if ((ee_size - need) >
+	    (KERN_PHYSMEM_MINIMUM_ALLOCATION_SIZE + sizeof(*e))) {
+		kern_physmem_add_to_free_list_locked(ee_start + need,
+		    ee_size - need);
+		ee_size = need;
+	}
+
+	if (flags & KERN_PHYSMEM_ALLOC_FLAG_ZERO) {
+		kern_bzero((void *) ee_start, ee_size);
+	}
+
+	KERN_LOG(LOG_PHYSMEM, KERN_LOG_LEVEL_INFO,
+	    "[extend] addr 0x%x, block=0x%x, %d -> %d bytes",
+	    addr, e->start, e->size, e->size + ee_size);
+
+	e->size += ee_size;
+	e->magic = kern_physmem_magic_calculate(e);
+	ret = true;
+
+done:
+	kern_mutex_unlock(&kern_physmem_mtx);
+	return (ret);
+}
+
 /**
  * Free the given physical memory block; coalesce with blocks on either
  * side at some point.
@@ -389,7 +494,7 @@ kern_physmem_free(paddr_t addr)
 	struct kern_physmem_free_entry *e;
 	struct list_node *n;
 
-	platform_spinlock_lock(&kern_physmem_spinlock);
+	kern_mutex_lock(&kern_physmem_mtx);
 	/* Get the metadata */
 	e = (void *) (uintptr_t) addr;
 	e = e - 1;
@@ -438,5 +543,5 @@ kern_physmem_free(paddr_t addr)
 	/* See if we can coalesce! */
 	/* XXX TODO - also need to fix the fragmenting logic in kern_physmem_alloc() */
 
-	platform_spinlock_unlock(&kern_physmem_spinlock);
+	kern_mutex_unlock(&kern_physmem_mtx);
 }
@@ -19,6 +19,8 @@
 #ifndef	__KERN_PHYSMEM_H__
 #define	__KERN_PHYSMEM_H__
 
+#include <stdbool.h>
+
 #include <os/bit.h>
 
 #define	KERN_PHYSMEM_NUM_BOOTSTRAP_REGIONS	4
@@ -53,6 +55,7 @@ extern	void kern_physmem_add_range(paddr_t start, paddr_t end,
 
 extern	paddr_t kern_physmem_alloc(size_t size, uint32_t alignment,
 	    uint32_t flags);
+extern	bool kern_physmem_extend(paddr_t addr, size_t size, uint32_t flags);
 extern	void kern_physmem_free(paddr_t addr);
 
 #endif	/* __KERN_PHYSMEM_H__ */
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include <hw/types.h>
+
+#include <kern/libraries/list/list.h>
+#include <kern/libraries/container/container.h>
+
+#include <kern/core/signal.h>
+#include <kern/core/task.h>
+#include <kern/core/sema.h>
+#include <kern/core/logging.h>
+
+LOGGING_DEFINE(LOG_SEMA, "sema", KERN_LOG_LEVEL_INFO);
+
+void
+kern_sema_init(struct kern_sema *sema, const char *name, uint32_t count)
+{
+	sema->name = name;
+	sema->count = count;
+	list_head_init(&sema->waiters);
+}
+
+/**
+ * Take a unit from the semaphore, sleeping until one is available.
+ *
+ * This is only callable from task context.  If no unit is available
+ * and the scheduler isn't running yet there's nothing to sleep on,
+ * so this fails rather than spinning forever; callers must check.
+ *
+ * @param[in] sema semaphore
+ * @retval true if a unit was taken, false if it would have slept
+ *   before the scheduler is running
+ */
+bool
+kern_sema_take(struct kern_sema *sema)
+{
+	kern_task_signal_set_t sig;
+
+	kern_task_lock();
+	if (sema->count > 0) {
+		sema->count--;
+		kern_task_unlock();
+		return (true);
+	}
+
+	if (kern_task_sched_running() == false) {
+		kern_task_unlock();
+		KERN_LOG(LOG_SEMA, KERN_LOG_LEVEL_CRIT,
+		    "%s: %s would sleep before the scheduler is running",
+		    __func__, sema->name);
+		return (false);
+	}
+
+	/*
+	 * Queue up; kern_sema_give() hands the unit straight to
+	 * us and clears wait_sema rather than bumping count.
+	 */
+	current_task->sig_set &= ~KERN_SIGNAL_TASK_KWAIT;
+	current_task->wait_sema = sema;
+	kern_task_waitq_add_locked(&sema->waiters, current_task);
+	kern_task_unlock();
+
+	while (current_task->wait_sema != NULL) {
+		(void) kern_task_wait(KERN_SIGNAL_TASK_KWAIT, &sig);
+	}
+	return (true);
+}
+
+/**
+ * Take a unit from the semaphore if one is available.
+ *
+ * This doesn't sleep and can be called from interrupt context.
+ *
+ * @param[in] sema semaphore
+ * @retval true if a unit was taken, false otherwise
+ */
+bool
+kern_sema_trytake(struct kern_sema *sema)
+{
+	bool ret = false;
+
+	kern_task_lock();
+	if (sema->count > 0) {
+		sema->count--;
+		ret = true;
+	}
+	kern_task_unlock();
+	return (ret);
+}
+
+/**
+ * Give a unit to the semaphore.
+ *
+ * If a task is waiting then the highest priority waiter is handed
+ * the unit and woken up, otherwise the count is incremented.
+ *
+ * This can be called from interrupt context.
+ *
+ * @param[in] sema semaphore
+ */
+void
+kern_sema_give(struct kern_sema *sema)
+{
+	struct kern_task *task;
+
+	kern_task_lock();
+	if (sema->waiters.head != NULL) {
+		task = container_of(sema->waiters.head, struct kern_task,
+		    wait_node);
+		list_delete(&sema->waiters, &task->wait_node);
+		task->wait_sema = NULL;
+		kern_task_signal_task_locked(task, KERN_SIGNAL_TASK_KWAIT);
+	} else {
+		sema->count++;
+	}
+	kern_task_unlock();
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+#ifndef	__KERN_SEMA_H__
+#define	__KERN_SEMA_H__
+
+/**
+ * struct kern_sema - a counting semaphore.
+ *
+ * @name name, for debugging
+ * @count number of units available
+ * @waiters tasks waiting for a unit, highest priority first
+ *
+ * kern_sema_take() sleeps and so is only callable from task
+ * context.  kern_sema_give() and kern_sema_trytake() may be called
+ * from interrupt context, which makes this the way for a driver
+ * interrupt handler to wake up a task.
+ */
+struct kern_sema {
+	const char *name;
+	volatile uint32_t count;
+	struct list_head waiters;
+};
+
+extern	void kern_sema_init(struct kern_sema *sema, const char *name,
+	    uint32_t count);
+extern	bool kern_sema_take(struct kern_sema *sema);
+extern	bool kern_sema_trytake(struct kern_sema *sema);
+extern	void kern_sema_give(struct kern_sema *sema);
+
+#endif	/* __KERN_SEMA_H__ */
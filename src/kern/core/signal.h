@@ -42,10 +42,31 @@ typedef uint32_t kern_task_signal_set_t;
  *          for tasks will get cleaned up in kern_task_exit().  If a
  *          task doesn't handle this signal then at some point ("when"
  *          is a great question here!) it will be terminated anyway.
+ *
+ * REAP - Posted to the kernel reaper task when a task has been moved
+ *          to the dying list and its resources need to be freed.
+ *
+ * KWAIT - Used by the kernel mutex and semaphore code to wake up a task
+ *          that was handed the mutex / semaphore it was sleeping on.
+ *
+ * CHILD_EXIT - Posted to the task that spawned a task when that
+ *          task exits.
+ *
+ * RING - Posted to a task when a completion is added to its async
+ *          syscall ring (and to the ring poller when there's a new
+ *          ring to poll.)
+ *
+ * WAIT_ANY - Used by kern_wait_any() to wake a task when one of the
+ *          message queues it's waiting on has something in it.
  */
 #define	KERN_SIGNAL_ALL_MASK			0xffffffff
 #define	KERN_SIGNAL_TASK_MASK			0x000000ff
 #define	KERN_SIGNAL_TASK_KSLEEP			BIT_U32(0)
 #define	KERN_SIGNAL_TASK_TERMINATE		BIT_U32(1)
+#define	KERN_SIGNAL_TASK_REAP			BIT_U32(2)
+#define	KERN_SIGNAL_TASK_KWAIT			BIT_U32(3)
+#define	KERN_SIGNAL_TASK_CHILD_EXIT		BIT_U32(4)
+#define	KERN_SIGNAL_TASK_RING			BIT_U32(5)
+#define	KERN_SIGNAL_TASK_WAIT_ANY		BIT_U32(6)
 
 #endif	/* __KERN_SIGNAL_H__ */
@@ -35,7 +35,12 @@
 #include <kern/core/malloc.h>
 #include <kern/core/logging.h>
 #include <kern/core/physmem.h>
+#include <kern/core/mutex.h>
+#include <kern/core/info_page.h>
 #include <kern/console/console.h>
+#include <kern/ipc/shm.h>
+#include <kern/ipc/msgq.h>
+#include <kern/ipc/ring.h>
 
 #include <core/platform.h>
 #include <core/lock.h>
@@ -67,8 +72,18 @@ static uint8_t kern_test_stack[PLATFORM_DEFAULT_KERN_STACK_SIZE]
 	    __attribute__ ((aligned(PLATFORM_DEFAULT_KERN_STACK_ALIGNMENT)))
 	     = { 0 };
 
+/*
+ * Reaper task - frees the resources of dying tasks.
+ */
+static struct kern_task reaper_task;
+static uint8_t kern_reaper_stack[PLATFORM_DEFAULT_KERN_STACK_SIZE]
+	    __attribute__ ((aligned(PLATFORM_DEFAULT_KERN_STACK_ALIGNMENT)))
+	     = { 0 };
+
 static void _kern_task_set_state_locked(struct kern_task *task,
     kern_task_state_t new_state);
+static void _kern_task_signal_locked(struct kern_task *task,
+    kern_task_signal_set_t sig_set);
 
 static void
 kern_task_timer_ev_fn(kern_timer_event_t *ev, void *arg1,
@@ -94,6 +109,25 @@ kern_task_timer_ev_fn(kern_timer_event_t *ev, void *arg1,
  */
 bool
 kern_task_timer_set(struct kern_task *task, uint32_t msec)
+{
+
+	return (kern_task_timer_set_slack(task, msec, 0));
+}
+
+/**
+ * Set the task timer to fire after 'msec' milliseconds, or up to
+ * 'slack_msec' after that if it can share a wakeup with another
+ * timer.  This is for periodic housekeeping that doesn't care
+ * exactly when it runs.
+ *
+ * @param[in] task kernel task
+ * @param[in] msec milliseconds before firing
+ * @param[in] slack_msec milliseconds it may be deferred by
+ * @retval true if set, false if couldn't set (eg is about to run)
+ */
+bool
+kern_task_timer_set_slack(struct kern_task *task, uint32_t msec,
+    uint32_t slack_msec)
 {
 	bool ret;
 
@@ -109,10 +143,104 @@ kern_task_timer_set(struct kern_task *task, uint32_t msec)
 	ret = kern_timer_event_del(&task->sleep_ev);
 	if (ret == false)
 		return (false);
-	ret = kern_timer_event_add(&task->sleep_ev, msec);
+	ret = kern_timer_event_add(&task->sleep_ev, msec, slack_msec);
 	return (ret);
 }
 
+/**
+ * Set the task timer to fire at an absolute tick.
+ *
+ * Same rules as kern_task_timer_set().
+ *
+ * @param[in] task kernel task
+ * @param[in] abs_msec kern_timer_tick_msec value to fire at
+ * @retval true if set, false if couldn't set (eg is about to run)
+ */
+bool
+kern_task_timer_set_abs(struct kern_task *task,
+    kern_timer_tick_type_t abs_msec)
+{
+	bool ret;
+
+	ret = kern_timer_event_del(&task->sleep_ev);
+	if (ret == false)
+		return (false);
+	ret = kern_timer_event_add_abs(&task->sleep_ev, abs_msec, 0);
+	return (ret);
+}
+
+/**
+ * Sleep until an absolute tick.  Only callable from the task itself.
+ *
+ * @param[in] abs_msec kern_timer_tick_msec value to sleep until
+ * @retval 0 if slept, 1 if abs_msec had already passed, -1 on error
+ */
+int
+kern_task_sleep_until(kern_timer_tick_type_t abs_msec)
+{
+	kern_task_signal_set_t sig;
+
+	if (kern_timer_tick_passed(abs_msec))
+		return (1);
+	if (kern_task_timer_set_abs(current_task, abs_msec) == false)
+		return (-1);
+
+	/* Something else may post KSLEEP; only stop at the deadline */
+	do {
+		sig = 0;
+		(void) kern_task_wait(KERN_SIGNAL_TASK_KSLEEP, &sig);
+	} while (kern_timer_tick_passed(abs_msec) == false);
+	return (0);
+}
+
+/**
+ * Start a fixed period loop; the first deadline is one period
+ * from now.
+ *
+ * @param[in] p period state
+ * @param[in] period_msec period in milliseconds
+ */
+void
+kern_task_period_init(struct kern_task_period *p, uint32_t period_msec)
+{
+
+	if (period_msec == 0)
+		period_msec = 1;
+	p->period = period_msec;
+	p->next = kern_timer_tick_msec + period_msec;
+	p->overruns = 0;
+}
+
+/**
+ * Sleep until the next period starts.
+ *
+ * Deadlines are a fixed number of periods from the start, so time
+ * spent running and waking up doesn't accumulate.  If the loop ran
+ * past one or more deadlines then those periods are skipped (rather
+ * than run back to back) and counted as overruns.  Arriving exactly
+ * on the deadline is on time; the next period just starts now.
+ *
+ * @param[in] p period state
+ * @retval number of periods missed since the last call, 0 if on time
+ */
+uint32_t
+kern_task_period_wait(struct kern_task_period *p)
+{
+	uint32_t now, missed = 0;
+
+	now = kern_timer_tick_msec;
+	if ((int32_t) (now - p->next) > 0) {
+		missed = (now - p->next - 1) / p->period + 1;
+		p->next += missed * p->period;
+		p->overruns += missed;
+	}
+
+	if (now != p->next)
+		(void) kern_task_sleep_until(p->next);
+	p->next += p->period;
+	return (missed);
+}
+
 void
 kern_task_generic_init(struct kern_task *task, const char *name)
 {
@@ -120,6 +248,12 @@ kern_task_generic_init(struct kern_task *task, const char *name)
 
 	list_node_init(&task->task_list_node);
 	list_node_init(&task->task_active_node);
+	list_node_init(&task->wait_node);
+	list_head_init(&task->held_mutex_list);
+	task->wait_mutex = NULL;
+	task->wait_sema = NULL;
+	task->wait_futex = NULL;
+	task->wait_futex_addr = 0;
 
 	task->is_on_active_list = false;
 	task->is_on_dying_list = false;
@@ -133,8 +267,15 @@ kern_task_generic_init(struct kern_task *task, const char *name)
 	 */
 	task->cur_state = KERN_TASK_STATE_IDLE;
 
+	task->priority = KERN_TASK_PRIORITY_DEFAULT;
+	task->base_priority = KERN_TASK_PRIORITY_DEFAULT;
+
 	/* Default signal mask */
 	task->sig_mask = KERN_SIGNAL_TASK_MASK;
+
+	task->parent_id = 0;
+	task->exit_notify_qid = KERN_MSGQ_ID_NONE;
+	task->exit_status = 0;
 }
 
 void
@@ -283,32 +424,22 @@ kern_task_start(struct kern_task *task)
 void
 kern_task_select(void)
 {
-	struct kern_task *task;
+	struct kern_task *task, *t;
 	struct list_node *node;
 
 	platform_spinlock_lock(&kern_task_spinlock);
-	/*
-	 * Special case - handle cleaning up dying tasks.
-	 * If we have any dying tasks on the list, then we
-	 * schedule the idle task immediately.  It'll then
-	 * handle cleanup and then switch again to see
-	 * if anything else is needed.
-	 */
-	if (dying_task_count > 0) {
-		task = NULL;
-		goto skip;
-	}
 
 	/*
-	 * Walk the list of active tasks.  For now we just pick the
-	 * task at the head of the list and we put it at the tail,
-	 * making this purely a round robin scheduler.
+	 * Walk the list of active tasks and pick the first task with
+	 * the highest priority.  It's then put at the tail of the list,
+	 * so tasks of the same priority are scheduled round robin.
 	 */
-	node = kern_task_active_list.head;
-	if (node == NULL) {
-		task = NULL;
-	} else {
-		task = container_of(node, struct kern_task, task_active_node);
+	task = NULL;
+	for (node = kern_task_active_list.head; node != NULL;
+	    node = node->next) {
+		t = container_of(node, struct kern_task, task_active_node);
+		if (task == NULL || t->priority > task->priority)
+			task = t;
 	}
 
 	/*
@@ -328,7 +459,6 @@ kern_task_select(void)
 	if (current_task->cur_state == KERN_TASK_STATE_RUNNING)
 		current_task->cur_state = KERN_TASK_STATE_READY;
 
-skip:
 	/* Update current task */
 	if (task != NULL) {
 		current_task = task;
@@ -344,6 +474,7 @@ skip:
 
 	/* Mark it as running */
 	current_task->cur_state = KERN_TASK_STATE_RUNNING;
+	kern_info_page_set_task(kern_task_to_id(current_task));
 
 	platform_spinlock_unlock(&kern_task_spinlock);
 
@@ -379,6 +510,12 @@ kern_task_cleanup(struct kern_task *task)
 {
 	KERN_LOG(LOG_TASK, KERN_LOG_LEVEL_INFO, "cleaning task 0x%08x", task);
 
+	/* Cancel async ring work; the ring memory is a shm region */
+	kern_ring_task_cleanup(task);
+
+	/* Drop any shared memory mappings / regions */
+	kern_shm_task_cleanup(task);
+
 	/* Clean up memory regions where required */
 	kern_task_mem_cleanup(&task->task_mem);
 
@@ -444,48 +581,44 @@ kern_reap_dying_tasks_locked(struct list_head *task_dead_list)
 	}
 }
 
+/**
+ * Reaper task.
+ *
+ * This sleeps until a task is moved to the dying list, then
+ * moves the dying tasks to a private list under the lock and
+ * frees their resources outside of it.
+ *
+ * Since it's just another low priority task, a dying task no
+ * longer forces the scheduler to pick the idle task; everything
+ * else keeps running while teardown happens.
+ */
 static void
-kern_idle_task_fn(void)
+kern_reaper_task_fn(void)
 {
 	struct list_head task_dead_list;
+	kern_task_signal_set_t sig;
 
 	list_head_init(&task_dead_list);
 
-	KERN_LOG(LOG_TASK, KERN_LOG_LEVEL_INFO, "[idle] started!");
+	KERN_LOG(LOG_TASK, KERN_LOG_LEVEL_INFO, "[reaper] started!");
 	while (1) {
-//		console_printf("[idle] entering idle!\n");
+		(void) kern_task_wait(KERN_SIGNAL_TASK_REAP, &sig);
 
-		/*
-		 * See if we have any idle tasks.
-		 * If we do then we finish clean-up here;
-		 * then yield immediately so the scheduler
-		 * gets another crack at it.
-		 *
-		 * Yeah, doing this spinlock to check sucks;
-		 * it'd be nicer if we had a separate kernel
-		 * task to reap dying tasks but that'd require
-		 * an extra kernel task + stack.
-		 *
-		 * Also it would be nice to move them to a private
-		 * list and delete them from the global list, and
-		 * then do the freeing bit without having the spinlock held.
-		 * Maybe do that in the future when we have dynamic
-		 * memory allocation working.
-		 */
 		platform_spinlock_lock(&kern_task_spinlock);
-		if (dying_task_count > 0) {
-			/* Reap them, ready to clean-up */
-			kern_reap_dying_tasks_locked(&task_dead_list);
-			platform_spinlock_unlock(&kern_task_spinlock);
+		kern_reap_dying_tasks_locked(&task_dead_list);
+		platform_spinlock_unlock(&kern_task_spinlock);
 
-			/* Clean-up outside of the lock */
-			kern_cleanup_dying_tasks(&task_dead_list);
+		/* Clean-up outside of the lock */
+		kern_cleanup_dying_tasks(&task_dead_list);
+	}
+}
 
-			platform_kick_context_switch();
-			continue;
-		}
-		platform_spinlock_unlock(&kern_task_spinlock);
+static void
+kern_idle_task_fn(void)
+{
 
+	KERN_LOG(LOG_TASK, KERN_LOG_LEVEL_INFO, "[idle] started!");
+	while (1) {
 		/*
 		 * if we get to the idle scheduler loop
 		 * then it means nothing else needed to
@@ -570,8 +703,7 @@ _kern_task_set_state_locked(struct kern_task *task,
 	case KERN_TASK_STATE_DYING:
 		/*
 		 * Dying tasks will get moved to the dying list; they won't
-		 * be scheduled, and then the task switcher / idle loop
-		 * will clean it up.
+		 * be scheduled, and then the reaper task will clean it up.
 		 */
 		if (task->is_on_active_list) {
 			list_delete(&kern_task_active_list,
@@ -590,6 +722,8 @@ _kern_task_set_state_locked(struct kern_task *task,
 			dying_task_count++;
 			list_add_tail(&kern_task_dying_list,
 			    &task->task_active_node);
+			_kern_task_signal_locked(&reaper_task,
+			    KERN_SIGNAL_TASK_REAP);
 		}
 		do_ctx = true;
 		break;
@@ -643,12 +777,23 @@ kern_task_setup(void)
 	platform_spinlock_init(&kern_task_spinlock);
 	list_head_init(&kern_task_list);
 	list_head_init(&kern_task_active_list);
+	list_head_init(&kern_task_dying_list);
 	active_task_count = 0;
+	dying_task_count = 0;
 
 	/* Idle task will be magically made ready to run */
 	kern_task_init(&idle_task, kern_idle_task_fn, NULL, "kidle",
 	    (stack_addr_t) kern_idle_stack, sizeof(kern_idle_stack),
 	    0);
+	idle_task.priority = idle_task.base_priority =
+	    KERN_TASK_PRIORITY_IDLE;
+
+	/* Reaper task sleeps until there's something to clean up */
+	kern_task_init(&reaper_task, kern_reaper_task_fn, NULL, "kreaper",
+	    (stack_addr_t) kern_reaper_stack, sizeof(kern_reaper_stack),
+	    0);
+	reaper_task.priority = reaper_task.base_priority =
+	    KERN_TASK_PRIORITY_REAPER;
 
 	/* Test task will be made ready to run as well */
 	kern_task_init(&test_task, kern_test_task_fn, NULL, "ktest",
@@ -656,20 +801,33 @@ kern_task_setup(void)
 	    0);
 
 	KERN_LOG(LOG_TASK, KERN_LOG_LEVEL_CRIT,
-	    "[setup] idle task=0x%x, test task=0x%x\n",
-	    &idle_task, &test_task);
+	    "[setup] idle task=0x%x, reaper task=0x%x, test task=0x%x\n",
+	    &idle_task, &reaper_task, &test_task);
 
+	kern_task_start(&reaper_task);
 	kern_task_start(&test_task);
 }
 
+/*
+ * Lookup the given task id.
+ *
+ * Task ids can come from userland, so check that it's actually
+ * a task on the global task list before handing it back.
+ */
 static struct kern_task *
 _kern_task_lookup_locked(kern_task_id_t task_id)
 {
 	struct kern_task *task;
+	struct list_node *node;
 
-	task = (struct kern_task *) (uintptr_t) task_id;
-	kern_task_refcount_inc(task);
-	return (task);
+	for (node = kern_task_list.head; node != NULL; node = node->next) {
+		task = container_of(node, struct kern_task, task_list_node);
+		if (kern_task_to_id(task) == task_id) {
+			kern_task_refcount_inc(task);
+			return (task);
+		}
+	}
+	return (NULL);
 }
 
 struct kern_task *
@@ -708,12 +866,66 @@ kern_task_refcount_dec(struct kern_task *task)
 	task->refcount--;
 }
 
+/**
+ * Set who is told when the given task exits.
+ *
+ * This must be called before the task is started; nothing here
+ * is locked against the task exiting.
+ */
+void
+kern_task_set_parent(struct kern_task *task, kern_task_id_t parent_id,
+    uint32_t notify_qid)
+{
+
+	task->parent_id = parent_id;
+	task->exit_notify_qid = notify_qid;
+}
+
+/*
+ * Tell whoever spawned the current task that it's exiting.
+ *
+ * The notification is sent non-blocking; if the queue is full
+ * the parent still gets the signal, just not the status.
+ */
+static void
+kern_task_exit_notify(void)
+{
+	struct kern_msg msg = { 0 };
+	kern_error_t ret;
+
+	if (current_task->parent_id == 0)
+		return;
+
+	if (current_task->exit_notify_qid != KERN_MSGQ_ID_NONE) {
+		msg.type = KERN_TASK_MSG_TYPE_EXIT;
+		msg.arg[0] = kern_task_to_id(current_task);
+		msg.arg[1] = current_task->exit_status;
+		ret = kern_msgq_send(current_task->exit_notify_qid, &msg,
+		    KERN_MSGQ_FLAG_NONBLOCK);
+		if (ret != KERN_ERR_OK) {
+			KERN_LOG(LOG_TASK, KERN_LOG_LEVEL_NOTICE,
+			    "[task] %s: task 0x%x couldn't post exit status"
+			    " (%d)", __func__, current_task, ret);
+		}
+	}
+
+	(void) kern_task_signal(current_task->parent_id,
+	    KERN_SIGNAL_TASK_CHILD_EXIT);
+}
+
+void
+kern_task_exit_status(uint32_t status)
+{
+
+	current_task->exit_status = status;
+	kern_task_exit();
+}
+
 /**
  * Mark the current task as dying.
  *
  * This will move the current task to the dead list; the
- * task switch and idle task will take care of cleaning
- * up said task.
+ * reaper task will take care of cleaning up said task.
  *
  * This must be called from the task context itself;
  * it must not be called from another context.
@@ -721,6 +933,7 @@ kern_task_refcount_dec(struct kern_task *task)
 void
 kern_task_exit(void)
 {
+	struct kern_mutex *mtx;
 
 	KERN_LOG(LOG_TASK, KERN_LOG_LEVEL_CRIT,
 	    "[task] %s: called, task 0x%x", __func__,
@@ -736,6 +949,22 @@ kern_task_exit(void)
 	kern_timer_event_del(&current_task->sleep_ev);
 	kern_timer_event_clean(&current_task->sleep_ev);
 
+	/*
+	 * Release any mutexes still held so whatever is waiting on
+	 * them gets handed ownership rather than sleeping forever.
+	 * Whatever they protect may be half updated, so shout.
+	 */
+	while (current_task->held_mutex_list.head != NULL) {
+		mtx = container_of(current_task->held_mutex_list.head,
+		    struct kern_mutex, owner_node);
+		KERN_LOG(LOG_TASK, KERN_LOG_LEVEL_CRIT,
+		    "[task] %s: task 0x%x exiting with %s held!",
+		    __func__, current_task, mtx->name);
+		kern_mutex_unlock(mtx);
+	}
+
+	kern_task_exit_notify();
+
 	platform_spinlock_lock(&kern_task_spinlock);
 	kern_task_set_state_locked(KERN_TASK_STATE_DYING);
 	platform_spinlock_unlock(&kern_task_spinlock);
@@ -851,6 +1080,28 @@ kern_task_wait(kern_task_signal_mask_t sig_mask,
 	return (0);
 }
 
+/**
+ * Take any of the given signals that are already set, without
+ * waiting.  Only callable from the task itself.
+ *
+ * Any signals that are returned will be cleared.
+ *
+ * @param[in] sig_mask mask for signals to check
+ * @retval set of signals that were set
+ */
+kern_task_signal_set_t
+kern_task_signal_take(kern_task_signal_mask_t sig_mask)
+{
+	kern_task_signal_set_t sigs;
+
+	platform_spinlock_lock(&kern_task_spinlock);
+	sigs = current_task->sig_set & sig_mask & current_task->sig_mask;
+	current_task->sig_set &= ~sigs;
+	platform_spinlock_unlock(&kern_task_spinlock);
+
+	return (sigs);
+}
+
 static int
 _kern_task_state_valid_locked(struct kern_task *task)
 {
@@ -875,6 +1126,42 @@ _kern_task_wakeup_locked(struct kern_task *task)
 	}
 }
 
+/**
+ * Set signals on the given task and wake it up if required.
+ *
+ * Called with the kern_task_spinlock held; this is for callers
+ * which already hold the lock and thus can't call kern_task_signal().
+ */
+static void
+_kern_task_signal_locked(struct kern_task *task,
+    kern_task_signal_set_t sig_set)
+{
+	if (! _kern_task_state_valid_locked(task)) {
+		KERN_LOG(LOG_TASK, KERN_LOG_LEVEL_CRIT,
+		    "[task] signal: invalid state (%d)",
+		    task->cur_state);
+		return;
+	}
+
+	task->sig_set |= sig_set;
+
+	if ((task->sig_set & task->sig_mask) != 0)
+		_kern_task_wakeup_locked(task);
+}
+
+/**
+ * Signal the given task; called with the task lock held.
+ *
+ * This is for the mutex / semaphore code which needs to hand
+ * ownership to a waiter and wake it up atomically.
+ */
+void
+kern_task_signal_task_locked(struct kern_task *task,
+    kern_task_signal_set_t sig_set)
+{
+	_kern_task_signal_locked(task, sig_set);
+}
+
 /**
  * Signal the given task.
  *
@@ -1026,3 +1313,80 @@ kern_task_ready(void)
 {
 	task_switch_ready = true;
 }
+
+/**
+ * Acquire / release the task lock.
+ *
+ * This is the same lock which protects the run queues and task
+ * signal state.  It's a spinlock so it's safe to call from
+ * interrupt context, but it must only be held briefly.
+ */
+void
+kern_task_lock(void)
+{
+	platform_spinlock_lock(&kern_task_spinlock);
+}
+
+void
+kern_task_unlock(void)
+{
+	platform_spinlock_unlock(&kern_task_spinlock);
+}
+
+/**
+ * Return whether the scheduler is running and there's a current
+ * task which can sleep.
+ *
+ * Before this the system is single threaded, so the sleeping
+ * synchronisation primitives don't need to do anything.
+ */
+bool
+kern_task_sched_running(void)
+{
+	return (task_switch_ready && current_task != NULL);
+}
+
+/**
+ * Add a task to a wait queue, sorted by priority.
+ *
+ * Tasks of the same priority are kept in FIFO order.
+ * Must be called with the task lock held.
+ *
+ * @param[in] waitq wait queue to add the task to
+ * @param[in] task task to add
+ */
+void
+kern_task_waitq_add_locked(struct list_head *waitq, struct kern_task *task)
+{
+	struct list_node *node;
+	struct kern_task *t;
+
+	for (node = waitq->head; node != NULL; node = node->next) {
+		t = container_of(node, struct kern_task, wait_node);
+		if (task->priority > t->priority) {
+			list_add_before(waitq, node, &task->wait_node);
+			return;
+		}
+	}
+	list_add_tail(waitq, &task->wait_node);
+}
+
+/**
+ * Set the base priority of the given task.
+ *
+ * The effective priority is then recalculated, taking into
+ * account any higher priority tasks waiting on mutexes it holds.
+ *
+ * @param[in] task task to update
+ * @param[in] priority new base priority; 255 is highest
+ */
+void
+kern_task_set_priority(struct kern_task *task, uint8_t priority)
+{
+	platform_spinlock_lock(&kern_task_spinlock);
+	task->base_priority = priority;
+	kern_mutex_task_priority_update_locked(task);
+	if (task_switch_ready)
+		platform_kick_context_switch();
+	platform_spinlock_unlock(&kern_task_spinlock);
+}
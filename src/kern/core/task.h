@@ -44,6 +44,23 @@
 /* enable the MPU for a userland task */
 #define	TASK_FLAGS_ENABLE_MPU			BIT_U32(3)
 
+/*
+ * Task priorities.  255 is the highest priority.
+ *
+ * The reaper runs below everything else so freeing dying tasks
+ * never gets in the way of tasks that have work to do.
+ */
+#define	KERN_TASK_PRIORITY_IDLE			0
+#define	KERN_TASK_PRIORITY_REAPER		16
+#define	KERN_TASK_PRIORITY_DEFAULT		128
+
+/*
+ * Message type posted to a task's exit notification queue when
+ * it exits; arg[0] is the task id, arg[1] the exit status.
+ * Kernel generated message types live at the top of the type space.
+ */
+#define	KERN_TASK_MSG_TYPE_EXIT			0xffff0001
+
 /*
  * The top three entries are very /specifically/ ordered for
  * the assembly routines for task switching and syscalls.
@@ -62,11 +79,15 @@
  * kernel syscall side.
  */
 
+struct kern_mutex;
+struct kern_sema;
+
 struct kern_task {
 	/* Fields used by the assembly routines */
 	volatile stack_addr_t stack_top;
 	volatile stack_addr_t kern_stack_top;
 	volatile stack_addr_t syscall_return_address;
+	volatile uint32_t syscall_id;
 
 	uint32_t task_flags;
 
@@ -97,9 +118,29 @@ struct kern_task {
 	 */
 	uint16_t refcount;
 
-	/* Current priority.  255 is the highest priority. */
+	/*
+	 * Current priority.  255 is the highest priority.
+	 *
+	 * This is the base priority, boosted by priority inheritance
+	 * whilst a higher priority task waits on a mutex we hold.
+	 */
 	uint8_t priority;
-	uint8_t pad0;
+	uint8_t base_priority;
+
+	/*
+	 * Mutex / semaphore / futex wait state.  wait_node is on the
+	 * waiters list of whichever of wait_mutex / wait_sema /
+	 * wait_futex is set; the waker clears it when handing over
+	 * ownership.  wait_futex_addr is the futex word being waited on.
+	 */
+	struct list_node wait_node;
+	struct kern_mutex * volatile wait_mutex;
+	struct kern_sema * volatile wait_sema;
+	struct list_head * volatile wait_futex;
+	uaddr_t wait_futex_addr;
+
+	/* Mutexes currently held, for priority inheritance */
+	struct list_head held_mutex_list;
 
 	/* Timer for sleeping */
 	struct kern_timer_event sleep_ev;
@@ -113,6 +154,15 @@ struct kern_task {
 	 */
 	volatile kern_task_signal_set_t sig_set;
 	volatile kern_task_signal_mask_t sig_mask;
+
+	/*
+	 * The task that spawned us (if any) is sent
+	 * KERN_SIGNAL_TASK_CHILD_EXIT when we exit, and if
+	 * exit_notify_qid is set, a KERN_TASK_MSG_TYPE_EXIT message.
+	 */
+	kern_task_id_t parent_id;
+	uint32_t exit_notify_qid;
+	uint32_t exit_status;
 };
 
 /**
@@ -170,6 +220,24 @@ extern	void kern_task_refcount_dec(struct kern_task *task);
  */
 extern	void kern_task_exit(void);
 
+/**
+ * Exit a task with the given status, which is reported to
+ * whoever spawned it.  This is only callable from the task itself.
+ */
+extern	void kern_task_exit_status(uint32_t status);
+
+/**
+ * Set who is told when the given task exits.  This must be
+ * called before the task is started.
+ *
+ * @param task task to set the parent of
+ * @param parent_id task to signal on exit, or 0 for none
+ * @param notify_qid message queue to post the exit status to,
+ *   or KERN_MSGQ_ID_NONE
+ */
+extern	void kern_task_set_parent(struct kern_task *task,
+	    kern_task_id_t parent_id, uint32_t notify_qid);
+
 /**
  * Kill the given task id.
  *
@@ -187,6 +255,50 @@ extern	void kern_task_kill(kern_task_id_t task_id);
  * @retval true if ok, false if couldn't set the timer.
  */
 extern	bool kern_task_timer_set(struct kern_task *task, uint32_t msec);
+extern	bool kern_task_timer_set_slack(struct kern_task *task, uint32_t msec,
+	    uint32_t slack_msec);
+extern	bool kern_task_timer_set_abs(struct kern_task *task,
+	    kern_timer_tick_type_t abs_msec);
+
+/**
+ * Sleep until an absolute kern_timer_tick_msec.  Only callable from
+ * the task itself.
+ */
+extern	int kern_task_sleep_until(kern_timer_tick_type_t abs_msec);
+
+/**
+ * struct kern_task_period - state for a drift free periodic loop.
+ *
+ * @next tick the next period starts at
+ * @period period in milliseconds
+ * @overruns total periods missed because the loop ran late
+ */
+struct kern_task_period {
+	kern_timer_tick_type_t next;
+	uint32_t period;
+	uint32_t overruns;
+};
+
+extern	void kern_task_period_init(struct kern_task_period *p,
+	    uint32_t period_msec);
+extern	uint32_t kern_task_period_wait(struct kern_task_period *p);
+
+/**
+ * Set the base priority of a task.
+ */
+extern	void kern_task_set_priority(struct kern_task *task, uint8_t priority);
+
+/*
+ * These are for the sleeping synchronisation primitives (mutexes,
+ * semaphores) which are built on top of the task wait/signal path.
+ */
+extern	void kern_task_lock(void);
+extern	void kern_task_unlock(void);
+extern	bool kern_task_sched_running(void);
+extern	void kern_task_signal_task_locked(struct kern_task *task,
+	    kern_task_signal_set_t sig_set);
+extern	void kern_task_waitq_add_locked(struct list_head *waitq,
+	    struct kern_task *task);
 
 /**
  * Wait for a signal.  Only callable from the task itself.
@@ -197,6 +309,13 @@ extern	bool kern_task_timer_set(struct kern_task *task, uint32_t msec);
 extern	int kern_task_wait(kern_task_signal_mask_t sig_mask,
 	    kern_task_signal_set_t *sig_set);
 
+/**
+ * Take any already set signals, without waiting.  Only callable from
+ * the task itself.
+ */
+extern	kern_task_signal_set_t kern_task_signal_take(
+	    kern_task_signal_mask_t sig_mask);
+
 /**
  * Signal the given task.
  *
@@ -23,6 +23,8 @@
 #include <kern/core/signal.h>
 #include <kern/core/timer.h>
 
+#include <hw/prot.h>
+
 #include <kern/core/task_defs.h>
 
 struct kern_task;
@@ -36,6 +38,10 @@ extern	paddr_size_t kern_task_mem_get_size(struct task_mem *tm,
 	     task_mem_id_t id);
 extern	void kern_task_mem_cleanup(struct task_mem *tm);
 extern	bool kern_task_mem_setup_mpu(struct kern_task *task);
+extern	bool kern_task_mem_mpu_map(struct kern_task *task, paddr_t addr,
+	    paddr_size_t size, platform_prot_type_t prot, int *slot);
+extern	void kern_task_mem_mpu_unmap(struct kern_task *task, int slot);
+extern	bool kern_task_mem_arena_remap(struct kern_task *task);
 
 extern	void kern_task_mem_transfer(struct task_mem *dst, struct task_mem *src);
 
@@ -32,7 +32,10 @@
 extern	bool platform_user_task_mem_allocate(const struct user_exec_program_header *hdr,
 	    struct user_exec_program_addrs *addrs,
 	    struct task_mem *mem,
+	    uint32_t lib_size,
 	    bool require_mpu);
+extern	bool platform_user_task_heap_grow(struct kern_task *task,
+	    uint32_t len, paddr_t *addr, paddr_size_t *size);
 
 
 #endif	/* __USER_TASK_MEM_ALLOC_H__ */
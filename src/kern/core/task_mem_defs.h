@@ -63,8 +63,19 @@ typedef enum {
 	/* user GOT */
 	TASK_MEM_ID_USER_GOT = 7,
 
-	TASK_MEM_ID_MAX = 7,
-	TASK_MEM_ID_NUM = 8,
+	/*
+	 * Single user RAM allocation containing the GOT, stack,
+	 * data, BSS and heap.  If this is set then the individual
+	 * user segments above point inside it and aren't freed
+	 * on their own.
+	 */
+	TASK_MEM_ID_USER_ARENA = 8,
+
+	/* executable region for a shared library */
+	TASK_MEM_ID_LIB_TEXT = 9,
+
+	TASK_MEM_ID_MAX = 9,
+	TASK_MEM_ID_NUM = 10,
 } task_mem_id_t;
 
 struct task_mem {
@@ -28,6 +28,8 @@
 
 #include <kern/core/exception.h>
 #include <kern/core/timer.h>
+#include <kern/core/info_page.h>
+#include <kern/core/logging.h>
 #include <kern/console/console.h>
 
 #include <core/platform.h>
@@ -46,6 +48,16 @@ static struct list_head timer_list;
 
 static bool kern_timer_running = false;
 
+static struct kern_timer_stats kern_timer_stats;
+
+LOGGING_DEFINE(LOG_TIMER, "timer", KERN_LOG_LEVEL_INFO);
+
+/*
+ * The timer list is sorted by the end of each event's slack window,
+ * so the head is always the next event that has to run.
+ */
+#define	kern_timer_event_latest(e)	((e)->tick + (e)->slack)
+
 /**
  * Return true if a is after b
  */
@@ -154,27 +166,52 @@ kern_timer_tick(void)
 	struct list_head list;
 	struct list_node *n, *m;
 	kern_timer_event_t *e;
+	kern_timer_tick_type_t latest = 0;
+	bool have_latest = false;
 
 	list_head_init(&list);
 
 	platform_spinlock_lock(&timer_lock);
 	kern_timer_tick_msec += kern_timer_msec;
+	kern_info_page_tick(kern_timer_tick_msec, kern_timer_msec);
 
-	/* Walk the list, look for events to run */
+	/*
+	 * Only wake things up if the head event has reached the end
+	 * of its slack window.  If it has, then run everything whose
+	 * window has opened; those that aren't due yet would otherwise
+	 * have needed a wakeup of their own later on.  Early events
+	 * sharing the same deadline would've shared a wakeup anyway,
+	 * so only count each deadline once.
+	 */
 	n = timer_list.head;
-
-	/* Don't yet have a safe iterator, so just keep checking head */
-	while (timer_list.head != NULL) {
-		n = timer_list.head;
+	if (n != NULL) {
 		e = container_of(n, kern_timer_event_t, node);
-		if (kern_timer_before_eq(e->tick, kern_timer_tick_msec)) {
-			list_delete(&timer_list, n);
-			/* We're not on the queue now, but we're active! */
-			e->queued = false;
-			e->active = true;
-			list_add_tail(&list, n);
-		} else {
-			break;
+		if (kern_timer_after(kern_timer_event_latest(e),
+		    kern_timer_tick_msec))
+			n = NULL;
+	}
+	if (n != NULL)
+		kern_timer_stats.wakeups++;
+	for (; n != NULL; n = m) {
+		m = n->next;
+		e = container_of(n, kern_timer_event_t, node);
+		if (kern_timer_after(e->tick, kern_timer_tick_msec))
+			continue;
+
+		list_delete(&timer_list, n);
+		/* We're not on the queue now, but we're active! */
+		e->queued = false;
+		e->active = true;
+		list_add_tail(&list, n);
+
+		kern_timer_stats.events++;
+		if (kern_timer_after(kern_timer_event_latest(e),
+		    kern_timer_tick_msec) &&
+		    (have_latest == false ||
+		    latest != kern_timer_event_latest(e))) {
+			kern_timer_stats.saved++;
+			latest = kern_timer_event_latest(e);
+			have_latest = true;
 		}
 	}
 	platform_spinlock_unlock(&timer_lock);
@@ -320,6 +357,7 @@ kern_timer_event_setup(kern_timer_event_t *event,
 	event->arg2 = arg2;
 	event->arg3 = arg3;
 	event->tick = 0;
+	event->slack = 0;
 	event->queued = false;
 	event->active = false;
 	event->rearm = false;
@@ -348,14 +386,36 @@ kern_timer_event_clean(kern_timer_event_t *event)
  *
  * @param[event] timer event to add
  * @param[msec] milliseconds after now before firing
+ * @param[slack_msec] milliseconds after that it may be deferred
+ * @retval true if added, false if not added
+ */
+bool
+kern_timer_event_add(kern_timer_event_t *event, uint32_t msec,
+    uint32_t slack_msec)
+{
+
+	return (kern_timer_event_add_abs(event, msec + kern_timer_tick_msec,
+	    slack_msec));
+}
+
+/**
+ * Add the given event to fire at an absolute tick.
+ *
+ * This is for periodic work; re-arming at the previous deadline plus
+ * the period doesn't pick up the time taken to get around to it.
+ * A tick that's already passed fires on the next timer tick.
+ *
+ * @param[event] timer event to add
+ * @param[abs_msec] kern_timer_tick_msec value to fire at
+ * @param[slack_msec] milliseconds after that it may be deferred
  * @retval true if added, false if not added
  */
 bool
-kern_timer_event_add(kern_timer_event_t *event, uint32_t msec)
+kern_timer_event_add_abs(kern_timer_event_t *event,
+    kern_timer_tick_type_t abs_msec, uint32_t slack_msec)
 {
 	struct list_node *n;
 	kern_timer_event_t *e;
-	uint32_t abs_msec = msec + kern_timer_tick_msec;
 	bool ret = true;
 
 	platform_spinlock_lock(&timer_lock);
@@ -374,7 +434,8 @@ kern_timer_event_add(kern_timer_event_t *event, uint32_t msec)
 	/* List has at least one node in it */
 	for (n = timer_list.head; n != NULL; n = n->next) {
 		e = container_of(n, kern_timer_event_t, node);
-		if (kern_timer_after_eq(e->tick, abs_msec))
+		if (kern_timer_after_eq(kern_timer_event_latest(e),
+		    abs_msec + slack_msec))
 			break;
 	}
 
@@ -386,6 +447,7 @@ kern_timer_event_add(kern_timer_event_t *event, uint32_t msec)
 
 done:
 	event->tick = abs_msec;
+	event->slack = slack_msec;
 	event->queued = true;
 	event->active = false;
 	event->rearm = false;
@@ -442,3 +504,28 @@ done:
 
 	return (ret);
 }
+
+/**
+ * Fetch a snapshot of the timer statistics.
+ */
+void
+kern_timer_get_stats(struct kern_timer_stats *stats)
+{
+	platform_spinlock_lock(&timer_lock);
+	*stats = kern_timer_stats;
+	platform_spinlock_unlock(&timer_lock);
+}
+
+/**
+ * Log the timer statistics.
+ */
+void
+kern_timer_dump_stats(void)
+{
+	struct kern_timer_stats st;
+
+	kern_timer_get_stats(&st);
+	KERN_LOG(LOG_TIMER, KERN_LOG_LEVEL_NOTICE,
+	    "wakeups %u, events %u, wakeups saved by slack %u",
+	    st.wakeups, st.events, st.saved);
+}
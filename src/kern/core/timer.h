@@ -39,6 +39,8 @@ typedef	void kern_timer_event_fn_t(kern_timer_event_t *ev, void *arg1,
  * @arg2 arg2 to pass to fn
  * @arg3 arg3 to pass to fn
  * @tick absolute tick value in msec to schedule to run
+ * @slack msec after tick that it's ok to run, so it can share a
+ *   wakeup with another event
  * @queued true if queued to the timer list
  * @active true if running the timer callback
  * @rearm true if rearm-ed from inside the callback function
@@ -54,11 +56,26 @@ struct kern_timer_event {
 	uintptr_t arg2;
 	uint32_t arg3;
 	uint32_t tick;
+	uint32_t slack;
 	bool queued;
 	bool active;
 	bool rearm;
 };
 
+/**
+ * struct kern_timer_stats - timer wakeup statistics.
+ *
+ * @wakeups ticks which ran timer events
+ * @events timer events run
+ * @saved wakeups saved by running events early, inside their
+ *   slack, alongside an event that was due
+ */
+struct kern_timer_stats {
+	uint32_t wakeups;
+	uint32_t events;
+	uint32_t saved;
+};
+
 extern	void kern_timer_init(void);
 extern	void kern_timer_set_tick_interval(uint32_t msec);
 extern	void kern_timer_start(void);
@@ -80,9 +97,32 @@ extern	void kern_timer_event_clean(kern_timer_event_t *event);
  * later.
  *
  * Can't be called from within the timer callback!
+ *
+ * slack_msec lets the event run up to that much later than asked,
+ * so housekeeping timers can be batched into one wakeup; use 0 for
+ * an exact timer.
  */
 extern	bool kern_timer_event_add(kern_timer_event_t *event,
-	    uint32_t msec);
+	    uint32_t msec, uint32_t slack_msec);
+
+/**
+ * Add a timer event to fire at an absolute kern_timer_tick_msec.
+ *
+ * Same rules as kern_timer_event_add().
+ */
+extern	bool kern_timer_event_add_abs(kern_timer_event_t *event,
+	    kern_timer_tick_type_t abs_msec, uint32_t slack_msec);
+
+/**
+ * Return true if the given absolute tick has been reached.
+ */
+static inline bool
+kern_timer_tick_passed(kern_timer_tick_type_t abs_msec)
+{
+
+	return ((kern_timer_tick_comp_type_t)
+	    (abs_msec - kern_timer_tick_msec) <= 0);
+}
 
 /**
  * Delete a timer event.
@@ -95,4 +135,7 @@ extern	bool kern_timer_event_add(kern_timer_event_t *event,
  */
 extern	bool kern_timer_event_del(kern_timer_event_t *event);
 
+extern	void kern_timer_get_stats(struct kern_timer_stats *stats);
+extern	void kern_timer_dump_stats(void);
+
 #endif	/* __KERN_TIMER_H__ */
@@ -28,14 +28,28 @@
 #include <kern/libraries/mem/mem.h>
 #include <kern/libraries/string/string.h>
 #include <kern/libraries/align/align_paddr.h>
+#include <kern/libraries/hash/fnv1a.h>
+#include <kern/libraries/crc32/crc32b.h>
+#include <kern/libraries/lz4/lz4.h>
+
+#include <kern/core/physmem.h>
+#include <kern/core/logging.h>
+
+#include <core/platform.h>
 
 #include <kern/flash/flash_resource.h>
 #include <kern/flash/flash_resource_header.h>
 #include <kern/flash/flash_resource_pak.h>
 
+LOGGING_DEFINE(LOG_FLASH, "flash", KERN_LOG_LEVEL_INFO);
+
 /*
  * Check the pak at the given location.  Populate the header
  * and return true if it's valid.
+ *
+ * This is silent.  It's only used for the initial scan; lookups
+ * are filled in from the index.  If label is not NULL then the
+ * label is copied out into it.
  */
 bool
 flash_resource_check_pak(paddr_t start, struct flash_resource_pak *pak,
@@ -47,10 +61,6 @@ flash_resource_check_pak(paddr_t start, struct flash_resource_pak *pak,
 	/* XXX TODO: these really need to be converted to le32! */
 	kern_memcpy(&val, s, sizeof(uint32_t));
 	if (val != ENTRY_MAGIC) {
-		console_printf("[flash] invalid magic at 0x%x (found 0x%x, expected 0x%x)\n",
-		    start,
-		    val,
-		    ENTRY_MAGIC);
 		return (false);
 	}
 
@@ -68,29 +78,271 @@ flash_resource_check_pak(paddr_t start, struct flash_resource_pak *pak,
 	kern_memcpy(&val, s, sizeof(uint32_t)); /* le32 */ pak->hdr.alignment = val; s = s + sizeof(uint32_t);
 	kern_memcpy(&val, s, sizeof(uint32_t)); /* le32 */ pak->hdr.namelength = val; s = s + sizeof(uint32_t);
 	kern_memcpy(&val, s, sizeof(uint32_t)); /* le32 */ pak->hdr.payload_length = val; s = s + sizeof(uint32_t);
-	kern_memcpy(&val, s, sizeof(uint32_t)); /* le32 */ pak->hdr.rsv0 = val; s = s + sizeof(uint32_t);
+	kern_memcpy(&val, s, sizeof(uint32_t)); /* le32 */ pak->hdr.flags = val; s = s + sizeof(uint32_t);
 
-	/* XXX TODO: crc32b check */
-
-	/* XXX TODO: should extend miniprintf to include %.*s */
+	/* The payload CRC is checked once, in flash_resource_span_init() */
 
 	/*
 	 * The string starts at the end of the header, no alignment
 	 * requirements.
 	 */
-	kern_strlcpyn(label, s, labellen, pak->hdr.namelength);
-
-	console_printf("[console] pak: %s@0x%x %d byte payload, %d byte total length\n",
-	    label,
-	    s,
-	    pak->hdr.payload_length,
-	    pak->hdr.length);
+	if (label != NULL)
+		kern_strlcpyn(label, s, labellen, pak->hdr.namelength);
 
 	/* Payload starts at aligned value after the start + hdr + string */
 	pak->payload_start =
 	    align_paddr_t(start + HEADER_SIZE + pak->hdr.namelength,
 	    pak->hdr.alignment);
 	pak->payload_size = pak->hdr.payload_length;
+	pak->start = start;
+
+	return (true);
+}
+
+/**
+ * Return the flash region covering an MPU aligned pak payload.
+ *
+ * make_entry aligns these payloads to a single MPU region and pads
+ * them out to the region size, so the region runs from the payload
+ * start to the end of the pak.
+ *
+ * @param[in] pak pak to check
+ * @param[out] start region start
+ * @param[out] size region size
+ * @retval true if the pak payload is MPU aligned, false otherwise
+ */
+bool
+flash_resource_pak_mpu_region(const struct flash_resource_pak *pak,
+    paddr_t *start, paddr_size_t *size)
+{
+	if ((pak->hdr.flags & FLASH_RESOURCE_FLAG_MPU_ALIGNED) == 0)
+		return (false);
+	if (pak->hdr.alignment == 0 ||
+	    (pak->payload_start % pak->hdr.alignment) != 0)
+		return (false);
+
+	*start = pak->payload_start;
+	*size = pak->start + pak->hdr.length - pak->payload_start;
+	return (true);
+}
+
+/**
+ * Return the payload compression type (FLASH_RESOURCE_COMP_*).
+ */
+uint32_t
+flash_resource_pak_compression(const struct flash_resource_pak *pak)
+{
+
+	return ((pak->hdr.flags & FLASH_RESOURCE_FLAG_COMP_M) >>
+	    FLASH_RESOURCE_FLAG_COMP_S);
+}
+
+/**
+ * Return the uncompressed payload size.
+ */
+size_t
+flash_resource_pak_raw_size(const struct flash_resource_pak *pak)
+{
+	uint32_t val;
+
+	if (flash_resource_pak_compression(pak) == FLASH_RESOURCE_COMP_NONE)
+		return (pak->payload_size);
+	if (pak->payload_size < FLASH_RESOURCE_COMP_HDR_SIZE)
+		return (0);
+
+	/* XXX TODO: le32 */
+	kern_memcpy(&val, (const char *) pak->payload_start, sizeof(val));
+	return (val);
+}
+
+/**
+ * Read a pak payload into the given buffer.
+ *
+ * Raw payloads are copied; compressed payloads are decompressed
+ * straight from flash into the buffer, so there's no other working
+ * memory.  The throughput is logged so raw vs compressed (and XIP
+ * vs RAM) can be compared per resource.
+ *
+ * @param[in] pak pak to read
+ * @param[in] dst destination buffer
+ * @param[in] dst_len destination buffer size; must be at least
+ *   flash_resource_pak_raw_size()
+ * @retval true if read, false on a corrupt / unknown payload or if
+ *   it doesn't fit
+ */
+bool
+flash_resource_pak_read(const struct flash_resource_pak *pak,
+    void *dst, size_t dst_len)
+{
+	const char *src = (const char *) pak->payload_start;
+	uint32_t comp, start, cycles, freq;
+	size_t raw_size;
+	int ret;
+
+	comp = flash_resource_pak_compression(pak);
+	raw_size = flash_resource_pak_raw_size(pak);
+	if (raw_size == 0 || raw_size > dst_len)
+		return (false);
+
+	start = platform_cpu_cycle_count();
+	switch (comp) {
+	case FLASH_RESOURCE_COMP_NONE:
+		kern_memcpy(dst, src, raw_size);
+		break;
+	case FLASH_RESOURCE_COMP_LZ4:
+		ret = kern_lz4_decompress(src + FLASH_RESOURCE_COMP_HDR_SIZE,
+		    pak->payload_size - FLASH_RESOURCE_COMP_HDR_SIZE,
+		    dst, raw_size);
+		if (ret != (int) raw_size) {
+			console_printf("[flash] pak@0x%x: corrupt payload\n",
+			    pak->start);
+			return (false);
+		}
+		break;
+	default:
+		console_printf("[flash] pak@0x%x: unknown compression %d\n",
+		    pak->start, comp);
+		return (false);
+	}
+	cycles = platform_cpu_cycle_count() - start;
+
+	freq = platform_cpu_cycle_freq();
+	if (cycles != 0 && freq != 0) {
+		uint32_t kbps;
+
+		kbps = (uint32_t) (((uint64_t) raw_size * freq) /
+		    ((uint64_t) cycles * 1000));
+		console_printf("[flash] pak@0x%x: loaded %d -> %d bytes in %d cycles (%d.%03d MB/s)\n",
+		    pak->start, pak->payload_size, raw_size, cycles,
+		    kbps / 1000, kbps % 1000);
+	}
+
+	return (true);
+}
+
+/**
+ * Load a pak payload into a newly allocated RAM buffer.
+ *
+ * The caller frees it with kern_physmem_free().
+ *
+ * @param[in] pak pak to load
+ * @param[out] addr allocated buffer
+ * @param[out] size uncompressed payload size
+ * @retval true if loaded, false on allocation failure or a corrupt
+ *   / unknown payload
+ */
+bool
+flash_resource_pak_load(const struct flash_resource_pak *pak,
+    paddr_t *addr, size_t *size)
+{
+	size_t raw_size;
+	paddr_t buf;
+
+	raw_size = flash_resource_pak_raw_size(pak);
+	if (raw_size == 0)
+		return (false);
+
+	buf = kern_physmem_alloc(raw_size, 32, 0);
+	if (buf == 0) {
+		console_printf("[flash] pak@0x%x: couldn't allocate %d bytes\n",
+		    pak->start, raw_size);
+		return (false);
+	}
+
+	if (flash_resource_pak_read(pak, (void *) buf, raw_size) == false) {
+		kern_physmem_free(buf);
+		return (false);
+	}
+
+	*addr = buf;
+	*size = raw_size;
+	return (true);
+}
+
+/*
+ * Check the payload CRC, if the pak has one.
+ *
+ * Returns the index flags to record, so the result is cached
+ * for the rest of the boot.
+ */
+static uint32_t
+flash_resource_verify_pak(const struct flash_resource_pak *pak)
+{
+	uint32_t crc;
+
+	if ((pak->hdr.flags & FLASH_RESOURCE_FLAG_CRC32) == 0)
+		return (0);
+
+	crc = kern_crc32b((const char *) pak->payload_start,
+	    pak->payload_size);
+	if (crc != pak->hdr.checksum) {
+		console_printf("[flash] pak@0x%x: bad CRC (0x%08x, expected 0x%08x)\n",
+		    pak->start, crc, pak->hdr.checksum);
+		return (FLASH_RESOURCE_INDEX_FLAG_CRC_BAD);
+	}
+
+	return (FLASH_RESOURCE_INDEX_FLAG_CRC_OK);
+}
+
+/*
+ * Fill in a pak from its index entry, without touching flash.
+ */
+static void
+flash_resource_index_to_pak(const struct flash_resource_index_entry *e,
+    struct flash_resource_pak *pak)
+{
+
+	pak->hdr.magic = ENTRY_MAGIC;
+	pak->hdr.checksum = 0;
+	pak->hdr.type = e->type;
+	pak->hdr.length = e->length;
+	pak->hdr.alignment = e->alignment;
+	pak->hdr.namelength = e->namelength;
+	pak->hdr.payload_length = e->payload_size;
+	pak->hdr.flags = e->hdr_flags;
+	pak->start = e->start;
+	pak->payload_start = e->payload_start;
+	pak->payload_size = e->payload_size;
+}
+
+/*
+ * Add the given pak to the span index.
+ */
+static bool
+flash_resource_index_add(flash_resource_span_t *span,
+    const struct flash_resource_pak *pak)
+{
+	struct flash_resource_index_entry *e;
+	uint32_t h;
+	int i;
+
+	if (span->num_entries >= FLASH_RESOURCE_INDEX_MAX)
+		return (false);
+
+	e = &span->index[span->num_entries];
+	e->hash = kern_hash_fnv1a((const char *) (pak->start + HEADER_SIZE),
+	    pak->hdr.namelength);
+	e->flags = flash_resource_verify_pak(pak);
+	e->start = pak->start;
+	e->payload_start = pak->payload_start;
+	e->payload_size = pak->payload_size;
+	e->type = pak->hdr.type;
+	e->hdr_flags = pak->hdr.flags;
+	e->length = pak->hdr.length;
+	e->alignment = pak->hdr.alignment;
+	e->namelength = pak->hdr.namelength;
+	span->num_entries++;
+
+	/* Linear probe for a free hash slot */
+	h = e->hash;
+	for (i = 0; i < FLASH_RESOURCE_HASH_SIZE; i++) {
+		h &= (FLASH_RESOURCE_HASH_SIZE - 1);
+		if (span->hash_table[h] == 0) {
+			span->hash_table[h] = span->num_entries;
+			break;
+		}
+		h++;
+	}
 
 	return (true);
 }
@@ -109,52 +361,125 @@ flash_resource_span_init(flash_resource_span_t *span, paddr_t start,
 	span->start = start;
 	span->size = size;
 	span->end = end;
-	span->flags |= FLASH_RESOURCE_SPAN_FLAGS_SETUP;
-
-	/* And here's where we COULD scan the span to gather some useful info */
+	span->num_entries = 0;
+	kern_bzero(span->hash_table, sizeof(span->hash_table));
 
 	console_printf("[flash] Flash resource span: start @ 0x%08x, %d bytes\n",
 	    start, size);
 
-	/* Walk the paks we have */
+	/*
+	 * Walk the paks we have and index them, so lookups don't
+	 * have to walk flash.
+	 */
 	kern_bzero(label, sizeof(label));
 	while (flash_resource_check_pak(start, &pak, label, sizeof(label))) {
+		/* XXX TODO: should extend miniprintf to include %.*s */
+		KERN_LOG(LOG_FLASH, KERN_LOG_LEVEL_DEBUG,
+		    "pak: %s@0x%x %d byte payload, %d byte total length",
+		    label, start, pak.hdr.payload_length, pak.hdr.length);
+
+		if (flash_resource_index_add(span, &pak) == false) {
+			console_printf("[flash] index full, ignoring %s\n",
+			    label);
+		}
+
 		start += pak.hdr.length;
 		if (start > end)
 			break;
 		kern_bzero(label, sizeof(label));
 	}
 
+	span->flags |= FLASH_RESOURCE_SPAN_FLAGS_SETUP;
+
+	console_printf("[flash] %d paks indexed\n", span->num_entries);
+
 	return (true);
 }
 
+/**
+ * Lookup a pak by label.
+ *
+ * This uses the index built by flash_resource_span_init(); the label
+ * must match exactly.
+ *
+ * @param[in] span flash span
+ * @param[out] pak pak to populate
+ * @param[in] label label to look for
+ * @retval true if found, false otherwise
+ */
 bool
 flash_resource_lookup(flash_resource_span_t *span,
     struct flash_resource_pak *pak, const char *label)
 {
-	paddr_t start;
-	char pak_label[16];
+	struct flash_resource_index_entry *e;
+	size_t len;
+	uint32_t hash, h;
+	int i;
 
 	if ((span->flags & FLASH_RESOURCE_SPAN_FLAGS_SETUP) == 0) {
 		console_printf("%s: not setup\n", __func__);
 		return (false);
 	}
 
-	/* Walk the paks we have */
-	kern_bzero(pak_label, sizeof(pak_label));
-	start = span->start;
-	while (flash_resource_check_pak(start, pak, pak_label,
-	    sizeof(pak_label))) {
-		/* XXX TODO: we REALLY need an internal non-crap string representation! */
-		if (kern_strncmp(pak_label, label, kern_strlen(label)) == 0) {
-			return (true);
-		}
-		start += pak->hdr.length;
-		if (start > span->end)
+	len = kern_strlen(label);
+	hash = kern_hash_fnv1a(label, len);
+
+	h = hash;
+	for (i = 0; i < FLASH_RESOURCE_HASH_SIZE; i++) {
+		h &= (FLASH_RESOURCE_HASH_SIZE - 1);
+		if (span->hash_table[h] == 0)
 			break;
-		kern_bzero(pak_label, sizeof(pak_label));
+		e = &span->index[span->hash_table[h] - 1];
+		h++;
+
+		if (e->hash != hash)
+			continue;
+		if (e->flags & FLASH_RESOURCE_INDEX_FLAG_CRC_BAD)
+			continue;
+		/* Exact match on the label in flash */
+		if (e->namelength != len)
+			continue;
+		if (kern_strncmp((const char *) (e->start + HEADER_SIZE),
+		    label, len) != 0)
+			continue;
+		flash_resource_index_to_pak(e, pak);
+		return (true);
 	}
 
 	return (false);
+}
 
+/**
+ * Iterate over the paks of the given type, in flash order.
+ *
+ * Set *cursor to 0 before the first call; it's updated so the next
+ * call returns the next matching pak.
+ *
+ * @param[in] span flash span
+ * @param[out] pak pak to populate
+ * @param[in] type pak type to look for
+ * @param[in,out] cursor iteration state
+ * @retval true if a pak was found, false if there are no more
+ */
+bool
+flash_resource_lookup_type(flash_resource_span_t *span,
+    struct flash_resource_pak *pak, uint32_t type, int *cursor)
+{
+	struct flash_resource_index_entry *e;
+
+	if ((span->flags & FLASH_RESOURCE_SPAN_FLAGS_SETUP) == 0)
+		return (false);
+
+	while (*cursor >= 0 && *cursor < span->num_entries) {
+		e = &span->index[*cursor];
+		(*cursor)++;
+		if (e->type != type)
+			continue;
+		if (e->flags & FLASH_RESOURCE_INDEX_FLAG_CRC_BAD)
+			continue;
+		flash_resource_index_to_pak(e, pak);
+		return (true);
+	}
+
+	return (false);
 }
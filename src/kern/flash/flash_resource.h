@@ -28,11 +28,47 @@
 /* We've enumerated the span */
 #define	FLASH_RESOURCE_SPAN_FLAGS_SETUP		BIT_U32(0)
 
+/* Maximum number of paks indexed per span */
+#define	FLASH_RESOURCE_INDEX_MAX		32
+
+/* Label hash table size; must be a power of two > FLASH_RESOURCE_INDEX_MAX */
+#define	FLASH_RESOURCE_HASH_SIZE		64
+
+/* Payload CRC checked and matches */
+#define	FLASH_RESOURCE_INDEX_FLAG_CRC_OK	BIT_U32(0)
+/* Payload CRC checked and doesn't match; lookups skip it */
+#define	FLASH_RESOURCE_INDEX_FLAG_CRC_BAD	BIT_U32(1)
+
+/*
+ * An index entry for a pak, built when the span is initialised.
+ * Entries are kept in flash order and hold the parsed header fields
+ * lookups hand back, so a lookup only touches flash to compare the
+ * label.  The payload checksum isn't kept; it's checked once at
+ * span init and the result recorded in flags.
+ */
+struct flash_resource_index_entry {
+	uint32_t hash;
+	uint32_t flags;		/* FLASH_RESOURCE_INDEX_FLAG_* */
+	paddr_t start;
+	paddr_t payload_start;
+	size_t payload_size;
+	uint32_t type;
+	uint32_t hdr_flags;	/* FLASH_RESOURCE_FLAG_* */
+	uint32_t length;
+	uint32_t alignment;
+	uint32_t namelength;
+};
+
 struct flash_resource_span {
 	paddr_t start;
 	paddr_t end;
 	size_t size;
 	uint32_t flags;
+
+	int num_entries;
+	struct flash_resource_index_entry index[FLASH_RESOURCE_INDEX_MAX];
+	/* label hash -> index entry + 1, 0 if empty */
+	uint8_t hash_table[FLASH_RESOURCE_HASH_SIZE];
 };
 
 typedef struct flash_resource_span flash_resource_span_t;
@@ -42,6 +78,16 @@ extern	bool flash_resource_span_init(flash_resource_span_t *span,
 	     paddr_t start, size_t size);
 extern	bool flash_resource_lookup(flash_resource_span_t *span,
 	    flash_resource_pak_t *pak, const char *label);
+extern	bool flash_resource_lookup_type(flash_resource_span_t *span,
+	    flash_resource_pak_t *pak, uint32_t type, int *cursor);
+extern	bool flash_resource_pak_mpu_region(const flash_resource_pak_t *pak,
+	    paddr_t *start, paddr_size_t *size);
+extern	uint32_t flash_resource_pak_compression(const flash_resource_pak_t *pak);
+extern	size_t flash_resource_pak_raw_size(const flash_resource_pak_t *pak);
+extern	bool flash_resource_pak_read(const flash_resource_pak_t *pak,
+	    void *dst, size_t dst_len);
+extern	bool flash_resource_pak_load(const flash_resource_pak_t *pak,
+	    paddr_t *addr, size_t *size);
 
 
 #endif	/* __FLASH_FLASH_RESOURCE_H__ */
@@ -35,7 +35,7 @@ struct flash_resource_entry_header {
 	uint32_t alignment;
 	uint32_t namelength;
 	uint32_t payload_length;
-	uint32_t rsv0;
+	uint32_t flags;
 };
 
 #define		ENTRY_MAGIC	0x05091979
@@ -43,4 +43,28 @@ struct flash_resource_entry_header {
 
 #define		PAK_ALIGNMENT	32
 
+/*
+ * The payload is aligned to, and padded out to, something a single
+ * MPU region can cover; the alignment field is the region size.
+ */
+#define		FLASH_RESOURCE_FLAG_MPU_ALIGNED		0x00000001
+
+/* The checksum field is the CRC-32 of the payload */
+#define		FLASH_RESOURCE_FLAG_CRC32		0x00000002
+
+/* Program payload should be copied into RAM and run from there, not XIP */
+#define		FLASH_RESOURCE_FLAG_RUN_FROM_RAM	0x00000004
+
+/*
+ * Payload compression type.  Compressed payloads start with the
+ * uncompressed length (le32) followed by the compressed data;
+ * they're not XIP and need loading into RAM.
+ */
+#define		FLASH_RESOURCE_FLAG_COMP_M		0x00000f00
+#define		FLASH_RESOURCE_FLAG_COMP_S		8
+#define		FLASH_RESOURCE_COMP_NONE		0
+#define		FLASH_RESOURCE_COMP_LZ4			1
+
+#define		FLASH_RESOURCE_COMP_HDR_SIZE		4
+
 #endif	/* __FLASH_FLASH_RESOURCE_HEADER_H__ */
@@ -30,6 +30,7 @@
 
 struct flash_resource_pak {
 	struct flash_resource_entry_header hdr;
+	paddr_t start;
 	paddr_t payload_start;
 	size_t payload_size;
 };
@@ -0,0 +1,442 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include <hw/types.h>
+
+#include <kern/libraries/string/string.h>
+#include <kern/libraries/list/list.h>
+#include <kern/libraries/container/container.h>
+#include <kern/libraries/mem/mem.h>
+
+#include <core/platform.h>
+#include <core/lock.h>
+
+#include <kern/core/error.h>
+#include <kern/core/task.h>
+#include <kern/core/sema.h>
+#include <kern/core/malloc.h>
+#include <kern/core/logging.h>
+
+#include <kern/ipc/msgq.h>
+
+LOGGING_DEFINE(LOG_MSGQ, "msgq", KERN_LOG_LEVEL_INFO);
+
+/*
+ * A message queue is a ring of messages plus a pair of semaphores;
+ * one counts free slots (senders sleep on it) and one counts queued
+ * messages (receivers sleep on it).  The ring itself is protected by
+ * a spinlock so non-blocking sends can be done from interrupt context.
+ *
+ * Tasks waiting on several things at once (see kern_wait_any()) don't
+ * sleep on the semaphore; they sit on the poller list and are
+ * signalled on every send.
+ */
+struct kern_msgq {
+	bool in_use;
+	char name[KERN_MSGQ_NAME_SZ];
+	struct kern_msg *ring;
+	uint32_t depth;
+	uint32_t head;
+	uint32_t tail;
+	platform_spinlock_t lock;
+	struct kern_sema slots;
+	struct kern_sema msgs;
+	struct list_head pollers;
+	struct kern_msgq_stats stats;
+};
+
+static struct kern_msgq kern_msgq_table[KERN_MSGQ_MAX_QUEUES];
+static platform_spinlock_t kern_msgq_table_lock;
+
+void
+kern_msgq_init(void)
+{
+	platform_spinlock_init(&kern_msgq_table_lock);
+	kern_bzero(kern_msgq_table, sizeof(kern_msgq_table));
+}
+
+static struct kern_msgq *
+kern_msgq_get(kern_msgq_id_t id)
+{
+	struct kern_msgq *q;
+
+	if (id == KERN_MSGQ_ID_NONE || id > KERN_MSGQ_MAX_QUEUES)
+		return (NULL);
+	q = &kern_msgq_table[id - 1];
+	if (q->in_use == false)
+		return (NULL);
+	return (q);
+}
+
+/**
+ * Create a named message queue.
+ *
+ * Queues aren't (yet) destroyed; they live for the life of
+ * the system.
+ *
+ * @param[in] name queue name
+ * @param[in] depth number of messages the queue can hold
+ * @retval queue id, or KERN_MSGQ_ID_NONE on error
+ */
+kern_msgq_id_t
+kern_msgq_create(const char *name, uint32_t depth)
+{
+	struct kern_msgq *q = NULL;
+	struct kern_msg *ring;
+	uint32_t i;
+
+	if (depth == 0 || depth > KERN_MSGQ_MAX_DEPTH)
+		return (KERN_MSGQ_ID_NONE);
+
+	ring = kern_malloc(sizeof(struct kern_msg) * depth, 4);
+	if (ring == NULL)
+		return (KERN_MSGQ_ID_NONE);
+
+	platform_spinlock_lock(&kern_msgq_table_lock);
+	for (i = 0; i < KERN_MSGQ_MAX_QUEUES; i++) {
+		if (kern_msgq_table[i].in_use == false)
+			continue;
+		if (kern_strncmp(kern_msgq_table[i].name, name,
+		    KERN_MSGQ_NAME_SZ) == 0) {
+			platform_spinlock_unlock(&kern_msgq_table_lock);
+			kern_free(ring);
+			return (KERN_MSGQ_ID_NONE);
+		}
+	}
+	for (i = 0; i < KERN_MSGQ_MAX_QUEUES; i++) {
+		if (kern_msgq_table[i].in_use == false) {
+			q = &kern_msgq_table[i];
+			break;
+		}
+	}
+	if (q == NULL) {
+		platform_spinlock_unlock(&kern_msgq_table_lock);
+		kern_free(ring);
+		return (KERN_MSGQ_ID_NONE);
+	}
+
+	/*
+	 * Fill in the slot before dropping the table lock and only
+	 * then mark it in use, so a concurrent create of the same
+	 * name sees it and lookups never find a half set up queue.
+	 */
+	kern_strlcpy(q->name, name, KERN_MSGQ_NAME_SZ);
+	q->ring = ring;
+	q->depth = depth;
+	q->head = q->tail = 0;
+	platform_spinlock_init(&q->lock);
+	kern_sema_init(&q->slots, q->name, depth);
+	kern_sema_init(&q->msgs, q->name, 0);
+	list_head_init(&q->pollers);
+	kern_bzero(&q->stats, sizeof(q->stats));
+	q->stats.depth = depth;
+	q->in_use = true;
+	platform_spinlock_unlock(&kern_msgq_table_lock);
+
+	KERN_LOG(LOG_MSGQ, KERN_LOG_LEVEL_INFO, "created %s (%u), depth %u",
+	    q->name, i + 1, depth);
+
+	return (i + 1);
+}
+
+/**
+ * Lookup a message queue by name.
+ *
+ * @param[in] name queue name
+ * @retval queue id, or KERN_MSGQ_ID_NONE if not found
+ */
+kern_msgq_id_t
+kern_msgq_lookup(const char *name)
+{
+	kern_msgq_id_t id = KERN_MSGQ_ID_NONE;
+	uint32_t i;
+
+	platform_spinlock_lock(&kern_msgq_table_lock);
+	for (i = 0; i < KERN_MSGQ_MAX_QUEUES; i++) {
+		if (kern_msgq_table[i].in_use == false)
+			continue;
+		if (kern_strncmp(kern_msgq_table[i].name, name,
+		    KERN_MSGQ_NAME_SZ) == 0) {
+			id = i + 1;
+			break;
+		}
+	}
+	platform_spinlock_unlock(&kern_msgq_table_lock);
+	return (id);
+}
+
+/**
+ * Send a message.
+ *
+ * The sender and timestamp fields are filled in here.  If a
+ * buffer is attached then ownership passes to the queue and
+ * then the receiver; the sender must not touch it again.
+ *
+ * With KERN_MSGQ_FLAG_NONBLOCK this can be called from interrupt
+ * context; a full queue then drops the message and returns
+ * KERN_ERR_NOSPC.
+ *
+ * @param[in] id queue id
+ * @param[in] msg message to send
+ * @param[in] flags KERN_MSGQ_FLAG_*
+ * @retval KERN_ERR_OK if sent, or an error
+ */
+kern_error_t
+kern_msgq_send(kern_msgq_id_t id, const struct kern_msg *msg,
+    uint32_t flags)
+{
+
+	return (kern_msgq_send_from(id, msg, flags, kern_task_current_id()));
+}
+
+/**
+ * Send a message on behalf of another task.
+ *
+ * This is kern_msgq_send() for kernel code doing the work for a
+ * task (eg the async ring poller) so the receiver sees the right
+ * sender.
+ *
+ * @param[in] id queue id
+ * @param[in] msg message to send
+ * @param[in] flags KERN_MSGQ_FLAG_*
+ * @param[in] sender task id to report as the sender
+ * @retval KERN_ERR_OK if sent, KERN_ERR_NOSPC if the queue was full
+ *   and either non-blocking or the scheduler isn't running yet,
+ *   or an error
+ */
+kern_error_t
+kern_msgq_send_from(kern_msgq_id_t id, const struct kern_msg *msg,
+    uint32_t flags, kern_task_id_t sender)
+{
+	struct kern_msgq_poller *p;
+	struct kern_msgq *q;
+	struct kern_msg *m;
+	struct list_node *n;
+	uint32_t count;
+
+	q = kern_msgq_get(id);
+	if (q == NULL)
+		return (KERN_ERR_INVALID_ARGS);
+
+	if (flags & KERN_MSGQ_FLAG_NONBLOCK) {
+		if (kern_sema_trytake(&q->slots) == false) {
+			platform_spinlock_lock(&q->lock);
+			q->stats.drops++;
+			platform_spinlock_unlock(&q->lock);
+			return (KERN_ERR_NOSPC);
+		}
+	} else if (kern_sema_take(&q->slots) == false) {
+		return (KERN_ERR_NOSPC);
+	}
+
+	platform_spinlock_lock(&q->lock);
+	m = &q->ring[q->tail];
+	*m = *msg;
+	m->sender = sender;
+	m->timestamp = platform_cpu_cycle_count();
+	q->tail = (q->tail + 1) % q->depth;
+
+	q->stats.sends++;
+	count = ++q->stats.count;
+	if (count > q->stats.count_max)
+		q->stats.count_max = count;
+	platform_spinlock_unlock(&q->lock);
+
+	kern_sema_give(&q->msgs);
+
+	/* Wake anyone waiting for the queue to have something in it */
+	if (q->pollers.head != NULL) {
+		platform_spinlock_lock(&q->lock);
+		for (n = q->pollers.head; n != NULL; n = n->next) {
+			p = container_of(n, struct kern_msgq_poller, node);
+			(void) kern_task_signal(p->task, p->sig);
+		}
+		platform_spinlock_unlock(&q->lock);
+	}
+
+	return (KERN_ERR_OK);
+}
+
+/**
+ * Receive a message.
+ *
+ * If the message has a buffer attached then the caller now owns
+ * it and must free it with kern_physmem_free().
+ *
+ * @param[in] id queue id
+ * @param[out] msg received message
+ * @param[in] flags KERN_MSGQ_FLAG_*
+ * @retval KERN_ERR_OK if received, KERN_ERR_EMPTY if the queue was
+ *   empty and either non-blocking or the scheduler isn't running
+ *   yet, or an error
+ */
+kern_error_t
+kern_msgq_recv(kern_msgq_id_t id, struct kern_msg *msg, uint32_t flags)
+{
+	struct kern_msgq *q;
+	uint32_t lat;
+
+	q = kern_msgq_get(id);
+	if (q == NULL)
+		return (KERN_ERR_INVALID_ARGS);
+
+	if (flags & KERN_MSGQ_FLAG_NONBLOCK) {
+		if (kern_sema_trytake(&q->msgs) == false)
+			return (KERN_ERR_EMPTY);
+	} else if (kern_sema_take(&q->msgs) == false) {
+		return (KERN_ERR_EMPTY);
+	}
+
+	platform_spinlock_lock(&q->lock);
+	*msg = q->ring[q->head];
+	q->head = (q->head + 1) % q->depth;
+
+	lat = platform_cpu_cycle_count() - msg->timestamp;
+	q->stats.recvs++;
+	q->stats.count--;
+	q->stats.latency_sum += lat;
+	if (lat > q->stats.latency_max)
+		q->stats.latency_max = lat;
+	platform_spinlock_unlock(&q->lock);
+
+	kern_sema_give(&q->slots);
+	return (KERN_ERR_OK);
+}
+
+/**
+ * Ask to be signalled whenever a message is sent to a queue.
+ *
+ * The poller must be removed with kern_msgq_poll_del() before it
+ * goes out of scope.  Check kern_msgq_ready() after adding it so a
+ * message sent beforehand isn't missed.
+ *
+ * @param[in] id queue id
+ * @param[in] p poller to add
+ * @param[in] task task to signal
+ * @param[in] sig signals to post
+ * @retval KERN_ERR_OK if added, or an error
+ */
+kern_error_t
+kern_msgq_poll_add(kern_msgq_id_t id, struct kern_msgq_poller *p,
+    kern_task_id_t task, kern_task_signal_set_t sig)
+{
+	struct kern_msgq *q;
+
+	q = kern_msgq_get(id);
+	if (q == NULL)
+		return (KERN_ERR_INVALID_ARGS);
+
+	list_node_init(&p->node);
+	p->id = id;
+	p->task = task;
+	p->sig = sig;
+
+	platform_spinlock_lock(&q->lock);
+	list_add_tail(&q->pollers, &p->node);
+	platform_spinlock_unlock(&q->lock);
+	return (KERN_ERR_OK);
+}
+
+/**
+ * Remove a poller added with kern_msgq_poll_add().
+ */
+void
+kern_msgq_poll_del(struct kern_msgq_poller *p)
+{
+	struct kern_msgq *q;
+
+	q = kern_msgq_get(p->id);
+	if (q == NULL)
+		return;
+
+	platform_spinlock_lock(&q->lock);
+	list_delete(&q->pollers, &p->node);
+	platform_spinlock_unlock(&q->lock);
+}
+
+/**
+ * Return true if the queue has a message waiting.
+ *
+ * This is only a hint; another task may receive it first.
+ */
+bool
+kern_msgq_ready(kern_msgq_id_t id)
+{
+	struct kern_msgq *q;
+
+	q = kern_msgq_get(id);
+	if (q == NULL)
+		return (false);
+	return (q->msgs.count > 0);
+}
+
+/**
+ * Return true if the given queue id refers to a queue that can
+ * be sent to.
+ */
+bool
+kern_msgq_exists(kern_msgq_id_t id)
+{
+
+	return (kern_msgq_get(id) != NULL);
+}
+
+/**
+ * Fetch a snapshot of the statistics for the given queue.
+ */
+kern_error_t
+kern_msgq_get_stats(kern_msgq_id_t id, struct kern_msgq_stats *stats)
+{
+	struct kern_msgq *q;
+
+	q = kern_msgq_get(id);
+	if (q == NULL)
+		return (KERN_ERR_INVALID_ARGS);
+
+	platform_spinlock_lock(&q->lock);
+	*stats = q->stats;
+	platform_spinlock_unlock(&q->lock);
+	return (KERN_ERR_OK);
+}
+
+/**
+ * Log the statistics for all message queues.
+ */
+void
+kern_msgq_dump_stats(void)
+{
+	struct kern_msgq_stats st;
+	uint32_t i;
+
+	for (i = 0; i < KERN_MSGQ_MAX_QUEUES; i++) {
+		if (kern_msgq_get_stats(i + 1, &st) != KERN_ERR_OK)
+			continue;
+		KERN_LOG(LOG_MSGQ, KERN_LOG_LEVEL_NOTICE,
+		    "%s: depth %u/%u (max %u), sends %u, recvs %u,"
+		    " drops %u, latency avg %u max %u cycles",
+		    kern_msgq_table[i].name, st.count, st.depth,
+		    st.count_max, st.sends, st.recvs, st.drops,
+		    st.recvs ? st.latency_sum / st.recvs : 0,
+		    st.latency_max);
+	}
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+#ifndef	__KERN_IPC_MSGQ_H__
+#define	__KERN_IPC_MSGQ_H__
+
+#include <os/bit.h>
+
+#include <kern/libraries/list/list.h>
+
+#include <kern/core/error.h>
+#include <kern/core/signal.h>
+#include <kern/core/task_defs.h>
+
+/*
+ * Fixed-size message queues.
+ *
+ * Messages are a fixed size so they can be passed around without
+ * any allocation.  Small payloads fit in the message words (and
+ * userland sends them entirely in registers via the syscall path);
+ * larger payloads are passed as a physmem buffer whose ownership
+ * moves from the sender to the receiver, so the data itself is
+ * never copied.
+ */
+
+#define	KERN_MSGQ_MAX_QUEUES		8
+#define	KERN_MSGQ_NAME_SZ		16
+#define	KERN_MSGQ_MAX_DEPTH		64
+#define	KERN_MSGQ_MSG_WORDS		3
+
+/* Don't sleep if the queue is full / empty */
+#define	KERN_MSGQ_FLAG_NONBLOCK		BIT_U32(0)
+
+/*
+ * Queue handles are the table index plus one, so a handle
+ * of 0 is never valid.
+ */
+typedef uint32_t kern_msgq_id_t;
+#define	KERN_MSGQ_ID_NONE		0
+
+/**
+ * struct kern_msg - a single message.
+ *
+ * @type message type, defined by the sender/receiver
+ * @arg small payload words
+ * @buf optional physmem buffer, owned by the receiver once received;
+ *   it's handed to a userland receiver as a shm region, so it needs
+ *   an MPU compatible size and alignment (see kern_shm_adopt())
+ * @buf_len length of the buffer in bytes
+ * @cookie opaque value for the sender, eg to match up a reply
+ * @sender task id of the sender, filled in by send
+ * @timestamp cycle count at send, filled in by send
+ */
+struct kern_msg {
+	uint32_t type;
+	uint32_t arg[KERN_MSGQ_MSG_WORDS];
+	paddr_t buf;
+	uint32_t buf_len;
+	uintptr_t cookie;
+	kern_task_id_t sender;
+	uint32_t timestamp;
+};
+
+/**
+ * struct kern_msgq_stats - message queue statistics.
+ *
+ * @depth configured queue depth
+ * @count messages currently queued
+ * @count_max high watermark of queued messages
+ * @sends messages successfully sent
+ * @recvs messages successfully received
+ * @drops non-blocking sends which failed because the queue was full
+ * @latency_sum sum of send->receive latency in CPU cycles
+ * @latency_max worst send->receive latency in CPU cycles
+ */
+struct kern_msgq_stats {
+	uint32_t depth;
+	uint32_t count;
+	uint32_t count_max;
+	uint32_t sends;
+	uint32_t recvs;
+	uint32_t drops;
+	uint32_t latency_sum;
+	uint32_t latency_max;
+};
+
+/**
+ * struct kern_msgq_poller - a task waiting for a queue to have
+ * messages, without receiving from it.
+ *
+ * @node entry on the queue's poller list
+ * @id queue id
+ * @task task to signal
+ * @sig signals to post to the task on each send
+ */
+struct kern_msgq_poller {
+	struct list_node node;
+	kern_msgq_id_t id;
+	kern_task_id_t task;
+	kern_task_signal_set_t sig;
+};
+
+extern	void kern_msgq_init(void);
+extern	kern_msgq_id_t kern_msgq_create(const char *name, uint32_t depth);
+extern	kern_msgq_id_t kern_msgq_lookup(const char *name);
+extern	kern_error_t kern_msgq_send(kern_msgq_id_t id,
+	    const struct kern_msg *msg, uint32_t flags);
+extern	kern_error_t kern_msgq_send_from(kern_msgq_id_t id,
+	    const struct kern_msg *msg, uint32_t flags,
+	    kern_task_id_t sender);
+extern	kern_error_t kern_msgq_recv(kern_msgq_id_t id,
+	    struct kern_msg *msg, uint32_t flags);
+extern	kern_error_t kern_msgq_poll_add(kern_msgq_id_t id,
+	    struct kern_msgq_poller *p, kern_task_id_t task,
+	    kern_task_signal_set_t sig);
+extern	void kern_msgq_poll_del(struct kern_msgq_poller *p);
+extern	bool kern_msgq_ready(kern_msgq_id_t id);
+extern	bool kern_msgq_exists(kern_msgq_id_t id);
+extern	kern_error_t kern_msgq_get_stats(kern_msgq_id_t id,
+	    struct kern_msgq_stats *stats);
+extern	void kern_msgq_dump_stats(void);
+
+#endif	/* __KERN_IPC_MSGQ_H__ */
@@ -0,0 +1,507 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include <hw/types.h>
+
+#include <kern/libraries/list/list.h>
+#include <kern/libraries/mem/mem.h>
+
+#include <core/platform.h>
+#include <core/lock.h>
+#include <core/user_ram_access.h>
+
+#include <kern/console/console.h>
+#include <kern/core/error.h>
+#include <kern/core/signal.h>
+#include <kern/core/task.h>
+#include <kern/core/timer.h>
+#include <kern/core/mutex.h>
+#include <kern/core/logging.h>
+
+#include <kern/ipc/shm.h>
+#include <kern/ipc/msgq.h>
+#include <kern/ipc/ring.h>
+
+LOGGING_DEFINE(LOG_RING, "ring", KERN_LOG_LEVEL_INFO);
+
+/**
+ * struct kern_ring_timer - a KERN_RING_OP_TIMER in flight.
+ *
+ * @ev timer event
+ * @in_use true whilst queued; cleared by the timer callback
+ * @user_data the submission's user_data
+ */
+struct kern_ring_timer {
+	kern_timer_event_t ev;
+	volatile bool in_use;
+	uint32_t user_data;
+};
+
+/**
+ * struct kern_ring - a task's async ring.
+ *
+ * @in_use true if this slot is allocated
+ * @owner owning task
+ * @owner_id owning task id, for signalling
+ * @shm_id shared memory region holding the rings
+ * @hdr ring header (in the task's memory)
+ * @sqe submission entries
+ * @cqe completion entries
+ * @sq_entries number of submission entries
+ * @cq_entries number of completion entries
+ * @flags KERN_RING_SETUP_F_*
+ * @sq_head kernel copy of the submission head
+ * @cq_tail kernel copy of the completion tail
+ * @lock protects the completion ring; taken from timer callbacks
+ * @timer timers in flight
+ */
+struct kern_ring {
+	bool in_use;
+	struct kern_task *owner;
+	kern_task_id_t owner_id;
+	kern_shm_id_t shm_id;
+	volatile struct kern_ring_hdr *hdr;
+	volatile struct kern_ring_sqe *sqe;
+	volatile struct kern_ring_cqe *cqe;
+	uint32_t sq_entries;
+	uint32_t cq_entries;
+	uint32_t flags;
+	uint32_t sq_head;
+	uint32_t cq_tail;
+	platform_spinlock_t lock;
+	struct kern_ring_timer timer[KERN_RING_MAX_TIMERS];
+};
+
+/*
+ * The ring table mutex is held whilst submissions are processed, so
+ * a ring's timers are only ever added by one task at a time (the
+ * owner or the poller) and deleted by the reaper under it too.
+ */
+static struct kern_ring kern_ring_table[KERN_RING_MAX_RINGS];
+static struct kern_mutex kern_ring_mtx;
+static uint32_t kern_ring_poll_count = 0;
+
+/*
+ * Ring poller - drains the submission rings set up with
+ * KERN_RING_SETUP_F_SQ_POLL every KERN_RING_POLL_MSEC, and sleeps
+ * when there aren't any.
+ */
+static struct kern_task kern_ring_poll_task;
+static uint8_t kern_ring_poll_stack[PLATFORM_DEFAULT_KERN_STACK_SIZE]
+	    __attribute__ ((aligned(PLATFORM_DEFAULT_KERN_STACK_ALIGNMENT)))
+	     = { 0 };
+
+static struct kern_ring *
+kern_ring_lookup_locked(struct kern_task *task)
+{
+	int i;
+
+	for (i = 0; i < KERN_RING_MAX_RINGS; i++) {
+		if (kern_ring_table[i].in_use &&
+		    kern_ring_table[i].owner == task)
+			return (&kern_ring_table[i]);
+	}
+	return (NULL);
+}
+
+/*
+ * Post a completion and wake the owner.
+ *
+ * This may be called from the timer callback (interrupt context)
+ * as well as whilst processing submissions.  The task's cq_head is
+ * only used to see if there's room; a bogus value just means
+ * completions are dropped.
+ */
+static void
+kern_ring_complete(struct kern_ring *ring, uint32_t user_data,
+    kern_error_t result)
+{
+	volatile struct kern_ring_cqe *c;
+
+	platform_spinlock_lock(&ring->lock);
+	if (ring->cq_tail - ring->hdr->cq_head >= ring->cq_entries) {
+		ring->hdr->cq_overflow++;
+	} else {
+		c = &ring->cqe[ring->cq_tail & (ring->cq_entries - 1)];
+		c->user_data = user_data;
+		c->result = result;
+		ring->cq_tail++;
+		ring->hdr->cq_tail = ring->cq_tail;
+	}
+	platform_spinlock_unlock(&ring->lock);
+
+	(void) kern_task_signal(ring->owner_id, KERN_SIGNAL_TASK_RING);
+}
+
+static void
+kern_ring_timer_fn(kern_timer_event_t *ev, void *arg1, uintptr_t arg2,
+    uint32_t arg3)
+{
+	struct kern_ring *ring = arg1;
+	struct kern_ring_timer *t = &ring->timer[arg2];
+
+	t->in_use = false;
+	kern_ring_complete(ring, t->user_data, KERN_ERR_OK);
+}
+
+static kern_error_t
+kern_ring_timer_start(struct kern_ring *ring, uint32_t user_data,
+    uint32_t msec, uint32_t slack_msec)
+{
+	struct kern_ring_timer *t;
+	int i;
+
+	for (i = 0; i < KERN_RING_MAX_TIMERS; i++) {
+		t = &ring->timer[i];
+		if (t->in_use == true)
+			continue;
+		t->user_data = user_data;
+		t->in_use = true;
+		if (kern_timer_event_add(&t->ev, msec, slack_msec) == false) {
+			t->in_use = false;
+			return (KERN_ERR_INPROGRESS);
+		}
+		return (KERN_ERR_OK);
+	}
+	return (KERN_ERR_NOSPC);
+}
+
+static kern_error_t
+kern_ring_console_write(uaddr_t buf, uint32_t len)
+{
+	uint8_t ch;
+	uint32_t i;
+
+	for (i = 0; i < len; i++) {
+		if (platform_user_ram_read_byte_from_user(buf + i, &ch)
+		    == false)
+			return (KERN_ERR_INVALID_ARGS);
+		console_putc(ch);
+	}
+	return (KERN_ERR_OK);
+}
+
+/*
+ * Run one submission.  Everything but a successfully started timer
+ * completes straight away.
+ */
+static void
+kern_ring_dispatch(struct kern_ring *ring, const struct kern_ring_sqe *s)
+{
+	struct kern_msg msg = { 0 };
+	kern_error_t ret;
+
+	switch (s->op) {
+	case KERN_RING_OP_NOP:
+		ret = KERN_ERR_OK;
+		break;
+	case KERN_RING_OP_CONSOLE_WRITE:
+		ret = kern_ring_console_write(s->arg[0], s->arg[1]);
+		break;
+	case KERN_RING_OP_TIMER:
+		ret = kern_ring_timer_start(ring, s->user_data, s->arg[0],
+		    s->arg[1]);
+		if (ret == KERN_ERR_OK)
+			return;
+		break;
+	case KERN_RING_OP_MSGQ_SEND:
+		msg.type = s->arg[1];
+		msg.arg[0] = s->arg[2];
+		msg.arg[1] = s->arg[3];
+		ret = kern_msgq_send_from(s->arg[0], &msg,
+		    KERN_MSGQ_FLAG_NONBLOCK, ring->owner_id);
+		break;
+	default:
+		ret = KERN_ERR_INVALID_ARGS;
+		break;
+	}
+
+	kern_ring_complete(ring, s->user_data, ret);
+}
+
+/*
+ * Consume everything on the submission ring.  Each entry is copied
+ * out before it's looked at, since the task can change it under us.
+ */
+static kern_error_t
+kern_ring_process_locked(struct kern_ring *ring, uint32_t *submitted)
+{
+	volatile struct kern_ring_sqe *v;
+	struct kern_ring_sqe s;
+	uint32_t tail, n;
+
+	*submitted = 0;
+	tail = ring->hdr->sq_tail;
+	n = tail - ring->sq_head;
+	if (n > ring->sq_entries) {
+		KERN_LOG(LOG_RING, KERN_LOG_LEVEL_NOTICE,
+		    "task 0x%08x: bad sq_tail (%u, head %u)",
+		    ring->owner_id, tail, ring->sq_head);
+		return (KERN_ERR_INVALID_ARGS);
+	}
+
+	while (n-- > 0) {
+		v = &ring->sqe[ring->sq_head & (ring->sq_entries - 1)];
+		s.op = v->op;
+		s.user_data = v->user_data;
+		s.arg[0] = v->arg[0];
+		s.arg[1] = v->arg[1];
+		s.arg[2] = v->arg[2];
+		s.arg[3] = v->arg[3];
+
+		ring->sq_head++;
+		ring->hdr->sq_head = ring->sq_head;
+		(*submitted)++;
+
+		kern_ring_dispatch(ring, &s);
+	}
+
+	return (KERN_ERR_OK);
+}
+
+static void
+kern_ring_poll_task_fn(void *arg)
+{
+	kern_task_signal_set_t sig;
+	uint32_t submitted;
+	int i;
+
+	while (1) {
+		sig = 0;
+		if (kern_ring_poll_count == 0) {
+			(void) kern_task_wait(KERN_SIGNAL_TASK_RING, &sig);
+			continue;
+		}
+
+		(void) kern_task_timer_set_slack(current_task,
+		    KERN_RING_POLL_MSEC, KERN_RING_POLL_SLACK_MSEC);
+		(void) kern_task_wait(KERN_SIGNAL_TASK_KSLEEP, &sig);
+
+		kern_mutex_lock(&kern_ring_mtx);
+		for (i = 0; i < KERN_RING_MAX_RINGS; i++) {
+			if (kern_ring_table[i].in_use == false ||
+			    (kern_ring_table[i].flags &
+			    KERN_RING_SETUP_F_SQ_POLL) == 0)
+				continue;
+			(void) kern_ring_process_locked(&kern_ring_table[i],
+			    &submitted);
+		}
+		kern_mutex_unlock(&kern_ring_mtx);
+	}
+}
+
+void
+kern_ring_init(void)
+{
+	kern_mutex_init(&kern_ring_mtx, "ring");
+	kern_bzero(kern_ring_table, sizeof(kern_ring_table));
+	kern_ring_poll_count = 0;
+
+	kern_task_init(&kern_ring_poll_task, kern_ring_poll_task_fn, NULL,
+	    "kring", (stack_addr_t) kern_ring_poll_stack,
+	    sizeof(kern_ring_poll_stack), 0);
+	kern_task_start(&kern_ring_poll_task);
+}
+
+static bool
+kern_ring_entries_valid(uint32_t entries)
+{
+	return (entries != 0 && entries <= KERN_RING_MAX_ENTRIES &&
+	    (entries & (entries - 1)) == 0);
+}
+
+/**
+ * Set up the async rings for a task.
+ *
+ * The rings live in a new shared memory region owned by (and mapped
+ * into) the task.  A task can only have one set of rings; they're
+ * freed when it exits.
+ *
+ * @param[in] task owning task
+ * @param[in] sq_entries submission entries, a power of two
+ * @param[in] cq_entries completion entries, a power of two
+ * @param[in] flags KERN_RING_SETUP_F_*
+ * @retval the address of the ring region, or 0 on error
+ */
+paddr_t
+kern_ring_setup(struct kern_task *task, uint32_t sq_entries,
+    uint32_t cq_entries, uint32_t flags)
+{
+	struct kern_ring *ring = NULL;
+	paddr_t addr;
+	paddr_size_t size;
+	uint32_t sq_off, cq_off;
+	int i;
+
+	if (kern_ring_entries_valid(sq_entries) == false ||
+	    kern_ring_entries_valid(cq_entries) == false ||
+	    (flags & ~KERN_RING_SETUP_F_SQ_POLL) != 0)
+		return (0);
+
+	sq_off = (sizeof(struct kern_ring_hdr) + 7) & ~7;
+	cq_off = sq_off + sq_entries * sizeof(struct kern_ring_sqe);
+
+	kern_mutex_lock(&kern_ring_mtx);
+	if (kern_ring_lookup_locked(task) != NULL)
+		goto error;
+	for (i = 0; i < KERN_RING_MAX_RINGS; i++) {
+		if (kern_ring_table[i].in_use == false) {
+			ring = &kern_ring_table[i];
+			break;
+		}
+	}
+	if (ring == NULL)
+		goto error;
+
+	kern_bzero(ring, sizeof(*ring));
+	ring->shm_id = kern_shm_create(task,
+	    cq_off + cq_entries * sizeof(struct kern_ring_cqe));
+	if (ring->shm_id == KERN_SHM_ID_NONE)
+		goto error;
+	if (kern_shm_lookup(ring->shm_id, task, &addr, &size) == false) {
+		(void) kern_shm_destroy(ring->shm_id, task);
+		goto error;
+	}
+
+	ring->owner = task;
+	ring->owner_id = kern_task_to_id(task);
+	ring->sq_entries = sq_entries;
+	ring->cq_entries = cq_entries;
+	ring->flags = flags;
+	ring->hdr = (volatile struct kern_ring_hdr *) addr;
+	ring->sqe = (volatile struct kern_ring_sqe *) (addr + sq_off);
+	ring->cqe = (volatile struct kern_ring_cqe *) (addr + cq_off);
+	platform_spinlock_init(&ring->lock);
+	for (i = 0; i < KERN_RING_MAX_TIMERS; i++)
+		kern_timer_event_setup(&ring->timer[i].ev, kern_ring_timer_fn,
+		    ring, i, 0);
+
+	/* The region is already zeroed */
+	ring->hdr->sq_entries = sq_entries;
+	ring->hdr->sq_off = sq_off;
+	ring->hdr->cq_entries = cq_entries;
+	ring->hdr->cq_off = cq_off;
+	ring->hdr->flags = flags;
+
+	ring->in_use = true;
+	if (flags & KERN_RING_SETUP_F_SQ_POLL) {
+		if (kern_ring_poll_count++ == 0)
+			(void) kern_task_signal(
+			    kern_task_to_id(&kern_ring_poll_task),
+			    KERN_SIGNAL_TASK_RING);
+	}
+	kern_mutex_unlock(&kern_ring_mtx);
+
+	KERN_LOG(LOG_RING, KERN_LOG_LEVEL_INFO,
+	    "task 0x%08x: ring at 0x%08x, %u/%u entries%s",
+	    ring->owner_id, addr, sq_entries, cq_entries,
+	    (flags & KERN_RING_SETUP_F_SQ_POLL) ? ", polled" : "");
+	return (addr);
+
+error:
+	kern_mutex_unlock(&kern_ring_mtx);
+	return (0);
+}
+
+/**
+ * The ring doorbell.
+ *
+ * This consumes everything on the task's submission ring and then,
+ * if min_complete isn't 0, sleeps until at least that many
+ * completions are waiting.
+ *
+ * @param[in] task owning task; must be the current task
+ * @param[in] min_complete completions to wait for
+ * @param[out] submitted submissions consumed
+ * @retval KERN_ERR_OK, or an error
+ */
+kern_error_t
+kern_ring_enter(struct kern_task *task, uint32_t min_complete,
+    uint32_t *submitted)
+{
+	kern_task_signal_set_t sig;
+	struct kern_ring *ring;
+	kern_error_t ret;
+	uint32_t avail;
+
+	*submitted = 0;
+
+	kern_mutex_lock(&kern_ring_mtx);
+	ring = kern_ring_lookup_locked(task);
+	if (ring == NULL) {
+		kern_mutex_unlock(&kern_ring_mtx);
+		return (KERN_ERR_NOTFOUND);
+	}
+	ret = kern_ring_process_locked(ring, submitted);
+	kern_mutex_unlock(&kern_ring_mtx);
+	if (ret != KERN_ERR_OK)
+		return (ret);
+
+	/*
+	 * The ring can't go away under us; it's only freed once
+	 * its owner (us) has exited.
+	 */
+	if (min_complete > ring->cq_entries)
+		min_complete = ring->cq_entries;
+	while (min_complete != 0) {
+		platform_spinlock_lock(&ring->lock);
+		avail = ring->cq_tail - ring->hdr->cq_head;
+		platform_spinlock_unlock(&ring->lock);
+		if (avail >= min_complete && avail <= ring->cq_entries)
+			break;
+		sig = 0;
+		(void) kern_task_wait(KERN_SIGNAL_TASK_RING, &sig);
+	}
+
+	return (KERN_ERR_OK);
+}
+
+/**
+ * Free a task's rings; called when the task is cleaned up.
+ *
+ * This cancels any timers still in flight.  The ring memory itself
+ * is freed with the rest of the task's shared memory regions by
+ * kern_shm_task_cleanup(), which must be called after this.
+ */
+void
+kern_ring_task_cleanup(struct kern_task *task)
+{
+	struct kern_ring *ring;
+	int i;
+
+	kern_mutex_lock(&kern_ring_mtx);
+	ring = kern_ring_lookup_locked(task);
+	if (ring == NULL) {
+		kern_mutex_unlock(&kern_ring_mtx);
+		return;
+	}
+
+	for (i = 0; i < KERN_RING_MAX_TIMERS; i++) {
+		if (ring->timer[i].in_use)
+			(void) kern_timer_event_del(&ring->timer[i].ev);
+	}
+	if (ring->flags & KERN_RING_SETUP_F_SQ_POLL)
+		kern_ring_poll_count--;
+	ring->in_use = false;
+	kern_mutex_unlock(&kern_ring_mtx);
+}
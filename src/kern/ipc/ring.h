@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+#ifndef	__KERN_IPC_RING_H__
+#define	__KERN_IPC_RING_H__
+
+#include <kern/core/error.h>
+#include <kern/core/task_defs.h>
+#include <kern/ipc/ring_defs.h>
+
+/*
+ * Asynchronous syscall rings.
+ *
+ * A task can set up one pair of submission / completion rings in a
+ * shared memory region (see kern/ipc/shm.h) mapped into it.  It
+ * queues up a batch of requests and then hands them to the kernel
+ * with a single doorbell syscall - or none at all, if the kernel is
+ * polling its ring.  Results come back on the completion ring.
+ *
+ * Operations never block; timers complete when they fire.
+ */
+
+#define	KERN_RING_MAX_RINGS		4
+#define	KERN_RING_MAX_TIMERS		4
+#define	KERN_RING_POLL_MSEC		10
+#define	KERN_RING_POLL_SLACK_MSEC	10
+
+struct kern_task;
+
+extern	void kern_ring_init(void);
+extern	paddr_t kern_ring_setup(struct kern_task *task, uint32_t sq_entries,
+	    uint32_t cq_entries, uint32_t flags);
+extern	kern_error_t kern_ring_enter(struct kern_task *task,
+	    uint32_t min_complete, uint32_t *submitted);
+extern	void kern_ring_task_cleanup(struct kern_task *task);
+
+#endif	/* __KERN_IPC_RING_H__ */
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+#ifndef	__KERN_IPC_RING_DEFS_H__
+#define	__KERN_IPC_RING_DEFS_H__
+
+/*
+ * Layout of a task's asynchronous syscall rings.
+ *
+ * This is shared with userland (user/include/wtf_ring.h) so it only
+ * uses plain types.
+ *
+ * The ring region is laid out as:
+ *
+ *   [ struct kern_ring_hdr ][ sq_entries * sqe ][ cq_entries * cqe ]
+ *
+ * with sq_off / cq_off giving the offsets from the start of the
+ * region.  Entry counts are powers of two; head and tail are free
+ * running counters, masked with (entries - 1) to index.
+ *
+ * The task owns sq_tail and cq_head, the kernel owns sq_head and
+ * cq_tail.  The kernel keeps its own copies of the fields it owns
+ * and never trusts the task's copy of them.
+ */
+
+#define	KERN_RING_MAX_ENTRIES		64
+
+/* Setup flags */
+/* The kernel polls the submission ring; no doorbell is needed */
+#define	KERN_RING_SETUP_F_SQ_POLL	0x00000001
+
+/* Operations */
+#define	KERN_RING_OP_NOP		0
+#define	KERN_RING_OP_CONSOLE_WRITE	1	/* buf, len */
+#define	KERN_RING_OP_TIMER		2	/* msec, slack msec */
+#define	KERN_RING_OP_MSGQ_SEND		3	/* qid, type, arg0, arg1 */
+
+/**
+ * struct kern_ring_hdr - ring region header.
+ *
+ * @sq_head next submission the kernel will consume
+ * @sq_tail next submission slot the task will fill
+ * @sq_entries number of submission entries
+ * @sq_off offset of the submission entries
+ * @cq_head next completion the task will consume
+ * @cq_tail next completion slot the kernel will fill
+ * @cq_entries number of completion entries
+ * @cq_off offset of the completion entries
+ * @cq_overflow completions dropped because the ring was full
+ * @flags KERN_RING_SETUP_F_* the ring was set up with
+ */
+struct kern_ring_hdr {
+	uint32_t sq_head;
+	uint32_t sq_tail;
+	uint32_t sq_entries;
+	uint32_t sq_off;
+	uint32_t cq_head;
+	uint32_t cq_tail;
+	uint32_t cq_entries;
+	uint32_t cq_off;
+	uint32_t cq_overflow;
+	uint32_t flags;
+};
+
+/**
+ * struct kern_ring_sqe - a submission.
+ *
+ * @op KERN_RING_OP_*
+ * @user_data opaque value, handed back in the completion
+ * @arg operation arguments
+ */
+struct kern_ring_sqe {
+	uint32_t op;
+	uint32_t user_data;
+	uint32_t arg[4];
+};
+
+/**
+ * struct kern_ring_cqe - a completion.
+ *
+ * @user_data the submission's user_data
+ * @result a kern_error_t
+ */
+struct kern_ring_cqe {
+	uint32_t user_data;
+	uint32_t result;
+};
+
+#endif	/* __KERN_IPC_RING_DEFS_H__ */
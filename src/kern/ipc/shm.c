@@ -0,0 +1,443 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include <hw/types.h>
+
+#include <kern/libraries/list/list.h>
+#include <kern/libraries/mem/mem.h>
+
+#include <core/platform.h>
+
+#include <kern/core/error.h>
+#include <kern/core/task.h>
+#include <kern/core/task_mem.h>
+#include <kern/core/mutex.h>
+#include <kern/core/physmem.h>
+#include <kern/core/logging.h>
+
+#include <kern/ipc/shm.h>
+
+LOGGING_DEFINE(LOG_SHM, "shm", KERN_LOG_LEVEL_INFO);
+
+struct kern_shm_mapping {
+	struct kern_task *task;
+	int slot;
+	bool rw;
+};
+
+struct kern_shm {
+	bool in_use;
+	paddr_t addr;
+	paddr_size_t size;
+	struct kern_task *owner;
+	struct kern_shm_mapping map[KERN_SHM_MAX_MAPPINGS];
+};
+
+static struct kern_shm kern_shm_table[KERN_SHM_MAX_REGIONS];
+static struct kern_mutex kern_shm_mtx;
+
+void
+kern_shm_init(void)
+{
+	kern_mutex_init(&kern_shm_mtx, "shm");
+	kern_bzero(kern_shm_table, sizeof(kern_shm_table));
+}
+
+static struct kern_shm *
+kern_shm_get_locked(kern_shm_id_t id)
+{
+	struct kern_shm *shm;
+
+	if (id == KERN_SHM_ID_NONE || id > KERN_SHM_MAX_REGIONS)
+		return (NULL);
+	shm = &kern_shm_table[id - 1];
+	if (shm->in_use == false)
+		return (NULL);
+	return (shm);
+}
+
+static struct kern_shm_mapping *
+kern_shm_find_mapping_locked(struct kern_shm *shm, struct kern_task *task)
+{
+	int i;
+
+	for (i = 0; i < KERN_SHM_MAX_MAPPINGS; i++) {
+		if (shm->map[i].task == task)
+			return (&shm->map[i]);
+	}
+	return (NULL);
+}
+
+static kern_error_t
+kern_shm_map_locked(struct kern_shm *shm, struct kern_task *task, bool rw)
+{
+	struct kern_shm_mapping *m;
+
+	if (kern_shm_find_mapping_locked(shm, task) != NULL)
+		return (KERN_ERR_EXISTS);
+
+	m = kern_shm_find_mapping_locked(shm, NULL);
+	if (m == NULL)
+		return (KERN_ERR_NOSPC);
+
+	if (kern_task_mem_mpu_map(task, shm->addr, shm->size,
+	    rw ? PLATFORM_PROT_TYPE_NOEXEC_RW : PLATFORM_PROT_TYPE_NOEXEC_RO,
+	    &m->slot) == false)
+		return (KERN_ERR_NOSPC);
+
+	m->task = task;
+	m->rw = rw;
+	return (KERN_ERR_OK);
+}
+
+static void
+kern_shm_unmap_locked(struct kern_shm_mapping *m)
+{
+	kern_task_mem_mpu_unmap(m->task, m->slot);
+	m->task = NULL;
+	m->slot = -1;
+	m->rw = false;
+}
+
+/*
+ * Unmap a region from every task and free its table slot, leaving
+ * the memory itself alone.
+ */
+static void
+kern_shm_release_locked(struct kern_shm *shm)
+{
+	int i;
+
+	for (i = 0; i < KERN_SHM_MAX_MAPPINGS; i++) {
+		if (shm->map[i].task != NULL)
+			kern_shm_unmap_locked(&shm->map[i]);
+	}
+
+	shm->in_use = false;
+	shm->owner = NULL;
+	shm->addr = 0;
+	shm->size = 0;
+}
+
+static void
+kern_shm_destroy_locked(struct kern_shm *shm)
+{
+
+	KERN_LOG(LOG_SHM, KERN_LOG_LEVEL_INFO, "freeing 0x%x (%u bytes)",
+	    shm->addr, shm->size);
+	kern_physmem_free(shm->addr);
+	kern_shm_release_locked(shm);
+}
+
+/*
+ * Wrap the given memory in a new region owned by, and mapped
+ * read/write into, the given task.  On failure the memory is
+ * left for the caller to deal with.
+ */
+static struct kern_shm *
+kern_shm_setup_locked(struct kern_task *owner, paddr_t addr,
+    paddr_size_t size)
+{
+	struct kern_shm *shm = NULL;
+	int i;
+
+	for (i = 0; i < KERN_SHM_MAX_REGIONS; i++) {
+		if (kern_shm_table[i].in_use == false) {
+			shm = &kern_shm_table[i];
+			break;
+		}
+	}
+	if (shm == NULL)
+		return (NULL);
+
+	kern_bzero(shm, sizeof(*shm));
+	for (i = 0; i < KERN_SHM_MAX_MAPPINGS; i++)
+		shm->map[i].slot = -1;
+	shm->in_use = true;
+	shm->addr = addr;
+	shm->size = size;
+	shm->owner = owner;
+
+	if (kern_shm_map_locked(shm, owner, true) != KERN_ERR_OK) {
+		kern_shm_release_locked(shm);
+		return (NULL);
+	}
+	return (shm);
+}
+
+/**
+ * Create a shared memory region owned by the given task.
+ *
+ * The size is rounded up to what a single MPU slot can cover
+ * (whole subregions of a power of two region) and the region is
+ * aligned to the enclosing power of two.  It's zeroed and mapped
+ * read/write into the owner.
+ *
+ * @param[in] owner owning task
+ * @param[in] size requested size in bytes
+ * @retval region id, or KERN_SHM_ID_NONE on error
+ */
+kern_shm_id_t
+kern_shm_create(struct kern_task *owner, uint32_t size)
+{
+	struct kern_shm *shm;
+	uint32_t rsize, ralign;
+	paddr_t addr;
+
+	if (size == 0 || size > 0x80000000)
+		return (KERN_SHM_ID_NONE);
+
+	platform_mpu_region_size_calc(size, &rsize, &ralign);
+
+	addr = kern_physmem_alloc(rsize, ralign, KERN_PHYSMEM_ALLOC_FLAG_ZERO);
+	if (addr == 0) {
+		KERN_LOG(LOG_SHM, KERN_LOG_LEVEL_NOTICE,
+		    "couldn't allocate %u bytes", rsize);
+		return (KERN_SHM_ID_NONE);
+	}
+
+	kern_mutex_lock(&kern_shm_mtx);
+	shm = kern_shm_setup_locked(owner, addr, rsize);
+	kern_mutex_unlock(&kern_shm_mtx);
+	if (shm == NULL) {
+		kern_physmem_free(addr);
+		return (KERN_SHM_ID_NONE);
+	}
+
+	KERN_LOG(LOG_SHM, KERN_LOG_LEVEL_INFO,
+	    "task 0x%x created region %u at 0x%x (%u bytes)",
+	    owner, (shm - kern_shm_table) + 1, addr, rsize);
+
+	return ((shm - kern_shm_table) + 1);
+}
+
+/**
+ * Destroy a shared memory region, unmapping it from every task.
+ *
+ * @param[in] id region id
+ * @param[in] owner calling task; must be the owner
+ */
+kern_error_t
+kern_shm_destroy(kern_shm_id_t id, struct kern_task *owner)
+{
+	struct kern_shm *shm;
+
+	kern_mutex_lock(&kern_shm_mtx);
+	shm = kern_shm_get_locked(id);
+	if (shm == NULL || shm->owner != owner) {
+		kern_mutex_unlock(&kern_shm_mtx);
+		return (KERN_ERR_INVALID_ARGS);
+	}
+	kern_shm_destroy_locked(shm);
+	kern_mutex_unlock(&kern_shm_mtx);
+	return (KERN_ERR_OK);
+}
+
+/**
+ * Detach a region's memory so it can be handed to another task.
+ *
+ * The region is unmapped from every task and its id freed, but the
+ * memory isn't; the caller now owns it as a plain physmem buffer
+ * and either hands it to kern_shm_adopt() or frees it.
+ *
+ * @param[in] id region id
+ * @param[in] owner calling task; must be the owner
+ * @param[out] addr region address
+ * @param[out] size region size
+ */
+kern_error_t
+kern_shm_detach(kern_shm_id_t id, struct kern_task *owner, paddr_t *addr,
+    paddr_size_t *size)
+{
+	struct kern_shm *shm;
+
+	kern_mutex_lock(&kern_shm_mtx);
+	shm = kern_shm_get_locked(id);
+	if (shm == NULL || shm->owner != owner) {
+		kern_mutex_unlock(&kern_shm_mtx);
+		return (KERN_ERR_INVALID_ARGS);
+	}
+	*addr = shm->addr;
+	*size = shm->size;
+	kern_shm_release_locked(shm);
+	kern_mutex_unlock(&kern_shm_mtx);
+	return (KERN_ERR_OK);
+}
+
+/**
+ * Make an existing physmem buffer a region owned by the given task.
+ *
+ * This is the other half of kern_shm_detach(); nothing is copied.
+ * The buffer must already have an MPU compatible size and alignment
+ * (eg it came from kern_shm_detach()).  On success the region owns
+ * the buffer; on failure the caller still does.
+ *
+ * @param[in] owner task to own the region
+ * @param[in] addr buffer address
+ * @param[in] size buffer size
+ * @retval region id, or KERN_SHM_ID_NONE on error
+ */
+kern_shm_id_t
+kern_shm_adopt(struct kern_task *owner, paddr_t addr, paddr_size_t size)
+{
+	struct kern_shm *shm;
+	uint32_t rsize, ralign;
+
+	platform_mpu_region_size_calc(size, &rsize, &ralign);
+	if (size == 0 || rsize != size || (addr & (ralign - 1)) != 0)
+		return (KERN_SHM_ID_NONE);
+
+	kern_mutex_lock(&kern_shm_mtx);
+	shm = kern_shm_setup_locked(owner, addr, size);
+	kern_mutex_unlock(&kern_shm_mtx);
+	if (shm == NULL)
+		return (KERN_SHM_ID_NONE);
+
+	return ((shm - kern_shm_table) + 1);
+}
+
+/**
+ * Grant another task access to a shared memory region.
+ *
+ * @param[in] id region id
+ * @param[in] owner calling task; must be the owner
+ * @param[in] task_id task to grant access to
+ * @param[in] rw true for a read/write mapping, false for read-only
+ */
+kern_error_t
+kern_shm_grant(kern_shm_id_t id, struct kern_task *owner,
+    kern_task_id_t task_id, bool rw)
+{
+	struct kern_shm *shm;
+	struct kern_task *task;
+	kern_error_t ret;
+
+	task = kern_task_lookup(task_id);
+	if (task == NULL)
+		return (KERN_ERR_INVALID_TASKID);
+
+	kern_mutex_lock(&kern_shm_mtx);
+	shm = kern_shm_get_locked(id);
+	if (shm == NULL || shm->owner != owner)
+		ret = KERN_ERR_INVALID_ARGS;
+	else
+		ret = kern_shm_map_locked(shm, task, rw);
+	kern_mutex_unlock(&kern_shm_mtx);
+
+	kern_task_refcount_dec(task);
+	return (ret);
+}
+
+/**
+ * Revoke a task's access to a shared memory region.
+ *
+ * Revoking the owner's own mapping destroys the region.
+ *
+ * @param[in] id region id
+ * @param[in] owner calling task; must be the owner
+ * @param[in] task_id task to revoke access from
+ */
+kern_error_t
+kern_shm_revoke(kern_shm_id_t id, struct kern_task *owner,
+    kern_task_id_t task_id)
+{
+	struct kern_shm_mapping *m;
+	struct kern_shm *shm;
+	kern_error_t ret = KERN_ERR_OK;
+
+	if (task_id == kern_task_to_id(owner))
+		return (kern_shm_destroy(id, owner));
+
+	kern_mutex_lock(&kern_shm_mtx);
+	shm = kern_shm_get_locked(id);
+	if (shm == NULL || shm->owner != owner) {
+		ret = KERN_ERR_INVALID_ARGS;
+		goto done;
+	}
+	m = kern_shm_find_mapping_locked(shm,
+	    (struct kern_task *) (uintptr_t) task_id);
+	if (m == NULL) {
+		ret = KERN_ERR_NOTFOUND;
+		goto done;
+	}
+	kern_shm_unmap_locked(m);
+done:
+	kern_mutex_unlock(&kern_shm_mtx);
+	return (ret);
+}
+
+/**
+ * Lookup the address and size of a region mapped into the given task.
+ *
+ * @param[in] id region id
+ * @param[in] task task to check
+ * @param[out] addr region address
+ * @param[out] size region size
+ * @retval true if the region exists and is mapped into the task
+ */
+bool
+kern_shm_lookup(kern_shm_id_t id, struct kern_task *task, paddr_t *addr,
+    paddr_size_t *size)
+{
+	struct kern_shm *shm;
+	bool ret = false;
+
+	kern_mutex_lock(&kern_shm_mtx);
+	shm = kern_shm_get_locked(id);
+	if (shm != NULL && kern_shm_find_mapping_locked(shm, task) != NULL) {
+		*addr = shm->addr;
+		*size = shm->size;
+		ret = true;
+	}
+	kern_mutex_unlock(&kern_shm_mtx);
+	return (ret);
+}
+
+/**
+ * Clean up shared memory for a task that's being destroyed.
+ *
+ * Regions the task owns are destroyed; mappings of other regions
+ * are removed.
+ */
+void
+kern_shm_task_cleanup(struct kern_task *task)
+{
+	struct kern_shm_mapping *m;
+	struct kern_shm *shm;
+	int i;
+
+	kern_mutex_lock(&kern_shm_mtx);
+	for (i = 0; i < KERN_SHM_MAX_REGIONS; i++) {
+		shm = &kern_shm_table[i];
+		if (shm->in_use == false)
+			continue;
+		if (shm->owner == task) {
+			kern_shm_destroy_locked(shm);
+			continue;
+		}
+		m = kern_shm_find_mapping_locked(shm, task);
+		if (m != NULL)
+			kern_shm_unmap_locked(m);
+	}
+	kern_mutex_unlock(&kern_shm_mtx);
+}
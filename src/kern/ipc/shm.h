@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+#ifndef	__KERN_IPC_SHM_H__
+#define	__KERN_IPC_SHM_H__
+
+#include <kern/core/error.h>
+#include <kern/core/task_defs.h>
+
+/*
+ * Shared memory regions.
+ *
+ * A region is a block of physmem with an MPU compatible size and
+ * alignment.  The task that creates it owns it and has it mapped
+ * read/write; it can then grant read-only or read/write mappings
+ * to other tasks and revoke them again.  Each mapping uses one of
+ * the task's spare MPU slots.
+ *
+ * Since there's no virtual memory, a region has the same address
+ * in every task it's mapped into.
+ *
+ * A region can also be moved wholesale to another task, eg along
+ * with a message: kern_shm_detach() turns it back into a plain
+ * physmem buffer and kern_shm_adopt() makes that buffer a region
+ * of the new owner.  Nothing is copied.
+ */
+
+#define	KERN_SHM_MAX_REGIONS		8
+#define	KERN_SHM_MAX_MAPPINGS		4
+
+/* Handles are the table index plus one; 0 is never valid */
+typedef uint32_t kern_shm_id_t;
+#define	KERN_SHM_ID_NONE		0
+
+struct kern_task;
+
+extern	void kern_shm_init(void);
+extern	kern_shm_id_t kern_shm_create(struct kern_task *owner,
+	    uint32_t size);
+extern	kern_error_t kern_shm_destroy(kern_shm_id_t id,
+	    struct kern_task *owner);
+extern	kern_error_t kern_shm_detach(kern_shm_id_t id,
+	    struct kern_task *owner, paddr_t *addr, paddr_size_t *size);
+extern	kern_shm_id_t kern_shm_adopt(struct kern_task *owner, paddr_t addr,
+	    paddr_size_t size);
+extern	kern_error_t kern_shm_grant(kern_shm_id_t id,
+	    struct kern_task *owner, kern_task_id_t task_id, bool rw);
+extern	kern_error_t kern_shm_revoke(kern_shm_id_t id,
+	    struct kern_task *owner, kern_task_id_t task_id);
+extern	bool kern_shm_lookup(kern_shm_id_t id, struct kern_task *task,
+	    paddr_t *addr, paddr_size_t *size);
+extern	void kern_shm_task_cleanup(struct kern_task *task);
+
+#endif	/* __KERN_IPC_SHM_H__ */
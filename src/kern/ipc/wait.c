@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include <hw/types.h>
+
+#include <kern/libraries/list/list.h>
+
+#include <core/platform.h>
+
+#include <kern/core/error.h>
+#include <kern/core/signal.h>
+#include <kern/core/task.h>
+#include <kern/core/timer.h>
+
+#include <kern/ipc/msgq.h>
+#include <kern/ipc/wait.h>
+
+/*
+ * Signals which the kernel uses for its own waits and so can't be
+ * waited on here.
+ */
+#define	KERN_WAIT_SIG_RESERVED	(KERN_SIGNAL_TASK_KSLEEP |		\
+				 KERN_SIGNAL_TASK_REAP |		\
+				 KERN_SIGNAL_TASK_KWAIT |		\
+				 KERN_SIGNAL_TASK_WAIT_ANY)
+
+static bool
+kern_wait_deadline_passed(const struct kern_wait_args *args)
+{
+
+	if ((args->flags & KERN_WAIT_F_DEADLINE) == 0)
+		return (false);
+	return (kern_timer_tick_passed(args->deadline_msec));
+}
+
+/**
+ * Wait for any of the given signals, queues or the deadline.
+ *
+ * The signals, queue senders and the sleep timer all post to the
+ * task, which then checks everything in one pass and returns the
+ * lot in the ready bitmap.  Queues are only checked, not received
+ * from, so another receiver may get there first.
+ *
+ * This is only callable from task context.
+ *
+ * @param[in] args what to wait for
+ * @param[out] ready KERN_WAIT_READY_* bitmap
+ * @param[out] sigs which of args->sig_mask were posted
+ * @retval KERN_ERR_OK once something is ready, or an error
+ */
+kern_error_t
+kern_wait_any(const struct kern_wait_args *args, uint32_t *ready,
+    kern_task_signal_set_t *sigs)
+{
+	struct kern_msgq_poller poller[KERN_WAIT_MAX_QUEUES];
+	kern_task_signal_set_t got, s;
+	kern_error_t ret = KERN_ERR_OK;
+	uint32_t i, r, npoll = 0;
+	bool timer = false;
+
+	*ready = 0;
+	*sigs = 0;
+
+	if (args->nqueues > KERN_WAIT_MAX_QUEUES ||
+	    (args->sig_mask & KERN_WAIT_SIG_RESERVED) != 0 ||
+	    (args->flags & ~KERN_WAIT_F_DEADLINE) != 0)
+		return (KERN_ERR_INVALID_ARGS);
+	if (args->nqueues == 0 && args->sig_mask == 0 &&
+	    (args->flags & KERN_WAIT_F_DEADLINE) == 0)
+		return (KERN_ERR_INVALID_ARGS);
+
+	/* Drop a stale wakeup from an earlier wait */
+	(void) kern_task_signal_take(KERN_SIGNAL_TASK_WAIT_ANY);
+
+	for (i = 0; i < args->nqueues; i++) {
+		ret = kern_msgq_poll_add(args->queue[i], &poller[i],
+		    kern_task_current_id(), KERN_SIGNAL_TASK_WAIT_ANY);
+		if (ret != KERN_ERR_OK)
+			goto done;
+		npoll++;
+	}
+
+	if ((args->flags & KERN_WAIT_F_DEADLINE) &&
+	    kern_wait_deadline_passed(args) == false) {
+		if (kern_task_timer_set_abs(current_task,
+		    args->deadline_msec) == false) {
+			ret = KERN_ERR_INPROGRESS;
+			goto done;
+		}
+		timer = true;
+	}
+
+	/*
+	 * Everything that can wake us is set up, so check what's
+	 * already ready and then sleep until something posts.
+	 */
+	got = kern_task_signal_take(args->sig_mask);
+	while (1) {
+		r = 0;
+		for (i = 0; i < args->nqueues; i++) {
+			if (kern_msgq_ready(args->queue[i]))
+				r |= KERN_WAIT_READY_QUEUE(i);
+		}
+		if (got != 0)
+			r |= KERN_WAIT_READY_SIGNAL;
+		if (kern_wait_deadline_passed(args))
+			r |= KERN_WAIT_READY_TIMEOUT;
+		if (r != 0)
+			break;
+
+		s = 0;
+		(void) kern_task_wait(args->sig_mask |
+		    KERN_SIGNAL_TASK_WAIT_ANY | KERN_SIGNAL_TASK_KSLEEP, &s);
+		got |= s & args->sig_mask;
+	}
+
+	*ready = r;
+	*sigs = got;
+
+done:
+	for (i = 0; i < npoll; i++)
+		kern_msgq_poll_del(&poller[i]);
+
+	/* Don't leave the sleep timer to wake up a later sleep */
+	if (timer) {
+		(void) kern_timer_event_del(&current_task->sleep_ev);
+		(void) kern_task_signal_take(KERN_SIGNAL_TASK_KSLEEP);
+	}
+
+	return (ret);
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef	__KERN_IPC_WAIT_H__
+#define	__KERN_IPC_WAIT_H__
+
+#include <kern/core/error.h>
+#include <kern/core/signal.h>
+#include <kern/ipc/wait_defs.h>
+
+/*
+ * Wait for any of a set of signals, message queues having messages
+ * in them or a deadline, whichever comes first, with one wakeup.
+ *
+ * The timeout uses the task's sleep timer, so this replaces rather
+ * than mixes with kern_task_timer_set() waits.
+ */
+
+extern	kern_error_t kern_wait_any(const struct kern_wait_args *args,
+	    uint32_t *ready, kern_task_signal_set_t *sigs);
+
+#endif	/* __KERN_IPC_WAIT_H__ */
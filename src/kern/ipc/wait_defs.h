@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef	__KERN_IPC_WAIT_DEFS_H__
+#define	__KERN_IPC_WAIT_DEFS_H__
+
+/*
+ * Arguments and results for kern_wait_any() / SYSCALL_ID_WAIT_ANY.
+ *
+ * This is shared with userland (user/include/wtf_wait.h) so it only
+ * uses plain types.
+ */
+
+#define	KERN_WAIT_MAX_QUEUES		8
+
+/* Flags */
+/* deadline_msec is valid */
+#define	KERN_WAIT_F_DEADLINE		0x00000001
+
+/*
+ * Result bitmap.  Bit n is set if queue[n] has a message waiting;
+ * the top bits say why else the wait finished.  More than one bit
+ * can be set.
+ */
+#define	KERN_WAIT_READY_QUEUE(n)	(1U << (n))
+#define	KERN_WAIT_READY_SIGNAL		0x40000000
+#define	KERN_WAIT_READY_TIMEOUT		0x80000000
+
+/**
+ * struct kern_wait_args - what to wait for.
+ *
+ * @sig_mask signals to wait for
+ * @flags KERN_WAIT_F_*
+ * @deadline_msec absolute kernel tick (in msec, see the info page
+ *   tick_msec) to give up at
+ * @nqueues number of message queues in queue[]
+ * @queue message queues to wait to have messages in them
+ */
+struct kern_wait_args {
+	uint32_t sig_mask;
+	uint32_t flags;
+	uint32_t deadline_msec;
+	uint32_t nqueues;
+	uint32_t queue[KERN_WAIT_MAX_QUEUES];
+};
+
+#endif	/* __KERN_IPC_WAIT_DEFS_H__ */
@@ -28,6 +28,6 @@ align_paddr_t(paddr_t val, uint32_t align)
 {
 	paddr_t v;
 
-	v = (val + (align - (val % align)));
+	v = (val + ((align - (val % align)) % align));
 	return (v);
 }
@@ -26,6 +26,6 @@ align_uint32_t(uint32_t val, uint32_t align)
 {
 	uint32_t v;
 
-	v = (val + (align - (val % align)));
+	v = (val + ((align - (val % align)) % align));
 	return (v);
 }
@@ -19,30 +19,112 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
+
+#include "kern/libraries/crc32/crc32b.h"
+#include "kern/libraries/crc32/crc32b_table.h"
 
 /*
  * Note: MSB-first = 0x04c11db7
  * Note: LSB-first = 0xedb88320
  */
 
+static kern_crc32b_hw_fn_t *kern_crc32b_hw = NULL;
+
+/**
+ * Update a running CRC-32 with more data.
+ *
+ * This works on the raw CRC register - start with 0xffffffff and
+ * invert the result when done.  It's slicing-by-4: four bytes are
+ * folded in per loop with four table lookups, and any leftover
+ * bytes are done one at a time.
+ *
+ * Bytes are assembled by hand so the input doesn't need to be
+ * aligned and it doesn't matter what endian the host is.
+ *
+ * @param[in] crc running CRC register
+ * @param[in] s data
+ * @param[in] n data length in bytes
+ * @retval updated CRC register
+ */
+uint32_t
+kern_crc32b_update(uint32_t crc, const char *s, size_t n)
+{
+	const unsigned char *p = (const unsigned char *) s;
+	uint32_t w;
+
+	while (n >= 4) {
+		w = crc ^ ((uint32_t) p[0] | ((uint32_t) p[1] << 8) |
+		    ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24));
+		crc = kern_crc32b_table[3][w & 0xff] ^
+		    kern_crc32b_table[2][(w >> 8) & 0xff] ^
+		    kern_crc32b_table[1][(w >> 16) & 0xff] ^
+		    kern_crc32b_table[0][w >> 24];
+		p += 4;
+		n -= 4;
+	}
+
+	while (n-- > 0) {
+		crc = kern_crc32b_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	}
+
+	return (crc);
+}
+
+/**
+ * Software CRC-32 (IEEE 802.3, reflected, as used by zlib/ethernet.)
+ */
+uint32_t
+kern_crc32b_sw(const char *s, size_t n)
+{
+
+	return (~kern_crc32b_update(0xffffffff, s, n));
+}
+
+/**
+ * CRC-32 of the given buffer, using the hardware backend if one
+ * has been registered.
+ */
 uint32_t
 kern_crc32b(const char *s, size_t n)
 {
+
+	if (kern_crc32b_hw != NULL)
+		return (kern_crc32b_hw(s, n));
+	return (kern_crc32b_sw(s, n));
+}
+
+/**
+ * Register a hardware CRC-32 backend.
+ *
+ * The backend is first checked against the software implementation
+ * over a range of lengths and alignments (so partial trailing words
+ * get exercised); it's only used if they all match.
+ *
+ * @param[in] fn backend, or NULL to go back to software
+ * @retval true if the backend is now in use, false otherwise
+ */
+bool
+kern_crc32b_set_hw(kern_crc32b_hw_fn_t *fn)
+{
+	char buf[40];
 	size_t i, j;
-	uint32_t b, crc = 0xffffffff;
-	char ch;
-
-	for (i = 0; i < n; i++) {
-		ch = s[i];
-		for (j = 0; j < 8; j++) {
-			b = (ch ^ crc) & 1;
-			crc >>= 1;
-			if (b) {
-				crc = crc ^ 0xedb88320;
-			}
-			ch >>= 1;
+
+	if (fn == NULL) {
+		kern_crc32b_hw = NULL;
+		return (true);
+	}
+
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = (char) (i * 37 + 11);
+
+	for (i = 0; i < 4; i++) {
+		for (j = 0; j + i <= sizeof(buf); j++) {
+			if (fn(buf + i, j) != kern_crc32b_sw(buf + i, j))
+				return (false);
 		}
 	}
 
-	return (~crc);
+	kern_crc32b_hw = fn;
+	return (true);
 }
@@ -19,6 +19,15 @@
 #ifndef	__LIB_CRC_CRC32B_H__
 #define	__LIB_CRC_CRC32B_H__
 
-extern	uint32_ kern_crc32b(const char *s, size_t n);
+/*
+ * A hardware CRC-32 backend; it must compute the same thing
+ * as kern_crc32b().
+ */
+typedef uint32_t kern_crc32b_hw_fn_t(const char *s, size_t n);
+
+extern	uint32_t kern_crc32b(const char *s, size_t n);
+extern	uint32_t kern_crc32b_update(uint32_t crc, const char *s, size_t n);
+extern	uint32_t kern_crc32b_sw(const char *s, size_t n);
+extern	bool kern_crc32b_set_hw(kern_crc32b_hw_fn_t *fn);
 
 #endif	/* __LIB_CRC_CRC32B_H__ */
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <kern/libraries/hash/fnv1a.h>
+
+#define	FNV1A_32_OFFSET_BASIS	0x811c9dc5
+#define	FNV1A_32_PRIME		0x01000193
+
+/*
+ * 32 bit FNV-1a hash.  Cheap and good enough for hashing short
+ * labels/names into small tables.
+ */
+uint32_t
+kern_hash_fnv1a(const char *s, size_t n)
+{
+	uint32_t h = FNV1A_32_OFFSET_BASIS;
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		h ^= (unsigned char) s[i];
+		h *= FNV1A_32_PRIME;
+	}
+
+	return (h);
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "kern/libraries/lz4/lz4.h"
+
+/*
+ * LZ4 block format decompressor.
+ *
+ * This decodes a single LZ4 block (no frame header) straight into
+ * the destination buffer; the already decoded output is the match
+ * window, so there's no working memory beyond a handful of locals.
+ * Everything is bounds checked against both buffers so a corrupt
+ * block can't scribble past dst.
+ *
+ * Each sequence is a token (high nibble literal length, low nibble
+ * match length - 4, 15 meaning "more length bytes follow"), the
+ * literals, then a 16 bit little endian match offset.  The final
+ * sequence is literals only.
+ */
+
+/*
+ * Read a 255-continued length extension.  Returns -1 if the input
+ * runs out.
+ */
+static inline int
+kern_lz4_read_len(const uint8_t **ip, const uint8_t *iend, size_t *len)
+{
+	uint8_t b;
+
+	do {
+		if (*ip >= iend)
+			return (-1);
+		b = *(*ip)++;
+		*len += b;
+	} while (b == 255);
+
+	return (0);
+}
+
+/**
+ * Decompress an LZ4 block.
+ *
+ * @param[in] src compressed block
+ * @param[in] src_len compressed block length
+ * @param[in] dst destination buffer
+ * @param[in] dst_len destination buffer size
+ * @retval number of bytes decompressed, or -1 if the block is corrupt
+ *   or doesn't fit
+ */
+int
+kern_lz4_decompress(const char *src, size_t src_len, char *dst,
+    size_t dst_len)
+{
+	const uint8_t *ip = (const uint8_t *) src;
+	const uint8_t *iend = ip + src_len;
+	uint8_t *op = (uint8_t *) dst;
+	uint8_t *oend = op + dst_len;
+	const uint8_t *match;
+	size_t len, offset;
+	uint8_t token;
+
+	while (ip < iend) {
+		token = *ip++;
+
+		/* Literals */
+		len = token >> 4;
+		if (len == 15 && kern_lz4_read_len(&ip, iend, &len) < 0)
+			return (-1);
+		if (len > (size_t) (iend - ip) || len > (size_t) (oend - op))
+			return (-1);
+		while (len-- > 0)
+			*op++ = *ip++;
+
+		/* The last sequence has no match */
+		if (ip == iend)
+			break;
+
+		/* Match */
+		if (iend - ip < 2)
+			return (-1);
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (size_t) (op - (uint8_t *) dst))
+			return (-1);
+
+		len = token & 0xf;
+		if (len == 15 && kern_lz4_read_len(&ip, iend, &len) < 0)
+			return (-1);
+		len += 4;
+		if (len > (size_t) (oend - op))
+			return (-1);
+
+		/*
+		 * Byte at a time, since the match may overlap what
+		 * it's producing (eg offset 1 is a run.)
+		 */
+		match = op - offset;
+		while (len-- > 0)
+			*op++ = *match++;
+	}
+
+	return (op - (uint8_t *) dst);
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include <hw/types.h>
+
+#include <core/platform.h>
+
+#include <kern/core/error.h>
+#include <kern/core/task.h>
+#include <kern/core/sema.h>
+#include <kern/core/logging.h>
+
+#include <kern/ipc/msgq.h>
+#include <kern/rpc/rpc.h>
+
+LOGGING_DEFINE(LOG_RPC, "rpc", KERN_LOG_LEVEL_INFO);
+
+/*
+ * Reply for a KERN_RPC_CALL; this lives on the caller's stack
+ * and the message cookie points at it.
+ */
+struct kern_rpc_reply {
+	struct kern_sema done;
+	uint32_t retval;
+};
+
+/**
+ * Perform an RPC call to the given server.
+ *
+ * This is what the generated async stubs call.  If the server
+ * isn't running yet, the caller is the server itself, or the
+ * caller can't sleep (eg interrupt context, spinlock held) then
+ * the method is dispatched directly in the caller's context
+ * instead.  That includes oneway calls, so they're never dropped.
+ * Anything wanting the async path has to call in from somewhere
+ * it can sleep - eg the console write op, which is called outside
+ * the console spinlock.
+ *
+ * @param[in] srv server
+ * @param[in] msg marshalled request
+ * @param[in] flags KERN_RPC_* method flags
+ * @retval method return value
+ */
+uint32_t
+kern_rpc_call(struct kern_rpc_server *srv, struct kern_msg *msg,
+    uint32_t flags)
+{
+	struct kern_rpc_reply reply;
+	bool can_sleep;
+
+	if (srv->msgq == KERN_MSGQ_ID_NONE || current_task == &srv->task)
+		goto direct;
+
+	can_sleep = kern_task_sched_running() && platform_cpu_can_sleep();
+	if (can_sleep == false)
+		goto direct;
+
+	if (flags & KERN_RPC_ONEWAY) {
+		msg->cookie = 0;
+		if (kern_msgq_send(srv->msgq, msg, 0) != KERN_ERR_OK)
+			goto direct;
+		return (0);
+	}
+
+	kern_sema_init(&reply.done, srv->name, 0);
+	reply.retval = 0;
+	msg->cookie = (uintptr_t) &reply;
+	if (kern_msgq_send(srv->msgq, msg, 0) != KERN_ERR_OK)
+		goto direct;
+	/* can_sleep already checked the scheduler is running */
+	(void) kern_sema_take(&reply.done);
+	return (reply.retval);
+
+direct:
+	srv->direct++;
+	return (srv->dispatch(msg));
+}
+
+static void
+kern_rpc_server_task_fn(void *arg)
+{
+	struct kern_rpc_server *srv = arg;
+	struct kern_rpc_reply *reply;
+	struct kern_msg msg;
+	uint32_t ret;
+
+	KERN_LOG(LOG_RPC, KERN_LOG_LEVEL_INFO, "[%s] server started",
+	    srv->name);
+
+	while (1) {
+		if (kern_msgq_recv(srv->msgq, &msg, 0) != KERN_ERR_OK)
+			continue;
+
+		ret = srv->dispatch(&msg);
+		srv->calls++;
+
+		if (msg.cookie != 0) {
+			reply = (struct kern_rpc_reply *) msg.cookie;
+			reply->retval = ret;
+			kern_sema_give(&reply->done);
+		}
+	}
+}
+
+/**
+ * Create the request queue and server task for the given server.
+ *
+ * Until this is called (and for callers which can't sleep) calls
+ * through the async stubs are dispatched directly.
+ *
+ * @param[in] srv server, from KERN_RPC_SERVER()
+ * @param[in] depth request queue depth
+ * @param[in] stack kernel stack for the server task
+ * @param[in] stack_size size of the kernel stack
+ * @param[in] priority server task priority
+ * @retval true if started, false otherwise
+ */
+bool
+kern_rpc_server_start(struct kern_rpc_server *srv, uint32_t depth,
+    stack_addr_t stack, int stack_size, uint8_t priority)
+{
+	kern_msgq_id_t q;
+
+	q = kern_msgq_create(srv->name, depth);
+	if (q == KERN_MSGQ_ID_NONE) {
+		KERN_LOG(LOG_RPC, KERN_LOG_LEVEL_CRIT,
+		    "[%s] failed to create request queue", srv->name);
+		return (false);
+	}
+
+	kern_task_init(&srv->task, kern_rpc_server_task_fn, srv, srv->name,
+	    stack, stack_size, 0);
+	srv->task.priority = srv->task.base_priority = priority;
+
+	/* Publish the queue last; callers dispatch directly until then */
+	srv->msgq = q;
+	kern_task_start(&srv->task);
+	return (true);
+}
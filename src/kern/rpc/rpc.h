@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+#ifndef	__KERN_RPC_H__
+#define	__KERN_RPC_H__
+
+#include <kern/core/task.h>
+#include <kern/ipc/msgq.h>
+#include <kern/rpc/rpc_defs.h>
+
+/*
+ * Driver RPC.
+ *
+ * A driver interface is described once as an X-macro list of
+ * methods, eg:
+ *
+ * #define	FOO_RPC_METHODS(METHOD)				\
+ *	METHOD(foo, 1, write, 2, KERN_RPC_CALL)			\
+ *	METHOD(foo, 2, poke, 1, KERN_RPC_ONEWAY)
+ *
+ * Each method takes 'nargs' (up to KERN_MSGQ_MSG_WORDS) uint32_t
+ * arguments and returns a uint32_t.  The driver implements
+ * foo_write() / foo_poke().
+ *
+ * KERN_RPC_INTERFACE() then generates, for each method:
+ *
+ * + foo_direct_write() - calls foo_write() directly;
+ * + foo_async_write() - marshals the call into a message, sends it
+ *   to the driver server task and (for KERN_RPC_CALL) sleeps until
+ *   the reply comes back.
+ *
+ * and KERN_RPC_SELECT_DIRECT() / KERN_RPC_SELECT_ASYNC() map the
+ * foo_rpc_write() entry point that clients use onto one of them.
+ * The interface header picks which one based on a build flag, so
+ * the choice is made per driver at build time.  Both sets of stubs
+ * are always generated so they can be benchmarked against each other.
+ *
+ * The driver side uses KERN_RPC_SERVER() to generate the dispatch
+ * function and the server, and kern_rpc_server_start() to create
+ * the task that services requests.
+ *
+ * The same method list also drives userland drivers and clients;
+ * see user/include/wtf_rpc.h.
+ */
+
+typedef	uint32_t kern_rpc_dispatch_fn_t(const struct kern_msg *msg);
+
+/**
+ * struct kern_rpc_server - a driver RPC server.
+ *
+ * @name interface name, also used for the queue / task name
+ * @dispatch generated dispatch function
+ * @msgq request queue, KERN_MSGQ_ID_NONE until the server is started
+ * @task server task
+ * @calls requests serviced by the server task
+ * @direct calls dispatched directly because the caller couldn't sleep
+ */
+struct kern_rpc_server {
+	const char *name;
+	kern_rpc_dispatch_fn_t *dispatch;
+	kern_msgq_id_t msgq;
+	struct kern_task task;
+	uint32_t calls;
+	uint32_t direct;
+};
+
+extern	uint32_t kern_rpc_call(struct kern_rpc_server *srv,
+	    struct kern_msg *msg, uint32_t flags);
+extern	bool kern_rpc_server_start(struct kern_rpc_server *srv,
+	    uint32_t depth, stack_addr_t stack, int stack_size,
+	    uint8_t priority);
+
+/* Generators, one per method */
+
+#define	KERN_RPC_GEN_PROTO(iface, id, name, nargs, flags)		\
+	extern uint32_t iface##_##name(KERN_RPC_PARAMS_##nargs);
+
+#define	KERN_RPC_GEN_DIRECT(iface, id, name, nargs, flags)		\
+	static inline uint32_t						\
+	iface##_direct_##name(KERN_RPC_PARAMS_##nargs)			\
+	{								\
+		return (iface##_##name(KERN_RPC_ARGS_##nargs));		\
+	}
+
+#define	KERN_RPC_GEN_ASYNC(iface, id, name, nargs, flags)		\
+	static inline uint32_t						\
+	iface##_async_##name(KERN_RPC_PARAMS_##nargs)			\
+	{								\
+		struct kern_msg m = { 0 };				\
+		m.type = (id);						\
+		KERN_RPC_PACK_##nargs(&m)				\
+		return (kern_rpc_call(&iface##_rpc_server, &m,		\
+		    (flags)));						\
+	}
+
+#define	KERN_RPC_GEN_SELECT_DIRECT(iface, id, name, nargs, flags)	\
+	static inline uint32_t						\
+	iface##_rpc_##name(KERN_RPC_PARAMS_##nargs)			\
+	{								\
+		return (iface##_direct_##name(KERN_RPC_ARGS_##nargs));	\
+	}
+
+#define	KERN_RPC_GEN_SELECT_ASYNC(iface, id, name, nargs, flags)	\
+	static inline uint32_t						\
+	iface##_rpc_##name(KERN_RPC_PARAMS_##nargs)			\
+	{								\
+		return (iface##_async_##name(KERN_RPC_ARGS_##nargs));	\
+	}
+
+#define	KERN_RPC_GEN_DISPATCH(iface, id, name, nargs, flags)		\
+	case (id):							\
+		return (iface##_##name(KERN_RPC_UNPACK_##nargs(msg)));
+
+/* Per-interface generators */
+
+#define	KERN_RPC_INTERFACE(iface, METHODS)				\
+	extern struct kern_rpc_server iface##_rpc_server;		\
+	METHODS(KERN_RPC_GEN_PROTO)					\
+	METHODS(KERN_RPC_GEN_DIRECT)					\
+	METHODS(KERN_RPC_GEN_ASYNC)
+
+#define	KERN_RPC_SELECT_DIRECT(METHODS)					\
+	METHODS(KERN_RPC_GEN_SELECT_DIRECT)
+
+#define	KERN_RPC_SELECT_ASYNC(METHODS)					\
+	METHODS(KERN_RPC_GEN_SELECT_ASYNC)
+
+#define	KERN_RPC_SERVER(iface, METHODS)					\
+	static uint32_t							\
+	iface##_rpc_dispatch(const struct kern_msg *msg)		\
+	{								\
+		switch (msg->type) {					\
+		METHODS(KERN_RPC_GEN_DISPATCH)				\
+		default:						\
+			return (KERN_RPC_RET_BADMETHOD);		\
+		}							\
+	}								\
+	struct kern_rpc_server iface##_rpc_server = {			\
+		.name = #iface,						\
+		.dispatch = iface##_rpc_dispatch,			\
+		.msgq = KERN_MSGQ_ID_NONE,				\
+	};
+
+#endif	/* __KERN_RPC_H__ */
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef	__KERN_RPC_DEFS_H__
+#define	__KERN_RPC_DEFS_H__
+
+/*
+ * Driver RPC definitions shared between the kernel (kern/rpc/rpc.h)
+ * and userland (user/include/wtf_rpc.h), so one method list can be
+ * used on both sides.  Plain types only.
+ */
+
+/* Method flags */
+#define	KERN_RPC_CALL			0x00000000
+#define	KERN_RPC_ONEWAY			0x00000001
+
+/* Returned for an unknown method */
+#define	KERN_RPC_RET_BADMETHOD		0xffffffff
+/* Returned by a userland stub if the request or reply was lost */
+#define	KERN_RPC_RET_FAILED		0xfffffffe
+
+/*
+ * Userland requests carry the method id in the low 16 bits of the
+ * message type and the queue to send the reply to in the top 16 bits
+ * (0 for a oneway call).  The reply's type is the method id and
+ * arg[0] is the return value.
+ */
+#define	KERN_RPC_MSG_TYPE(id, reply_qid)				\
+	(((uint32_t) (reply_qid) << 16) | ((uint32_t) (id) & 0xffff))
+#define	KERN_RPC_MSG_ID(type)		((type) & 0xffff)
+#define	KERN_RPC_MSG_REPLY_QID(type)	((type) >> 16)
+
+/* Method parameter lists and (un)marshalling, by argument count */
+#define	KERN_RPC_PARAMS_0	void
+#define	KERN_RPC_PARAMS_1	uint32_t a0
+#define	KERN_RPC_PARAMS_2	uint32_t a0, uint32_t a1
+#define	KERN_RPC_PARAMS_3	uint32_t a0, uint32_t a1, uint32_t a2
+
+#define	KERN_RPC_ARGS_0
+#define	KERN_RPC_ARGS_1		a0
+#define	KERN_RPC_ARGS_2		a0, a1
+#define	KERN_RPC_ARGS_3		a0, a1, a2
+
+#define	KERN_RPC_PACK_0(m)
+#define	KERN_RPC_PACK_1(m)	(m)->arg[0] = a0;
+#define	KERN_RPC_PACK_2(m)	KERN_RPC_PACK_1(m) (m)->arg[1] = a1;
+#define	KERN_RPC_PACK_3(m)	KERN_RPC_PACK_2(m) (m)->arg[2] = a2;
+
+#define	KERN_RPC_UNPACK_0(m)
+#define	KERN_RPC_UNPACK_1(m)	(m)->arg[0]
+#define	KERN_RPC_UNPACK_2(m)	(m)->arg[0], (m)->arg[1]
+#define	KERN_RPC_UNPACK_3(m)	(m)->arg[0], (m)->arg[1], (m)->arg[2]
+
+#endif	/* __KERN_RPC_DEFS_H__ */
@@ -37,22 +37,16 @@
  * (And yes, that's also what an MMU, MPU, etc is for.)
  */
 syscall_retval_t
-kern_syscall_handler(syscall_arg_t arg, syscall_arg_t arg2,
-    syscall_arg_t arg3, syscall_arg_t arg4)
+kern_syscall_handler(uint32_t syscall_id, syscall_arg_t arg1,
+    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4)
 {
 	syscall_retval_t retval = -1;
-	uint16_t arg1, syscall_id;
 
 	/*
-	 * arg1 on a 32 bit platform is defined as:
-	 *
-	 * | uint16 arg1 | uint16 syscall_id |
-	 *
-	 * XXX TODO: for 64 bit platforms we'll have to fix this!
-	 * (XXX TODO: eg move the decoding into the platform layer maybe?)
+	 * The platform layer has already decoded the syscall id
+	 * (the SVC immediate on ARM) so all four arguments are
+	 * full width.
 	 */
-	syscall_id = (arg & 0x0000ffff);
-	arg1 = (arg & 0xffff0000) >> 16;
 
 	/* Demux appropriately */
 	switch (syscall_id) {
@@ -65,6 +59,103 @@ kern_syscall_handler(syscall_arg_t arg, syscall_arg_t arg2,
 	case SYSCALL_ID_TASK_EXIT:
 		retval = kern_syscall_exit(arg1, arg2, arg3, arg4);
 		break;
+	case SYSCALL_ID_MSGQ_SEND:
+		retval = kern_syscall_msgq_send(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_MSGQ_RECV:
+		retval = kern_syscall_msgq_recv(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_MSGQ_LOOKUP:
+		retval = kern_syscall_msgq_lookup(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_MSGQ_CREATE:
+		retval = kern_syscall_msgq_create(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_SHM_CREATE:
+		retval = kern_syscall_shm_create(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_SHM_GRANT:
+		retval = kern_syscall_shm_grant(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_SHM_REVOKE:
+		retval = kern_syscall_shm_revoke(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_SHM_ADDR:
+		retval = kern_syscall_shm_addr(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_TASK_SPAWN:
+		retval = kern_syscall_task_spawn(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_HEAP_INFO:
+		retval = kern_syscall_heap_info(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_HEAP_GROW:
+		retval = kern_syscall_heap_grow(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_NOP:
+		retval = kern_syscall_nop(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_RING_SETUP:
+		retval = kern_syscall_ring_setup(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_RING_ENTER:
+		retval = kern_syscall_ring_enter(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_FUTEX_WAIT:
+		retval = kern_syscall_futex_wait(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_FUTEX_WAKE:
+		retval = kern_syscall_futex_wake(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_WAIT_ANY:
+		retval = kern_syscall_wait_any(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_SLEEP_UNTIL:
+		retval = kern_syscall_sleep_until(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_SHM_DESTROY:
+		retval = kern_syscall_shm_destroy(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_MSGQ_SEND_SHM:
+		retval = kern_syscall_msgq_send_shm(arg1, arg2, arg3, arg4);
+		break;
+	default:
+		retval = -1;
+		break;
+	}
+
+	return (retval);
+}
+
+/*
+ * Fast syscall handler.
+ *
+ * This is called by the platform code from the SVC exception itself
+ * for ids at or above SYSCALL_ID_FAST_BASE, so there's no trip through
+ * thread mode.  Anything in here must not block.
+ */
+syscall_retval_t
+kern_syscall_fast_handler(uint32_t syscall_id, syscall_arg_t arg1,
+    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4)
+{
+	syscall_retval_t retval;
+
+	switch (syscall_id) {
+	case SYSCALL_ID_FAST_NOP:
+		retval = kern_syscall_nop(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_FAST_GET_TIME:
+		retval = kern_syscall_get_time(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_FAST_GET_CYCLES:
+		retval = kern_syscall_get_cycles(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_FAST_GET_TASK_ID:
+		retval = kern_syscall_get_task_id(arg1, arg2, arg3, arg4);
+		break;
+	case SYSCALL_ID_FAST_GET_INFO_PAGE:
+		retval = kern_syscall_get_info_page(arg1, arg2, arg3, arg4);
+		break;
 	default:
 		retval = -1;
 		break;
@@ -19,13 +19,25 @@
 #ifndef	__KERN_SYSCALL_H__
 #define	__KERN_SYSCALL_H__
 
+/*
+ * Syscall ABI: the syscall id is the SVC immediate, so ids have to
+ * fit in 8 bits.  Arguments are passed in r0..r3 (arg1..arg4) and the
+ * 64 bit return value comes back in r0/r1.  The userland side of this
+ * is user/include/wtf_syscall.h.
+ *
+ * Ids from SYSCALL_ID_FAST_BASE up are fast syscalls; they're run
+ * directly from the SVC exception rather than in thread mode on the
+ * task's kernel stack, so they must be short and never block.
+ */
+#define	SYSCALL_ID_FAST_BASE			0x0080
+
 /*
  * Write to console: XXX TODO: temporary syscall for debugging
  * before we have device drivers!
  *
- * arg1 - na
- * arg2 - char *
- * arg3 - uint32_t
+ * arg1 - char *
+ * arg2 - uint32_t length
+ * arg3 - na
  * arg4 - na
  */
 #define	SYSCALL_ID_CONSOLE_WRITE		0x0001
@@ -35,8 +47,9 @@ extern	syscall_retval_t kern_syscall_putsn(syscall_arg_t arg1,
 /*
  * Sleep for n milliseconds
  *
- * arg1 - na
- * arg2 - uint32_t milliseconds
+ * arg1 - uint32_t milliseconds
+ * arg2 - uint32_t slack; milliseconds the wakeup may be deferred by
+ *        so it can be batched with other timers, or 0
  * arg3 - na
  * arg4 - na
  */
@@ -50,7 +63,7 @@ extern	syscall_retval_t kern_syscall_sleep(syscall_arg_t arg1,
 /*
  * Exit the current userland task.
  *
- * arg1 - uint32_t exit status
+ * arg1 - uint32_t exit status, reported to the task that spawned it
  * arg2 - na
  * arg3 - na
  * arg4 - na
@@ -59,8 +72,378 @@ extern	syscall_retval_t kern_syscall_sleep(syscall_arg_t arg1,
 extern	syscall_retval_t kern_syscall_exit(syscall_arg_t arg1,
 	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
 
+/*
+ * Send a small message to a message queue, entirely in registers.
+ * The message has no buffer attached and arg[2] is zero.
+ *
+ * arg1 - uint32_t queue id
+ * arg2 - uint32_t message type
+ * arg3 - uint32_t arg[0]
+ * arg4 - uint32_t arg[1]
+ *
+ * Returns a kern_error_t.  Sends block if the queue is full.
+ */
+#define	SYSCALL_ID_MSGQ_SEND			0x0005
+extern	syscall_retval_t kern_syscall_msgq_send(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Receive a message from a message queue.
+ *
+ * arg1 - uint32_t queue id
+ * arg2 - struct kern_msg * to copy the message out to
+ * arg3 - uint32_t flags (KERN_MSGQ_FLAG_*)
+ * arg4 - na
+ *
+ * If the message has a buffer attached (eg from
+ * SYSCALL_ID_MSGQ_SEND_SHM) then the buffer itself becomes a shared
+ * memory region owned by and mapped into the caller - it isn't
+ * copied.  buf is its address and the region id is returned in the
+ * high 32 bits; the caller frees it with SYSCALL_ID_SHM_DESTROY.  If
+ * it can't be mapped the message is still returned, without the
+ * buffer, and KERN_ERR_NOMEM is returned.
+ *
+ * Returns a kern_error_t in the low 32 bits.
+ */
+#define	SYSCALL_ID_MSGQ_RECV			0x0006
+extern	syscall_retval_t kern_syscall_msgq_recv(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Lookup a message queue by name.
+ *
+ * arg1 - const char * name
+ * arg2 - uint32_t name length
+ * arg3 - na
+ * arg4 - na
+ *
+ * Returns the queue id, or 0 if not found.
+ */
+#define	SYSCALL_ID_MSGQ_LOOKUP			0x0007
+extern	syscall_retval_t kern_syscall_msgq_lookup(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Create a message queue.
+ *
+ * arg1 - const char * name
+ * arg2 - uint32_t name length
+ * arg3 - uint32_t depth
+ * arg4 - na
+ *
+ * Returns the queue id, or 0 on error.
+ */
+#define	SYSCALL_ID_MSGQ_CREATE			0x0008
+extern	syscall_retval_t kern_syscall_msgq_create(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Create a shared memory region, mapped read/write into the caller.
+ *
+ * arg1 - uint32_t size; rounded up to an MPU compatible size
+ * arg2 - na
+ * arg3 - na
+ * arg4 - na
+ *
+ * Returns the region id, or 0 on error.
+ */
+#define	SYSCALL_ID_SHM_CREATE			0x0009
+extern	syscall_retval_t kern_syscall_shm_create(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Grant another task access to a shared memory region we own.
+ *
+ * arg1 - uint32_t region id
+ * arg2 - kern_task_id_t task to grant access to
+ * arg3 - uint32_t 1 for read/write, 0 for read-only
+ * arg4 - na
+ *
+ * Returns a kern_error_t.
+ */
+#define	SYSCALL_ID_SHM_GRANT			0x000a
+extern	syscall_retval_t kern_syscall_shm_grant(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Revoke a task's access to a shared memory region we own.
+ * Revoking our own access destroys the region.
+ *
+ * arg1 - uint32_t region id
+ * arg2 - kern_task_id_t task to revoke access from
+ * arg3 - na
+ * arg4 - na
+ *
+ * Returns a kern_error_t.
+ */
+#define	SYSCALL_ID_SHM_REVOKE			0x000b
+extern	syscall_retval_t kern_syscall_shm_revoke(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Get the address of a shared memory region mapped into the caller.
+ *
+ * arg1 - uint32_t region id
+ * arg2 - na
+ * arg3 - na
+ * arg4 - na
+ *
+ * Returns the region address, or 0 if it isn't mapped.
+ */
+#define	SYSCALL_ID_SHM_ADDR			0x000c
+extern	syscall_retval_t kern_syscall_shm_addr(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Spawn a user task from a flash resource pak.
+ *
+ * The caller is signalled with KERN_SIGNAL_TASK_CHILD_EXIT when the
+ * new task exits and, if a queue is given, is sent a
+ * KERN_TASK_MSG_TYPE_EXIT message with the task id and exit status.
+ *
+ * arg1 - uint32_t message queue id for the exit status, or 0; it
+ *   must be an existing queue
+ * arg2 - const char * pak label
+ * arg3 - uint32_t label length
+ * arg4 - uint32_t argument passed to the new task in r0
+ *
+ * Returns the new task id, or 0 on error.
+ */
+#define	SYSCALL_ID_TASK_SPAWN			0x000d
+extern	syscall_retval_t kern_syscall_task_spawn(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Get the task's initial heap region.
+ *
+ * arg1 - uint32_t[2] filled in with the heap address and size
+ * arg2 - na
+ * arg3 - na
+ * arg4 - na
+ *
+ * Returns a kern_error_t.
+ */
+#define	SYSCALL_ID_HEAP_INFO			0x000e
+extern	syscall_retval_t kern_syscall_heap_info(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Add more RAM to the end of the task's heap.
+ *
+ * The heap is extended in place, so the new region starts right
+ * after the existing heap (including any earlier grows.)  The size
+ * is rounded up to what the MPU can map.  This fails once the RAM
+ * after the heap is in use or the task's arena can't be made any
+ * bigger.
+ *
+ * arg1 - uint32_t minimum size in bytes
+ * arg2 - uint32_t[2] filled in with the region address and size
+ * arg3 - na
+ * arg4 - na
+ *
+ * Returns a kern_error_t.
+ */
+#define	SYSCALL_ID_HEAP_GROW			0x000f
+extern	syscall_retval_t kern_syscall_heap_grow(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Do nothing; the slow path equivalent of SYSCALL_ID_FAST_NOP, for
+ * measuring syscall overhead.
+ *
+ * arg1..arg4 - na
+ *
+ * Returns 0.
+ */
+#define	SYSCALL_ID_NOP				0x0010
+extern	syscall_retval_t kern_syscall_nop(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Set up the caller's async submission / completion rings
+ * (see kern/ipc/ring_defs.h.)  A task only gets one set.
+ *
+ * arg1 - uint32_t submission ring entries, a power of two
+ * arg2 - uint32_t completion ring entries, a power of two
+ * arg3 - uint32_t KERN_RING_SETUP_F_* flags
+ * arg4 - na
+ *
+ * Returns the address of the ring region (mapped read/write into
+ * the caller), or 0 on error.
+ */
+#define	SYSCALL_ID_RING_SETUP			0x0011
+extern	syscall_retval_t kern_syscall_ring_setup(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Consume the caller's submission ring and optionally wait for
+ * completions.
+ *
+ * arg1 - uint32_t completions to wait for, or 0 to not wait
+ * arg2..arg4 - na
+ *
+ * Returns a kern_error_t in the low 32 bits and the number of
+ * submissions consumed in the high 32 bits.
+ */
+#define	SYSCALL_ID_RING_ENTER			0x0012
+extern	syscall_retval_t kern_syscall_ring_enter(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Sleep until woken with SYSCALL_ID_FUTEX_WAKE, if the 32 bit word
+ * at the given address still holds the given value.
+ *
+ * arg1 - uaddr_t of the futex word, word aligned
+ * arg2 - uint32_t expected value
+ * arg3..arg4 - na
+ *
+ * Returns KERN_ERR_OK once woken, KERN_ERR_AGAIN if the word didn't
+ * hold the expected value, or another kern_error_t.
+ */
+#define	SYSCALL_ID_FUTEX_WAIT			0x0013
+extern	syscall_retval_t kern_syscall_futex_wait(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Wake up tasks sleeping on a futex word.
+ *
+ * arg1 - uaddr_t of the futex word
+ * arg2 - uint32_t maximum number of tasks to wake
+ * arg3..arg4 - na
+ *
+ * Returns the number of tasks woken.
+ */
+#define	SYSCALL_ID_FUTEX_WAKE			0x0014
+extern	syscall_retval_t kern_syscall_futex_wake(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Wait for any of a set of signals, message queues to have messages
+ * in them, or a deadline.
+ *
+ * arg1 - struct kern_wait_args (see kern/ipc/wait_defs.h)
+ * arg2..arg4 - na
+ *
+ * Returns the KERN_WAIT_READY_* bitmap in the low 32 bits and the
+ * signals that were posted in the high 32 bits, or 0 on error.
+ */
+#define	SYSCALL_ID_WAIT_ANY			0x0015
+extern	syscall_retval_t kern_syscall_wait_any(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Sleep until an absolute kernel tick.
+ *
+ * Sleeping until a deadline rather than for a duration lets a
+ * periodic task keep to its period without drifting.
+ *
+ * arg1 - uint32_t kernel tick in milliseconds (see the info page
+ *        tick_msec); compared with wraparound
+ * arg2..arg4 - na
+ *
+ * Returns 0 if it slept, 1 if the tick had already passed, -1 on
+ * error.
+ */
+#define	SYSCALL_ID_SLEEP_UNTIL			0x0016
+extern	syscall_retval_t kern_syscall_sleep_until(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Destroy a shared memory region, unmapping it from every task.
+ *
+ * arg1 - uint32_t region id; the caller must own it
+ * arg2..arg4 - na
+ *
+ * Returns a kern_error_t.
+ */
+#define	SYSCALL_ID_SHM_DESTROY			0x0017
+extern	syscall_retval_t kern_syscall_shm_destroy(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Send a message with a shared memory region attached as its buffer.
+ *
+ * The region moves to the receiver rather than being copied; it's
+ * unmapped from the caller and everyone it was granted to, and the
+ * receiver gets it as a region it owns (see SYSCALL_ID_MSGQ_RECV).
+ * buf_len is the region size, so put the payload length in arg[0]
+ * if it matters.
+ *
+ * arg1 - uint32_t queue id
+ * arg2 - uint32_t message type
+ * arg3 - uint32_t region id; the caller must own it
+ * arg4 - uint32_t arg[0]
+ *
+ * Returns a kern_error_t in the low 32 bits.  Sends block if the
+ * queue is full.  If the send fails the region is handed back to
+ * the caller, possibly under a new id which is returned in the
+ * high 32 bits.
+ */
+#define	SYSCALL_ID_MSGQ_SEND_SHM		0x0018
+extern	syscall_retval_t kern_syscall_msgq_send_shm(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Fast syscall: do nothing.
+ *
+ * arg1..arg4 - na
+ *
+ * Returns 0.
+ */
+#define	SYSCALL_ID_FAST_NOP			0x0080
+
+/*
+ * Fast syscall: get the current time.
+ *
+ * arg1..arg4 - na
+ *
+ * Returns the kernel tick count in milliseconds.
+ */
+#define	SYSCALL_ID_FAST_GET_TIME		0x0081
+extern	syscall_retval_t kern_syscall_get_time(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Fast syscall: get the CPU cycle counter, which userland can't
+ * read directly.
+ *
+ * arg1..arg4 - na
+ *
+ * Returns the cycle count.
+ */
+#define	SYSCALL_ID_FAST_GET_CYCLES		0x0082
+extern	syscall_retval_t kern_syscall_get_cycles(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
+
+/*
+ * Fast syscall: get the caller's task id.
+ *
+ * arg1..arg4 - na
+ *
+ * Returns the kern_task_id_t.
+ */
+#define	SYSCALL_ID_FAST_GET_TASK_ID		0x0083
+extern	syscall_retval_t kern_syscall_get_task_id(syscall_arg_t arg1,
+	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
 
-extern	syscall_retval_t kern_syscall_handler(syscall_arg_t arg1,
+/*
+ * Fast syscall: get the address of the kernel info page
+ * (struct kern_info_page), which is mapped read-only into every
+ * task.  It doesn't move, so this only needs doing once.
+ *
+ * arg1..arg4 - na
+ *
+ * Returns the info page address.
+ */
+#define	SYSCALL_ID_FAST_GET_INFO_PAGE		0x0084
+extern	syscall_retval_t kern_syscall_get_info_page(syscall_arg_t arg1,
 	    syscall_arg_t arg2, syscall_arg_t arg3, syscall_arg_t arg4);
 
+extern	syscall_retval_t kern_syscall_handler(uint32_t syscall_id,
+	    syscall_arg_t arg1, syscall_arg_t arg2, syscall_arg_t arg3,
+	    syscall_arg_t arg4);
+extern	syscall_retval_t kern_syscall_fast_handler(uint32_t syscall_id,
+	    syscall_arg_t arg1, syscall_arg_t arg2, syscall_arg_t arg3,
+	    syscall_arg_t arg4);
+
 #endif	/* __KERN_SYSCALL_H__ */
@@ -34,7 +34,7 @@ kern_syscall_exit(syscall_arg_t arg1, syscall_arg_t arg2,
 {
 
 	/* Mark the current task as exiting */
-	kern_task_exit();
+	kern_task_exit_status(arg1);
 
 	/* Keep context switching until we're cleaned up */
 	while (true) {
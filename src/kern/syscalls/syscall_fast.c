@@ -0,0 +1,68 @@
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include <hw/types.h>
+
+#include <kern/libraries/string/string.h>
+#include <kern/libraries/list/list.h>
+#include <kern/libraries/container/container.h>
+
+#include <core/platform.h>
+#include <core/lock.h>
+
+#include <kern/core/exception.h>
+#include <kern/core/signal.h>
+#include <kern/core/task.h>
+#include <kern/core/timer.h>
+#include <kern/core/info_page.h>
+#include <kern/console/console.h>
+#include <kern/syscalls/syscall.h>
+
+/*
+ * Fast syscalls.
+ *
+ * These are run straight from the SVC exception, so they can't
+ * block, take locks, touch user memory or do anything that'd
+ * need a context switch.
+ */
+
+syscall_retval_t
+kern_syscall_nop(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+
+	return (0);
+}
+
+syscall_retval_t
+kern_syscall_get_time(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+
+	return (kern_timer_tick_msec);
+}
+
+syscall_retval_t
+kern_syscall_get_cycles(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+
+	return (platform_cpu_cycle_count());
+}
+
+syscall_retval_t
+kern_syscall_get_task_id(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+
+	return (kern_task_current_id());
+}
+
+syscall_retval_t
+kern_syscall_get_info_page(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+
+	return (kern_info_page_addr());
+}
@@ -0,0 +1,28 @@
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include <hw/types.h>
+
+#include <kern/libraries/list/list.h>
+
+#include <core/platform.h>
+
+#include <kern/core/error.h>
+#include <kern/core/task.h>
+#include <kern/core/futex.h>
+#include <kern/syscalls/syscall.h>
+
+syscall_retval_t
+kern_syscall_futex_wait(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+	return (kern_futex_wait(arg1, arg2));
+}
+
+syscall_retval_t
+kern_syscall_futex_wake(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+	return (kern_futex_wake(arg1, arg2));
+}
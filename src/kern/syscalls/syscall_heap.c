@@ -0,0 +1,70 @@
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include <hw/types.h>
+
+#include <kern/libraries/string/string.h>
+#include <kern/libraries/list/list.h>
+#include <kern/libraries/container/container.h>
+
+#include <core/platform.h>
+#include <core/lock.h>
+#include <core/user_ram_access.h>
+
+#include <kern/core/error.h>
+#include <kern/core/exception.h>
+#include <kern/core/signal.h>
+#include <kern/core/task.h>
+#include <kern/core/task_mem.h>
+#include <kern/core/task_mem_alloc.h>
+#include <kern/core/timer.h>
+#include <kern/console/console.h>
+#include <kern/syscalls/syscall.h>
+
+/*
+ * Copy a heap region out as { uint32_t addr, uint32_t size }.
+ */
+static syscall_retval_t
+kern_syscall_heap_copyout(paddr_t addr, paddr_size_t size, uaddr_t uaddr)
+{
+	uint32_t region[2];
+
+	region[0] = addr;
+	region[1] = size;
+	if (platform_user_ram_copy_to_user((paddr_t) &region, uaddr,
+	    sizeof(region)) == false)
+		return (KERN_ERR_INVALID_ARGS);
+	return (KERN_ERR_OK);
+}
+
+syscall_retval_t
+kern_syscall_heap_info(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+	struct task_mem *tm = &current_task->task_mem;
+
+	return (kern_syscall_heap_copyout(
+	    kern_task_mem_get_start(tm, TASK_MEM_ID_USER_HEAP),
+	    kern_task_mem_get_size(tm, TASK_MEM_ID_USER_HEAP), arg1));
+}
+
+/*
+ * The heap grows in place at the end of the task's arena, so it
+ * doesn't use up any more MPU slots; see
+ * platform_user_task_heap_grow().  If the copyout fails the heap has
+ * still grown, it's just that the caller doesn't know about it.
+ */
+syscall_retval_t
+kern_syscall_heap_grow(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+	paddr_t addr;
+	paddr_size_t size;
+
+	if (platform_user_task_heap_grow(current_task, arg1, &addr,
+	    &size) == false)
+		return (KERN_ERR_NOMEM);
+
+	return (kern_syscall_heap_copyout(addr, size, arg2));
+}
@@ -0,0 +1,149 @@
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include <hw/types.h>
+
+#include <kern/libraries/string/string.h>
+#include <kern/libraries/list/list.h>
+#include <kern/libraries/container/container.h>
+
+#include <core/platform.h>
+#include <core/lock.h>
+#include <core/user_ram_access.h>
+
+#include <kern/core/exception.h>
+#include <kern/core/signal.h>
+#include <kern/core/task.h>
+#include <kern/core/timer.h>
+#include <kern/console/console.h>
+#include <kern/syscalls/syscall.h>
+#include <kern/core/physmem.h>
+#include <kern/ipc/msgq.h>
+#include <kern/ipc/shm.h>
+
+/*
+ * Copy a queue name in from userland, NUL terminating it.
+ */
+static bool
+kern_syscall_msgq_copyin_name(syscall_arg_t uaddr, syscall_arg_t len,
+    char *name)
+{
+	if (len == 0 || len >= KERN_MSGQ_NAME_SZ)
+		return (false);
+	if (platform_user_ram_copy_from_user(uaddr, (paddr_t) name, len)
+	    == false)
+		return (false);
+	name[len] = '\0';
+	return (true);
+}
+
+syscall_retval_t
+kern_syscall_msgq_send(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+	struct kern_msg msg = { 0 };
+
+	msg.type = arg2;
+	msg.arg[0] = arg3;
+	msg.arg[1] = arg4;
+
+	return (kern_msgq_send(arg1, &msg, 0));
+}
+
+syscall_retval_t
+kern_syscall_msgq_send_shm(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+	struct kern_msg msg = { 0 };
+	kern_shm_id_t id;
+	paddr_size_t size;
+	kern_error_t ret;
+
+	if (kern_msgq_exists(arg1) == false)
+		return (KERN_ERR_INVALID_ARGS);
+
+	/*
+	 * The region's memory goes along with the message as its
+	 * buffer; it's unmapped from us (and anyone we granted it to)
+	 * until the receiver adopts it.
+	 */
+	ret = kern_shm_detach(arg3, current_task, &msg.buf, &size);
+	if (ret != KERN_ERR_OK)
+		return (ret);
+	msg.type = arg2;
+	msg.arg[0] = arg4;
+	msg.buf_len = size;
+
+	ret = kern_msgq_send(arg1, &msg, 0);
+	if (ret == KERN_ERR_OK)
+		return (KERN_ERR_OK);
+
+	/* Take it back; it may well come back under a different id */
+	id = kern_shm_adopt(current_task, msg.buf, size);
+	if (id == KERN_SHM_ID_NONE) {
+		kern_physmem_free(msg.buf);
+		return (KERN_ERR_NOMEM);
+	}
+	return (((syscall_retval_t) id << 32) | ret);
+}
+
+syscall_retval_t
+kern_syscall_msgq_recv(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+	struct kern_msg msg;
+	kern_shm_id_t shm_id = KERN_SHM_ID_NONE;
+	kern_error_t ret;
+
+	ret = kern_msgq_recv(arg1, &msg, arg3);
+	if (ret != KERN_ERR_OK)
+		return (ret);
+
+	/*
+	 * Hand the buffer itself over as a region we own.  The message
+	 * has been taken off the queue, so if that fails the buffer is
+	 * gone; say so rather than quietly returning the message
+	 * without it.
+	 */
+	if (msg.buf != 0) {
+		shm_id = kern_shm_adopt(current_task, msg.buf, msg.buf_len);
+		if (shm_id == KERN_SHM_ID_NONE) {
+			kern_physmem_free(msg.buf);
+			msg.buf = 0;
+			msg.buf_len = 0;
+			ret = KERN_ERR_NOMEM;
+		}
+	}
+
+	if (platform_user_ram_copy_to_user((paddr_t) &msg, arg2,
+	    sizeof(msg)) == false) {
+		if (shm_id != KERN_SHM_ID_NONE)
+			(void) kern_shm_destroy(shm_id, current_task);
+		return (KERN_ERR_INVALID_ARGS);
+	}
+
+	return (((syscall_retval_t) shm_id << 32) | ret);
+}
+
+syscall_retval_t
+kern_syscall_msgq_lookup(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+	char name[KERN_MSGQ_NAME_SZ];
+
+	if (kern_syscall_msgq_copyin_name(arg1, arg2, name) == false)
+		return (KERN_MSGQ_ID_NONE);
+	return (kern_msgq_lookup(name));
+}
+
+syscall_retval_t
+kern_syscall_msgq_create(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+	char name[KERN_MSGQ_NAME_SZ];
+
+	if (kern_syscall_msgq_copyin_name(arg1, arg2, name) == false)
+		return (KERN_MSGQ_ID_NONE);
+	return (kern_msgq_create(name, arg3));
+}
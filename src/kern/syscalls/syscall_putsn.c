@@ -27,8 +27,8 @@ kern_syscall_putsn(syscall_arg_t arg1, syscall_arg_t arg2,
 	uint8_t ch;
 	uint32_t i;
 
-	for (i = 0; i < arg3; i++) {
-		if (platform_user_ram_read_byte_from_user(arg2 + i, &ch)
+	for (i = 0; i < arg2; i++) {
+		if (platform_user_ram_read_byte_from_user(arg1 + i, &ch)
 		    == false) {
 			retval = -1;
 			goto done;
@@ -0,0 +1,40 @@
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include <hw/types.h>
+
+#include <kern/libraries/string/string.h>
+#include <kern/libraries/list/list.h>
+#include <kern/libraries/container/container.h>
+
+#include <core/platform.h>
+#include <core/lock.h>
+#include <core/user_ram_access.h>
+
+#include <kern/core/error.h>
+#include <kern/core/exception.h>
+#include <kern/core/signal.h>
+#include <kern/core/task.h>
+#include <kern/core/timer.h>
+#include <kern/console/console.h>
+#include <kern/syscalls/syscall.h>
+#include <kern/ipc/ring.h>
+
+syscall_retval_t
+kern_syscall_ring_setup(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+	return (kern_ring_setup(current_task, arg1, arg2, arg3));
+}
+
+syscall_retval_t
+kern_syscall_ring_enter(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+	kern_error_t ret;
+	uint32_t submitted;
+
+	ret = kern_ring_enter(current_task, arg1, &submitted);
+	return (((syscall_retval_t) submitted << 32) | ret);
+}
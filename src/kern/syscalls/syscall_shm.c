@@ -0,0 +1,65 @@
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include <hw/types.h>
+
+#include <kern/libraries/string/string.h>
+#include <kern/libraries/list/list.h>
+#include <kern/libraries/container/container.h>
+
+#include <core/platform.h>
+#include <core/lock.h>
+#include <core/user_ram_access.h>
+
+#include <kern/core/exception.h>
+#include <kern/core/signal.h>
+#include <kern/core/task.h>
+#include <kern/core/timer.h>
+#include <kern/console/console.h>
+#include <kern/syscalls/syscall.h>
+#include <kern/ipc/shm.h>
+
+syscall_retval_t
+kern_syscall_shm_create(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+
+	return (kern_shm_create(current_task, arg1));
+}
+
+syscall_retval_t
+kern_syscall_shm_grant(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+
+	return (kern_shm_grant(arg1, current_task, arg2, !! arg3));
+}
+
+syscall_retval_t
+kern_syscall_shm_revoke(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+
+	return (kern_shm_revoke(arg1, current_task, arg2));
+}
+
+syscall_retval_t
+kern_syscall_shm_destroy(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+
+	return (kern_shm_destroy(arg1, current_task));
+}
+
+syscall_retval_t
+kern_syscall_shm_addr(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+	paddr_t addr;
+	paddr_size_t size;
+
+	if (kern_shm_lookup(arg1, current_task, &addr, &size) == false)
+		return (0);
+	return (addr);
+}
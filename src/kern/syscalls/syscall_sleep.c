@@ -27,7 +27,8 @@ kern_syscall_sleep(syscall_arg_t arg1, syscall_arg_t arg2,
 	kern_task_signal_set_t sig;
 	bool ret;
 
-	ret = kern_task_timer_set(current_task, (uint32_t) arg2);
+	ret = kern_task_timer_set_slack(current_task, (uint32_t) arg1,
+	    (uint32_t) arg2);
 	if (ret == false) {
 		retval = -1;
 		goto done;
@@ -40,3 +41,11 @@ kern_syscall_sleep(syscall_arg_t arg1, syscall_arg_t arg2,
 done:
 	return (retval);
 }
+
+syscall_retval_t
+kern_syscall_sleep_until(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+
+	return ((uint32_t) kern_task_sleep_until(arg1));
+}
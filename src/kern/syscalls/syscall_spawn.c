@@ -0,0 +1,42 @@
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include <hw/types.h>
+
+#include <core/platform.h>
+#include <core/user_ram_access.h>
+
+#include <kern/core/error.h>
+#include <kern/core/task.h>
+#include <kern/console/console.h>
+#include <kern/ipc/msgq.h>
+#include <kern/syscalls/syscall.h>
+#include <kern/user/user_spawn.h>
+
+syscall_retval_t
+kern_syscall_task_spawn(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+	char label[USER_SPAWN_LABEL_SZ];
+	kern_task_id_t task_id;
+
+	if (arg3 == 0 || arg3 >= USER_SPAWN_LABEL_SZ)
+		return (0);
+	if (platform_user_ram_copy_from_user(arg2, (paddr_t) label, arg3)
+	    == false)
+		return (0);
+	label[arg3] = '\0';
+
+	/*
+	 * Don't find out the exit status queue is bogus only when
+	 * the child exits and the status is quietly dropped.
+	 */
+	if (arg1 != KERN_MSGQ_ID_NONE && kern_msgq_exists(arg1) == false)
+		return (0);
+
+	if (user_spawn(label, arg4, kern_task_current_id(), arg1,
+	    &task_id) != KERN_ERR_OK)
+		return (0);
+	return (task_id);
+}
@@ -0,0 +1,34 @@
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include <hw/types.h>
+
+#include <kern/libraries/list/list.h>
+
+#include <core/platform.h>
+#include <core/user_ram_access.h>
+
+#include <kern/core/error.h>
+#include <kern/core/signal.h>
+#include <kern/core/task.h>
+#include <kern/syscalls/syscall.h>
+#include <kern/ipc/wait.h>
+
+syscall_retval_t
+kern_syscall_wait_any(syscall_arg_t arg1, syscall_arg_t arg2,
+    syscall_arg_t arg3, syscall_arg_t arg4)
+{
+	struct kern_wait_args args;
+	kern_task_signal_set_t sigs;
+	uint32_t ready;
+
+	if (platform_user_ram_copy_from_user(arg1, (paddr_t) &args,
+	    sizeof(args)) == false)
+		return (0);
+
+	if (kern_wait_any(&args, &ready, &sigs) != KERN_ERR_OK)
+		return (0);
+
+	return (((syscall_retval_t) sigs << 32) | ready);
+}
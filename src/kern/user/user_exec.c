@@ -26,6 +26,7 @@
 #include <kern/console/console.h>
 
 #include <kern/libraries/mem/mem.h>
+#include <kern/core/malloc.h>
 #include <kern/libraries/align/align_paddr.h>
 
 #include <kern/user/user_exec.h>
@@ -38,10 +39,55 @@
  * user binary.
  */
 
-static bool
-is_in_range(uint32_t val, uint32_t start, uint32_t len)
+/*
+ * A segment the GOT can point into, for relocation.
+ */
+struct user_exec_reloc_seg {
+	uint32_t start;		/* offset in the image */
+	uint32_t end;		/* start + size */
+	uint32_t delta;		/* added to an image offset to relocate it */
+};
+
+/*
+ * Build the relocation segment table, sorted by image offset.
+ * Empty segments are skipped.  Returns the number of entries.
+ */
+static int
+user_exec_reloc_table(const struct user_exec_program_header *hdr,
+    const struct user_exec_program_addrs *addrs,
+    struct user_exec_reloc_seg *tbl)
 {
-	return ((val >= start) && (val < (start+len)));
+	struct user_exec_reloc_seg seg;
+	int i, j, n = 0;
+
+	const uint32_t offset[USER_EXEC_GOT_SEG_NUM] = {
+		hdr->text_offset, hdr->data_offset,
+		hdr->bss_offset, hdr->rodata_offset,
+	};
+	const uint32_t size[USER_EXEC_GOT_SEG_NUM] = {
+		hdr->text_size, hdr->data_size,
+		hdr->bss_size, hdr->rodata_size,
+	};
+	const paddr_t base[USER_EXEC_GOT_SEG_NUM] = {
+		addrs->text_addr, addrs->data_addr,
+		addrs->bss_addr, addrs->rodata_addr,
+	};
+
+	for (i = 0; i < USER_EXEC_GOT_SEG_NUM; i++) {
+		if (size[i] == 0)
+			continue;
+		seg.start = offset[i];
+		seg.end = offset[i] + size[i];
+		seg.delta = base[i] - offset[i];
+
+		/* Insertion sort; there's only four of them */
+		for (j = n; j > 0 && tbl[j - 1].start > seg.start; j--)
+			tbl[j] = tbl[j - 1];
+		tbl[j] = seg;
+		n++;
+	}
+
+	return (n);
 }
 
 /*
@@ -74,6 +120,9 @@ user_exec_program_parse_header(paddr_t addr, size_t size,
 	kern_memcpy(&val, (const char *) s, sizeof(uint32_t)); hdr->rodata_size = val; s = s + sizeof(uint32_t);
 	kern_memcpy(&val, (const char *) s, sizeof(uint32_t)); hdr->heap_size = val; s = s + sizeof(uint32_t);
 	kern_memcpy(&val, (const char *) s, sizeof(uint32_t)); hdr->stack_size = val; s = s + sizeof(uint32_t);
+	kern_memcpy(&val, (const char *) s, sizeof(uint32_t)); hdr->flags = val; s = s + sizeof(uint32_t);
+	kern_memcpy(&val, (const char *) s, sizeof(uint32_t)); hdr->imports_offset = val; s = s + sizeof(uint32_t);
+	kern_memcpy(&val, (const char *) s, sizeof(uint32_t)); hdr->imports_size = val; s = s + sizeof(uint32_t);
 
 	/* XXX TODO: bounds check the header fields */
 
@@ -85,6 +134,14 @@ user_exec_program_parse_header(paddr_t addr, size_t size,
 	 * memory.
 	 */
 
+	/* The import table is patched per task, so must be in data */
+	if (hdr->imports_size != 0 &&
+	    ((hdr->imports_size % sizeof(struct user_exec_import)) != 0 ||
+	    hdr->imports_offset < hdr->data_offset ||
+	    hdr->imports_offset + hdr->imports_size >
+	    hdr->data_offset + hdr->data_size))
+		return (false);
+
 	/* For now we're fine, let's just do it */
 	return (true);
 }
@@ -149,62 +206,133 @@ user_exec_program_setup_rodata_segment(paddr_t addr, size_t size,
 	return (true);
 }
 
-bool
-user_exec_program_setup_got_segment(paddr_t addr, size_t size,
-    const struct user_exec_program_header *hdr,
-    struct user_exec_program_addrs *addrs)
+/*
+ * Relocate a GOT that make_entry has already classified; each entry
+ * is a segment index and an offset into that segment.
+ */
+static bool
+user_exec_program_setup_got_tagged(const uint32_t *src, uint32_t *dst,
+    uint32_t count, const struct user_exec_program_header *hdr,
+    const struct user_exec_program_addrs *addrs)
 {
-	paddr_t s;
-	uint32_t *got_entry;
+	uint32_t i, val, seg, off;
+
+	const uint32_t size[USER_EXEC_GOT_SEG_NUM] = {
+		hdr->text_size, hdr->data_size,
+		hdr->bss_size, hdr->rodata_size,
+	};
+	const paddr_t base[USER_EXEC_GOT_SEG_NUM] = {
+		addrs->text_addr, addrs->data_addr,
+		addrs->bss_addr, addrs->rodata_addr,
+	};
+
+	for (i = 0; i < count; i++) {
+		val = src[i];
+		seg = (val & USER_EXEC_GOT_SEG_M) >> USER_EXEC_GOT_SEG_S;
+		off = val & USER_EXEC_GOT_OFFSET_M;
+		if (seg >= USER_EXEC_GOT_SEG_NUM || off >= size[seg]) {
+			console_printf("%s: bad GOT entry [%d] (0x%x)\n",
+			    __func__, i, val);
+			return (false);
+		}
+		dst[i] = base[seg] + off;
+	}
+
+	return (true);
+}
+
+/*
+ * Relocate a GOT of plain image offsets.  The segments are kept
+ * sorted by offset and the last matching segment is checked first,
+ * as GOT entries tend to come in runs pointing into the same segment.
+ */
+static bool
+user_exec_program_setup_got_offsets(const uint32_t *src, uint32_t *dst,
+    uint32_t count, const struct user_exec_program_header *hdr,
+    const struct user_exec_program_addrs *addrs)
+{
+	struct user_exec_reloc_seg tbl[USER_EXEC_GOT_SEG_NUM];
+	const struct user_exec_reloc_seg *last, *seg;
 	uint32_t i, val;
+	int n, j;
 
-	/*
-	 * Here's where all the fun relocation magic occurs!
-	 *
-	 * And yes it's inefficient, with memcpy, etc, but
-	 * hey, get it working first.
-	 */
+	n = user_exec_reloc_table(hdr, addrs, tbl);
+	if (n == 0)
+		return (count == 0);
 
-	s = addr + hdr->got_offset;
-	got_entry = (uint32_t *) addrs->got_addr;
-	for (i = 0; i < hdr->got_size; i += sizeof(uint32_t)) {
-		/* XXX parser? I dunno */
-		kern_memcpy(&val, (const char *) s, sizeof(uint32_t));
+	last = &tbl[0];
+	for (i = 0; i < count; i++) {
+		val = src[i];
 
 		/*
-		 * val is now an offset inside our file, starting at 0.
+		 * val is an offset inside our file, starting at 0.
 		 *
-		 * We need to now compare it against the segments we
-		 * know about to see which segment it is in, and relocate
-		 * them to the correct paddr_t addresses.
-		 *
-		 * Eg, if BSS starts at 0xcc, and the first GOT entry
-		 * is at 0xcc, then we need to put it at the beginning
-		 * of the BSS table (offset 0, not offset 0xcc!)
+		 * Eg, if BSS starts at 0xcc, and the GOT entry is 0xcc,
+		 * then it needs to point to the beginning of the BSS
+		 * allocation (offset 0, not offset 0xcc!)
 		 */
-		if (is_in_range(val, hdr->bss_offset, hdr->bss_size)) {
-			*got_entry = addrs->bss_addr + (val - hdr->bss_offset);
-		} else if (is_in_range(val, hdr->text_offset, hdr->text_size)) {
-			*got_entry = addrs->text_addr + (val - hdr->text_offset);
-		} else if (is_in_range(val, hdr->data_offset, hdr->data_size)) {
-			*got_entry = addrs->data_addr + (val - hdr->data_offset);
-		} else if (is_in_range(val, hdr->rodata_offset,
-		    hdr->rodata_size)) {
-			*got_entry = addrs->rodata_addr + (val - hdr->rodata_offset);
-		} else {
-			/* XXX TODO: more debugging obv */
-			console_printf("%s: couldn't find GOT offset (%d) in segments!\n", __func__, val);
-			return (false);
+		if (val - last->start >= last->end - last->start) {
+			seg = NULL;
+			for (j = 0; j < n && tbl[j].start <= val; j++) {
+				if (val < tbl[j].end) {
+					seg = &tbl[j];
+					break;
+				}
+			}
+			if (seg == NULL) {
+				console_printf("%s: couldn't find GOT offset"
+				    " (%d) in segments!\n", __func__, val);
+				return (false);
+			}
+			last = seg;
 		}
+		dst[i] = val + last->delta;
+	}
+
+	return (true);
+}
+
+/*
+ * Populate the GOT.
+ *
+ * This is done for every task spawn, so it's kept quiet and tight;
+ * nothing is logged unless an entry can't be relocated.
+ */
+bool
+user_exec_program_setup_got_segment(paddr_t addr, size_t size,
+    const struct user_exec_program_header *hdr,
+    struct user_exec_program_addrs *addrs)
+{
+	const uint32_t *src;
+	uint32_t *dst, count;
 
-		console_printf("  GOT: [%d]: 0x%x -> 0x%x\n", i, val, *got_entry);
+	/* XXX TODO: should be bounds checked by the header parser */
+	if ((hdr->got_size % sizeof(uint32_t)) != 0 ||
+	    hdr->got_offset + hdr->got_size > size) {
+		console_printf("%s: bad GOT (0x%x, %d bytes)\n", __func__,
+		    hdr->got_offset, hdr->got_size);
+		return (false);
+	}
 
-		/* Next entry */
-		got_entry++;
-		s += sizeof(uint32_t);
+	src = (const uint32_t *) (addr + hdr->got_offset);
+	dst = (uint32_t *) addrs->got_addr;
+	count = hdr->got_size / sizeof(uint32_t);
+
+	/*
+	 * The image is at least word aligned both in flash paks and
+	 * in RAM copies, so the GOT can be read a word at a time.
+	 */
+	if (((paddr_t) src % sizeof(uint32_t)) != 0) {
+		console_printf("%s: GOT at 0x%x isn't word aligned\n",
+		    __func__, (paddr_t) src);
+		return (false);
 	}
 
-	return (true);
+	if (hdr->flags & USER_EXEC_HDR_FLAG_GOT_TAGGED)
+		return (user_exec_program_setup_got_tagged(src, dst, count,
+		    hdr, addrs));
+	return (user_exec_program_setup_got_offsets(src, dst, count,
+	    hdr, addrs));
 }
 
 /*
@@ -232,3 +360,174 @@ user_exec_program_setup_segments(paddr_t addr, size_t size,
 
 	return (true);
 }
+
+/*
+ * Build a GOT template from the first instance of a program.
+ *
+ * The instance's GOT is copied; entries pointing into its data or
+ * bss segment are turned back into segment offsets and recorded in
+ * the patch list, everything else (text, rodata) is position
+ * independent across instances and is left as is.
+ */
+bool
+user_exec_got_template_create(const struct user_exec_program_header *hdr,
+    const struct user_exec_program_addrs *addrs,
+    struct user_exec_got_template *tmpl)
+{
+	const uint32_t *got = (const uint32_t *) addrs->got_addr;
+	uint32_t i, n, val;
+
+	kern_bzero(tmpl, sizeof(*tmpl));
+	tmpl->count = hdr->got_size / sizeof(uint32_t);
+	if (tmpl->count == 0)
+		return (true);
+
+	/* First pass - count the per-instance entries */
+	for (i = 0, n = 0; i < tmpl->count; i++) {
+		val = got[i];
+		if (val - addrs->data_addr < hdr->data_size ||
+		    val - addrs->bss_addr < hdr->bss_size)
+			n++;
+	}
+
+	tmpl->got = kern_malloc_nonzero(tmpl->count * sizeof(uint32_t),
+	    sizeof(uint32_t));
+	if (tmpl->got == NULL)
+		goto error;
+	if (n != 0) {
+		tmpl->patch = kern_malloc_nonzero(n * sizeof(uint32_t),
+		    sizeof(uint32_t));
+		if (tmpl->patch == NULL)
+			goto error;
+	}
+
+	for (i = 0; i < tmpl->count; i++) {
+		val = got[i];
+		if (val - addrs->data_addr < hdr->data_size) {
+			tmpl->got[i] = val - addrs->data_addr;
+			tmpl->patch[tmpl->num_patch++] = i << 1;
+		} else if (val - addrs->bss_addr < hdr->bss_size) {
+			tmpl->got[i] = val - addrs->bss_addr;
+			tmpl->patch[tmpl->num_patch++] = (i << 1) |
+			    USER_EXEC_GOT_PATCH_BSS;
+		} else {
+			tmpl->got[i] = val;
+		}
+	}
+
+	return (true);
+error:
+	user_exec_got_template_free(tmpl);
+	return (false);
+}
+
+void
+user_exec_got_template_free(struct user_exec_got_template *tmpl)
+{
+	if (tmpl->got != NULL)
+		kern_free(tmpl->got);
+	if (tmpl->patch != NULL)
+		kern_free(tmpl->patch);
+	kern_bzero(tmpl, sizeof(*tmpl));
+}
+
+bool
+user_exec_program_clone_segments(paddr_t addr, size_t size,
+    const struct user_exec_program_header *hdr,
+    const struct user_exec_got_template *tmpl,
+    struct user_exec_program_addrs *addrs)
+{
+	uint32_t *got = (uint32_t *) addrs->got_addr;
+	uint32_t i, p;
+
+	if (user_exec_program_setup_data_segment(addr, size, hdr, addrs) == false) {
+		return (false);
+	}
+	if (user_exec_program_setup_bss_segment(addr, size, hdr, addrs) == false) {
+		return (false);
+	}
+
+	kern_memcpy(got, tmpl->got, tmpl->count * sizeof(uint32_t));
+	for (i = 0; i < tmpl->num_patch; i++) {
+		p = tmpl->patch[i];
+		got[p >> 1] += (p & USER_EXEC_GOT_PATCH_BSS) ?
+		    addrs->bss_addr : addrs->data_addr;
+	}
+
+	return (true);
+}
+
+/*
+ * The per-task RAM a shared library needs - its GOT, data and bss,
+ * laid out in that order from user_exec_program_addrs.lib_addr.
+ */
+#define	USER_EXEC_LIB_SEGMENT_ALIGN(len)	(((len) + 7) & ~7)
+
+uint32_t
+user_exec_library_rw_size(const struct user_exec_program_header *hdr)
+{
+	return (USER_EXEC_LIB_SEGMENT_ALIGN(hdr->got_size) +
+	    USER_EXEC_LIB_SEGMENT_ALIGN(hdr->data_size) +
+	    USER_EXEC_LIB_SEGMENT_ALIGN(hdr->bss_size));
+}
+
+/*
+ * Fill in the segment addresses for a library instance - text and
+ * rodata from the shared image at addr, the rest from lib_addr.
+ */
+void
+user_exec_library_setup_addrs(paddr_t addr,
+    const struct user_exec_program_header *hdr, paddr_t lib_addr,
+    struct user_exec_program_addrs *addrs)
+{
+	kern_bzero(addrs, sizeof(*addrs));
+	addrs->text_addr = addr + hdr->text_offset;
+	addrs->rodata_addr = addr + hdr->rodata_offset;
+	addrs->got_addr = lib_addr;
+	addrs->data_addr = addrs->got_addr +
+	    USER_EXEC_LIB_SEGMENT_ALIGN(hdr->got_size);
+	addrs->bss_addr = addrs->data_addr +
+	    USER_EXEC_LIB_SEGMENT_ALIGN(hdr->data_size);
+}
+
+/*
+ * Look up an export of a library loaded at addr.
+ */
+bool
+user_exec_library_export(paddr_t addr, size_t size,
+    const struct user_exec_program_header *hdr, uint32_t index,
+    paddr_t *fn)
+{
+	uint32_t val;
+
+	if ((hdr->flags & USER_EXEC_HDR_FLAG_LIBRARY) == 0)
+		return (false);
+	if (index >= hdr->start_size / sizeof(uint32_t))
+		return (false);
+	if (hdr->start_offset + hdr->start_size > size)
+		return (false);
+
+	kern_memcpy(&val, (const char *) (addr + hdr->start_offset +
+	    (index * sizeof(uint32_t))), sizeof(uint32_t));
+	if ((val & ~1) < hdr->text_offset ||
+	    (val & ~1) >= hdr->text_offset + hdr->text_size)
+		return (false);
+
+	*fn = addr + val;
+	return (true);
+}
+
+/*
+ * Return the import table of a program instance, ie inside its
+ * copy of the data segment at data_addr.
+ */
+struct user_exec_import *
+user_exec_program_imports(const struct user_exec_program_header *hdr,
+    paddr_t data_addr, uint32_t *count)
+{
+	*count = hdr->imports_size / sizeof(struct user_exec_import);
+	if (*count == 0)
+		return (NULL);
+	return ((struct user_exec_import *) (data_addr +
+	    (hdr->imports_offset - hdr->data_offset)));
+}
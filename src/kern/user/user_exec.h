@@ -25,6 +25,7 @@
 
 #include <hw/types.h>
 
+#include <kern/user/user_exec_reloc.h>
 
 /*
  * As implemented in USER_TASK.ld, there are a handful of fields in
@@ -45,6 +46,9 @@
  * + rodata size
  * + heap size
  * + stack size
+ * + flags (USER_EXEC_HDR_FLAG_*)
+ * + imports offset (inside the data segment)
+ * + imports size
  */
 
 struct user_exec_program_header {
@@ -63,6 +67,26 @@ struct user_exec_program_header {
 
 	uint32_t heap_size;
 	uint32_t stack_size;
+	uint32_t flags;
+	uint32_t imports_offset;
+	uint32_t imports_size;
+};
+
+/*
+ * A shared library import, in the program's data segment.
+ *
+ * The program fills in the library label and export index; the
+ * loader fills in the function address and the library GOT for
+ * this task.  Calls go via a veneer which loads r9 with the
+ * library GOT, calls the function and restores r9.
+ */
+#define	USER_EXEC_IMPORT_LIB_SZ		16
+
+struct user_exec_import {
+	char lib[USER_EXEC_IMPORT_LIB_SZ];
+	uint32_t index;
+	uint32_t fn;
+	uint32_t got;
 };
 
 /* Note: is paddr_t the correct address type to use here? */
@@ -76,8 +100,26 @@ struct user_exec_program_addrs {
 
 	paddr_t heap_addr;
 	paddr_t stack_addr;
+
+	/* Per-task shared library GOT/data/bss, if any */
+	paddr_t lib_addr;
 };
 
+/*
+ * A relocated GOT that further instances of the same program can be
+ * cloned from.  Entries pointing at text and rodata are shared and
+ * already relocated; entries pointing at the per-instance data and
+ * bss segments are stored as offsets and listed in patch[], as
+ * (entry index << 1) | USER_EXEC_GOT_PATCH_BSS.
+ */
+#define	USER_EXEC_GOT_PATCH_BSS		0x1
+
+struct user_exec_got_template {
+	uint32_t *got;
+	uint32_t count;
+	uint32_t *patch;
+	uint32_t num_patch;
+};
 
 /*
  * Parse out the header.
@@ -93,4 +135,39 @@ extern	bool user_exec_program_setup_segments(paddr_t addr, size_t size,
     const struct user_exec_program_header *hdr,
     struct user_exec_program_addrs *addrs);
 
+/*
+ * Build a GOT template from an instance whose segments have been
+ * set up by user_exec_program_setup_segments().
+ */
+extern	bool user_exec_got_template_create(
+	    const struct user_exec_program_header *hdr,
+	    const struct user_exec_program_addrs *addrs,
+	    struct user_exec_got_template *tmpl);
+extern	void user_exec_got_template_free(struct user_exec_got_template *tmpl);
+
+/*
+ * Setup the segments for another instance of an already relocated
+ * program; the GOT is copied from the template and only the data
+ * and bss entries are patched.
+ */
+extern	bool user_exec_program_clone_segments(paddr_t addr, size_t size,
+	    const struct user_exec_program_header *hdr,
+	    const struct user_exec_got_template *tmpl,
+	    struct user_exec_program_addrs *addrs);
+
+/*
+ * Shared library support.
+ */
+extern	uint32_t user_exec_library_rw_size(
+	    const struct user_exec_program_header *hdr);
+extern	void user_exec_library_setup_addrs(paddr_t addr,
+	    const struct user_exec_program_header *hdr, paddr_t lib_addr,
+	    struct user_exec_program_addrs *addrs);
+extern	bool user_exec_library_export(paddr_t addr, size_t size,
+	    const struct user_exec_program_header *hdr, uint32_t index,
+	    paddr_t *fn);
+extern	struct user_exec_import * user_exec_program_imports(
+	    const struct user_exec_program_header *hdr, paddr_t data_addr,
+	    uint32_t *count);
+
 #endif	/* __USER_USER_EXEC_H__ */
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef	__USER_USER_EXEC_RELOC_H__
+#define	__USER_USER_EXEC_RELOC_H__
+
+/*
+ * The on-flash user program header layout and GOT relocation
+ * encoding.  This is shared with tools/flash_resource/make_entry
+ * so it can pre-classify GOT entries, so it's just defines.
+ *
+ * The header is a list of little endian uint32_t's; these are
+ * the word indexes of each field.
+ */
+#define	USER_EXEC_HDR_TEXT_OFFSET		0
+#define	USER_EXEC_HDR_TEXT_SIZE			1
+#define	USER_EXEC_HDR_START_OFFSET		2
+#define	USER_EXEC_HDR_START_SIZE		3
+#define	USER_EXEC_HDR_GOT_OFFSET		4
+#define	USER_EXEC_HDR_GOT_SIZE			5
+#define	USER_EXEC_HDR_BSS_OFFSET		6
+#define	USER_EXEC_HDR_BSS_SIZE			7
+#define	USER_EXEC_HDR_DATA_OFFSET		8
+#define	USER_EXEC_HDR_DATA_SIZE			9
+#define	USER_EXEC_HDR_RODATA_OFFSET		10
+#define	USER_EXEC_HDR_RODATA_SIZE		11
+#define	USER_EXEC_HDR_HEAP_SIZE			12
+#define	USER_EXEC_HDR_STACK_SIZE		13
+#define	USER_EXEC_HDR_FLAGS			14
+#define	USER_EXEC_HDR_IMPORTS_OFFSET		15
+#define	USER_EXEC_HDR_IMPORTS_SIZE		16
+#define	USER_EXEC_HDR_NUM_WORDS			17
+
+/*
+ * The GOT entries have been rewritten from image offsets into
+ * (segment, offset in segment) pairs, so the loader doesn't have
+ * to figure out which segment each one is in.
+ */
+#define	USER_EXEC_HDR_FLAG_GOT_TAGGED		0x00000001
+
+/*
+ * This is a shared library rather than a program.  The start
+ * offset/size fields describe its export table - a list of
+ * function addresses (image offsets, with the thumb bit set)
+ * that programs import by index.
+ */
+#define	USER_EXEC_HDR_FLAG_LIBRARY		0x00000002
+
+/*
+ * A tagged GOT entry - the top four bits are the segment, the
+ * rest is the offset inside that segment.
+ */
+#define	USER_EXEC_GOT_SEG_M			0xf0000000
+#define	USER_EXEC_GOT_SEG_S			28
+#define	USER_EXEC_GOT_OFFSET_M			0x0fffffff
+
+#define	USER_EXEC_GOT_SEG_TEXT			0
+#define	USER_EXEC_GOT_SEG_DATA			1
+#define	USER_EXEC_GOT_SEG_BSS			2
+#define	USER_EXEC_GOT_SEG_RODATA		3
+#define	USER_EXEC_GOT_SEG_NUM			4
+
+#endif	/* __USER_USER_EXEC_RELOC_H__ */
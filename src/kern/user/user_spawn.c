@@ -0,0 +1,498 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <hw/types.h>
+
+#include <core/platform.h>
+
+#include <kern/libraries/mem/mem.h>
+#include <kern/libraries/string/string.h>
+
+#include <kern/console/console.h>
+#include <kern/core/error.h>
+#include <kern/core/task.h>
+#include <kern/core/task_mem.h>
+#include <kern/core/task_mem_alloc.h>
+#include <kern/core/physmem.h>
+#include <kern/core/malloc.h>
+#include <kern/core/mutex.h>
+#include <kern/core/logging.h>
+
+#include <kern/flash/flash_resource.h>
+#include <kern/flash/flash_resource_header.h>
+#include <kern/flash/flash_resource_pak.h>
+
+#include <kern/user/user_exec.h>
+#include <kern/user/user_spawn.h>
+
+LOGGING_DEFINE(LOG_USER_SPAWN, "spawn", KERN_LOG_LEVEL_INFO);
+
+/*
+ * A loaded program.
+ *
+ * User code is PIC with the GOT base in r9, so every instance of a
+ * program can share the text and rodata (in flash, or in one RAM
+ * copy) and only needs its own GOT, data, bss, heap and stack.
+ * Programs are cached after their first spawn along with a GOT
+ * template, so later instances skip the lookup, the image load,
+ * header parsing and the relocation pass.
+ *
+ * XXX TODO: cached programs (and their RAM copies) are never evicted.
+ */
+struct user_spawn_prog {
+	bool in_use;
+	char label[USER_SPAWN_LABEL_SZ];
+
+	struct user_exec_program_header hdr;
+	paddr_t image;
+	size_t image_size;
+
+	/* RAM copy of the image, if not XIP */
+	paddr_t ram;
+	uint32_t ram_size;
+
+	/* MPU text region for an XIP image, if the pak has one */
+	bool have_text;
+	paddr_t text_start;
+	paddr_size_t text_size;
+
+	bool have_got;
+	struct user_exec_got_template got;
+
+	/* Shared library this program imports from, if any */
+	struct user_spawn_prog *lib;
+
+	uint32_t instances;
+};
+
+static flash_resource_span_t *user_spawn_span = NULL;
+static struct user_spawn_prog user_spawn_cache[USER_SPAWN_CACHE_SIZE];
+static struct kern_mutex user_spawn_mtx;
+
+void
+user_spawn_init(flash_resource_span_t *span)
+{
+	user_spawn_span = span;
+	kern_mutex_init(&user_spawn_mtx, "spawn");
+	kern_bzero(user_spawn_cache, sizeof(user_spawn_cache));
+}
+
+static struct user_spawn_prog *
+user_spawn_cache_lookup_locked(const char *label)
+{
+	int i;
+
+	for (i = 0; i < USER_SPAWN_CACHE_SIZE; i++) {
+		if (user_spawn_cache[i].in_use &&
+		    kern_strncmp(user_spawn_cache[i].label, label,
+		    USER_SPAWN_LABEL_SZ) == 0)
+			return (&user_spawn_cache[i]);
+	}
+	return (NULL);
+}
+
+static struct user_spawn_prog *
+user_spawn_cache_alloc_locked(void)
+{
+	int i;
+
+	for (i = 0; i < USER_SPAWN_CACHE_SIZE; i++) {
+		if (user_spawn_cache[i].in_use == false)
+			return (&user_spawn_cache[i]);
+	}
+	return (NULL);
+}
+
+/*
+ * Programs flagged to run from RAM (and compressed ones, which
+ * can't be XIP) get the whole image copied into an MPU aligned
+ * RAM allocation.  Flash on the F429 has wait states, so this
+ * trades RAM for faster text/rodata access.
+ */
+static kern_error_t
+user_spawn_image_load(const struct flash_resource_pak *pak,
+    struct user_spawn_prog *prog)
+{
+	uint32_t ram_align;
+
+	if ((pak->hdr.flags & FLASH_RESOURCE_FLAG_RUN_FROM_RAM) == 0 &&
+	    flash_resource_pak_compression(pak) == FLASH_RESOURCE_COMP_NONE) {
+		prog->image = pak->payload_start;
+		prog->image_size = pak->payload_size;
+		prog->have_text = flash_resource_pak_mpu_region(pak,
+		    &prog->text_start, &prog->text_size) &&
+		    platform_mpu_table_entry_validate(prog->text_start,
+		    prog->text_size, PLATFORM_PROT_TYPE_EXEC_RO);
+		return (KERN_ERR_OK);
+	}
+
+	prog->image_size = flash_resource_pak_raw_size(pak);
+	platform_mpu_region_size_calc(prog->image_size, &prog->ram_size,
+	    &ram_align);
+	prog->ram = kern_physmem_alloc(prog->ram_size, ram_align,
+	    KERN_PHYSMEM_ALLOC_FLAG_ZERO);
+	if (prog->ram == 0) {
+		KERN_LOG(LOG_USER_SPAWN, KERN_LOG_LEVEL_CRIT,
+		    "failed to allocate %d bytes for the program image",
+		    prog->ram_size);
+		return (KERN_ERR_NOMEM);
+	}
+	if (flash_resource_pak_read(pak, (void *) prog->ram,
+	    prog->ram_size) == false) {
+		KERN_LOG(LOG_USER_SPAWN, KERN_LOG_LEVEL_CRIT,
+		    "failed to load the program image");
+		kern_physmem_free(prog->ram);
+		prog->ram = 0;
+		return (KERN_ERR_INVALID_ARGS);
+	}
+	prog->image = prog->ram;
+	prog->have_text = true;
+	prog->text_start = prog->ram;
+	prog->text_size = prog->ram_size;
+
+	return (KERN_ERR_OK);
+}
+
+static void
+user_spawn_header_log(const char *label,
+    const struct user_exec_program_header *hdr)
+{
+	KERN_LOG(LOG_USER_SPAWN, KERN_LOG_LEVEL_DEBUG,
+	    "%s: text 0x%x/%d, start 0x%x, got 0x%x/%d, bss 0x%x/%d",
+	    label, hdr->text_offset, hdr->text_size, hdr->start_offset,
+	    hdr->got_offset, hdr->got_size, hdr->bss_offset, hdr->bss_size);
+	KERN_LOG(LOG_USER_SPAWN, KERN_LOG_LEVEL_DEBUG,
+	    "%s: data 0x%x/%d, rodata 0x%x/%d, heap %d, stack %d",
+	    label, hdr->data_offset, hdr->data_size, hdr->rodata_offset,
+	    hdr->rodata_size, hdr->heap_size, hdr->stack_size);
+}
+
+/*
+ * Load a program - look up the pak, load the image if it isn't
+ * XIP and parse the program header.
+ */
+static kern_error_t
+user_spawn_prog_load(const char *label, struct user_spawn_prog *prog)
+{
+	struct flash_resource_pak pak;
+	kern_error_t ret;
+
+	kern_bzero(prog, sizeof(*prog));
+
+	if (flash_resource_lookup(user_spawn_span, &pak, label) == false)
+		return (KERN_ERR_NOTFOUND);
+
+	ret = user_spawn_image_load(&pak, prog);
+	if (ret != KERN_ERR_OK)
+		return (ret);
+
+	if (user_exec_program_parse_header(prog->image, prog->image_size,
+	    &prog->hdr) == false) {
+		KERN_LOG(LOG_USER_SPAWN, KERN_LOG_LEVEL_CRIT,
+		    "%s: failed to parse program header", label);
+		if (prog->ram != 0)
+			kern_physmem_free(prog->ram);
+		return (KERN_ERR_INVALID_ARGS);
+	}
+	user_spawn_header_log(label, &prog->hdr);
+
+	kern_strlcpy(prog->label, label, USER_SPAWN_LABEL_SZ);
+	return (KERN_ERR_OK);
+}
+
+/*
+ * Find (loading it if needed) the shared library a program imports
+ * from.  Libraries are always cached as they're shared by every task
+ * using them.
+ *
+ * XXX TODO: only one library per program for now, as each library's
+ * text needs its own MPU slot.
+ */
+static kern_error_t
+user_spawn_lib_resolve_locked(struct user_spawn_prog *prog)
+{
+	const struct user_exec_import *imp;
+	char label[USER_EXEC_IMPORT_LIB_SZ + 1];
+	struct user_spawn_prog *lib;
+	uint32_t i, count;
+	kern_error_t ret;
+
+	imp = user_exec_program_imports(&prog->hdr,
+	    prog->image + prog->hdr.data_offset, &count);
+	if (imp == NULL)
+		return (KERN_ERR_OK);
+
+	kern_strlcpyn(label, imp[0].lib, sizeof(label),
+	    USER_EXEC_IMPORT_LIB_SZ);
+	for (i = 1; i < count; i++) {
+		if (kern_strncmp(imp[i].lib, imp[0].lib,
+		    USER_EXEC_IMPORT_LIB_SZ) != 0) {
+			KERN_LOG(LOG_USER_SPAWN, KERN_LOG_LEVEL_CRIT,
+			    "%s: imports from more than one library",
+			    prog->label);
+			return (KERN_ERR_NOSPC);
+		}
+	}
+
+	lib = user_spawn_cache_lookup_locked(label);
+	if (lib == NULL) {
+		lib = user_spawn_cache_alloc_locked();
+		if (lib == NULL)
+			return (KERN_ERR_NOSPC);
+		ret = user_spawn_prog_load(label, lib);
+		if (ret != KERN_ERR_OK)
+			return (ret);
+		lib->in_use = true;
+	}
+
+	if ((lib->hdr.flags & USER_EXEC_HDR_FLAG_LIBRARY) == 0 ||
+	    lib->have_text == false) {
+		KERN_LOG(LOG_USER_SPAWN, KERN_LOG_LEVEL_CRIT,
+		    "%s: %s isn't a library in an MPU aligned pak",
+		    prog->label, label);
+		return (KERN_ERR_INVALID_ARGS);
+	}
+
+	prog->lib = lib;
+	return (KERN_ERR_OK);
+}
+
+/*
+ * Set up this task's instance of the program's shared library in
+ * the arena and point the program's imports at it.
+ */
+static bool
+user_spawn_lib_instance(struct user_spawn_prog *prog,
+    const struct user_exec_program_addrs *addrs, struct task_mem *tm)
+{
+	struct user_spawn_prog *lib = prog->lib;
+	struct user_exec_program_addrs lib_addrs;
+	struct user_exec_import *imp;
+	uint32_t i, count;
+	paddr_t fn;
+	bool ok;
+
+	user_exec_library_setup_addrs(lib->image, &lib->hdr, addrs->lib_addr,
+	    &lib_addrs);
+	if (lib->have_got) {
+		ok = user_exec_program_clone_segments(lib->image,
+		    lib->image_size, &lib->hdr, &lib->got, &lib_addrs);
+	} else {
+		ok = user_exec_program_setup_segments(lib->image,
+		    lib->image_size, &lib->hdr, &lib_addrs);
+		if (ok) {
+			lib->have_got = user_exec_got_template_create(
+			    &lib->hdr, &lib_addrs, &lib->got);
+		}
+	}
+	if (ok == false)
+		return (false);
+
+	imp = user_exec_program_imports(&prog->hdr, addrs->data_addr, &count);
+	for (i = 0; i < count; i++) {
+		if (user_exec_library_export(lib->image, lib->image_size,
+		    &lib->hdr, imp[i].index, &fn) == false) {
+			KERN_LOG(LOG_USER_SPAWN, KERN_LOG_LEVEL_CRIT,
+			    "%s: %s has no export %d", prog->label,
+			    lib->label, imp[i].index);
+			return (false);
+		}
+		imp[i].fn = fn;
+		imp[i].got = lib_addrs.got_addr;
+	}
+
+	kern_task_mem_set(tm, TASK_MEM_ID_LIB_TEXT, lib->text_start,
+	    lib->text_size, false);
+	lib->instances++;
+	return (true);
+}
+
+/*
+ * Create and start an instance of a loaded program.
+ *
+ * If the program isn't cached then the task takes ownership of its
+ * RAM copy once nothing else can fail, and prog->ram is cleared;
+ * until then (and on failure) it's still the caller's to free.
+ * Cached programs' RAM copies always belong to the cache.
+ */
+static kern_error_t
+user_spawn_instance(struct user_spawn_prog *prog, bool cached, uint32_t arg,
+    kern_task_id_t parent_id, uint32_t notify_qid, kern_task_id_t *task_id)
+{
+	struct user_exec_program_addrs addrs = { 0 };
+	struct task_mem tm;
+	struct kern_task *task;
+	bool ok;
+
+	/*
+	 * The GOT, stack, data, bss and heap are all allocated as one
+	 * arena by platform_user_task_mem_allocate() so they only take
+	 * up two of the eight MPU slots.
+	 */
+	kern_task_mem_init(&tm);
+	if (platform_user_task_mem_allocate(&prog->hdr, &addrs, &tm,
+	    (prog->lib != NULL) ? user_exec_library_rw_size(&prog->lib->hdr) : 0,
+	    false) == false) {
+		KERN_LOG(LOG_USER_SPAWN, KERN_LOG_LEVEL_CRIT,
+		    "%s: failed to allocate task mem", prog->label);
+		kern_task_mem_cleanup(&tm);
+		return (KERN_ERR_NOMEM);
+	}
+
+	/*
+	 * Text and rodata aren't copied; they're either XIP in flash
+	 * or already in the RAM copy of the image.  These are done after
+	 * platform_user_task_mem_allocate() as it clears addrs.
+	 */
+	addrs.text_addr = prog->image + prog->hdr.text_offset;
+	addrs.start_addr = prog->image + prog->hdr.start_offset;
+	addrs.rodata_addr = prog->image + prog->hdr.rodata_offset;
+
+	/*
+	 * If make_entry laid the pak out for the MPU then the text
+	 * region only needs to cover this payload rather than all of
+	 * flash.
+	 */
+	if (prog->have_text) {
+		kern_task_mem_set(&tm, TASK_MEM_ID_TEXT, prog->text_start,
+		    prog->text_size, false);
+	}
+
+	/* Relocate the GOT (or clone it), copy data, zero bss */
+	if (prog->have_got) {
+		ok = user_exec_program_clone_segments(prog->image,
+		    prog->image_size, &prog->hdr, &prog->got, &addrs);
+	} else {
+		ok = user_exec_program_setup_segments(prog->image,
+		    prog->image_size, &prog->hdr, &addrs);
+		if (ok && cached) {
+			prog->have_got = user_exec_got_template_create(
+			    &prog->hdr, &addrs, &prog->got);
+		}
+	}
+	if (ok && prog->lib != NULL)
+		ok = user_spawn_lib_instance(prog, &addrs, &tm);
+	if (ok == false) {
+		KERN_LOG(LOG_USER_SPAWN, KERN_LOG_LEVEL_CRIT,
+		    "%s: failed to setup segments", prog->label);
+		kern_task_mem_cleanup(&tm);
+		return (KERN_ERR_INVALID_ARGS);
+	}
+
+	task = kern_malloc(sizeof(struct kern_task), 4);
+	if (task == NULL) {
+		kern_task_mem_cleanup(&tm);
+		return (KERN_ERR_NOMEM);
+	}
+
+	/*
+	 * Nothing below can fail, so hand an uncached RAM copy to tm
+	 * now; doing it earlier would have tm's cleanup and our caller
+	 * both free it on an error.
+	 */
+	if (prog->ram != 0 && cached == false) {
+		kern_task_mem_set(&tm, TASK_MEM_ID_TEXT, prog->text_start,
+		    prog->text_size, true);
+		prog->ram = 0;
+	}
+
+	/* The task owns tm from here on */
+	kern_task_user_init(task, addrs.start_addr, arg, addrs.got_addr,
+	    prog->label, &tm,
+	    TASK_FLAGS_DYNAMIC_STRUCT | TASK_FLAGS_ENABLE_MPU);
+	kern_task_set_parent(task, parent_id, notify_qid);
+	kern_task_start(task);
+
+	prog->instances++;
+	*task_id = kern_task_to_id(task);
+	return (KERN_ERR_OK);
+}
+
+kern_error_t
+user_spawn(const char *label, uint32_t arg, kern_task_id_t parent_id,
+    uint32_t notify_qid, kern_task_id_t *task_id)
+{
+	struct user_spawn_prog uncached, *prog;
+	const char *how;
+	uint32_t spawn_start;
+	kern_error_t ret;
+	bool cached = true;
+
+	if (user_spawn_span == NULL)
+		return (KERN_ERR_NOTFOUND);
+	if (kern_strnlen(label, USER_SPAWN_LABEL_SZ) >= USER_SPAWN_LABEL_SZ)
+		return (KERN_ERR_INVALID_ARGS);
+
+	spawn_start = platform_cpu_cycle_count();
+
+	kern_mutex_lock(&user_spawn_mtx);
+	prog = user_spawn_cache_lookup_locked(label);
+	if (prog == NULL) {
+		prog = user_spawn_cache_alloc_locked();
+		if (prog == NULL) {
+			/* Cache is full; load it just for this instance */
+			prog = &uncached;
+			cached = false;
+		}
+		ret = user_spawn_prog_load(label, prog);
+		if (ret != KERN_ERR_OK)
+			goto done;
+		prog->in_use = cached;
+		ret = user_spawn_lib_resolve_locked(prog);
+		if (ret != KERN_ERR_OK) {
+			prog->in_use = false;
+			if (prog->ram != 0)
+				kern_physmem_free(prog->ram);
+			goto done;
+		}
+	}
+
+	/* Libraries are only ever loaded for programs to import from */
+	if (prog->hdr.flags & USER_EXEC_HDR_FLAG_LIBRARY) {
+		ret = KERN_ERR_INVALID_ARGS;
+		if (cached == false && prog->ram != 0)
+			kern_physmem_free(prog->ram);
+		goto done;
+	}
+
+	how = prog->have_got ? "cloned" :
+	    (prog->hdr.flags & USER_EXEC_HDR_FLAG_GOT_TAGGED) ? "tagged" :
+	    "offsets";
+	ret = user_spawn_instance(prog, cached, arg, parent_id, notify_qid,
+	    task_id);
+	if (ret != KERN_ERR_OK) {
+		if (cached == false && prog->ram != 0)
+			kern_physmem_free(prog->ram);
+		goto done;
+	}
+
+	KERN_LOG(LOG_USER_SPAWN, KERN_LOG_LEVEL_INFO,
+	    "%s: task 0x%x, instance %d, %d GOT entries (%s), spawn %d cycles",
+	    label, *task_id, prog->instances,
+	    prog->hdr.got_size / sizeof(uint32_t), how,
+	    platform_cpu_cycle_count() - spawn_start);
+
+done:
+	kern_mutex_unlock(&user_spawn_mtx);
+	return (ret);
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef	__USER_USER_SPAWN_H__
+#define	__USER_USER_SPAWN_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <hw/types.h>
+
+#include <kern/core/error.h>
+#include <kern/core/task_defs.h>
+#include <kern/flash/flash_resource.h>
+
+/* Longest pak label that can be spawned from userland */
+#define	USER_SPAWN_LABEL_SZ		32
+
+/* Number of programs kept loaded for spawning further instances */
+#define	USER_SPAWN_CACHE_SIZE		4
+
+/**
+ * Set the flash resource span user programs are spawned from.
+ */
+extern	void user_spawn_init(flash_resource_span_t *span);
+
+/**
+ * Spawn a user task from the program pak with the given label.
+ *
+ * This does the whole dance - lookup, copying the image to RAM if
+ * needed, parsing the program header, allocating task memory,
+ * relocating and starting the task.  The loaded program is cached,
+ * so further instances share its text/rodata and have their GOT
+ * cloned from the first instance's rather than relocated.
+ *
+ * @param label pak label
+ * @param arg argument passed to the program entry point in r0
+ * @param parent_id task to signal when it exits, or 0 for none
+ * @param notify_qid message queue to post the exit status to,
+ *   or KERN_MSGQ_ID_NONE
+ * @param task_id set to the new task id on success
+ * @retval KERN_ERR_OK if the task was started
+ * @retval KERN_ERR_NOTFOUND if there's no pak with that label
+ * @retval KERN_ERR_NOMEM if memory couldn't be allocated
+ * @retval KERN_ERR_INVALID_ARGS if the program couldn't be set up
+ */
+extern	kern_error_t user_spawn(const char *label, uint32_t arg,
+	    kern_task_id_t parent_id, uint32_t notify_qid,
+	    kern_task_id_t *task_id);
+
+#endif	/* __USER_USER_SPAWN_H__ */
@@ -0,0 +1,224 @@
+/*
+ * Host side check for the kernel CRC-32 (kern/libraries/crc32.)
+ *
+ * This checks kern_crc32b_sw() / kern_crc32b_update(), ie the
+ * slicing-by-4 tables, against a plain bit at a time CRC-32 over a
+ * range of lengths, alignments and incremental splits, plus the
+ * standard check value.  The boot time self-test only compares the
+ * hardware unit against the table code, so this is what checks the
+ * tables themselves.
+ *
+ * Given a pak file written by make_entry (-f) it also recomputes the
+ * CRC of each payload bit at a time and checks it against the
+ * checksum make_entry stored in the header.
+ *
+ * Usage: crc_check [-n buffer size] [-s seed] [-f pak file]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <err.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../../kern/flash/flash_resource_header.h"
+#include "../../kern/libraries/crc32/crc32b.h"
+
+/*
+ * The reference: reflected CRC-32, polynomial 0xedb88320, one bit
+ * at a time.
+ */
+static uint32_t
+crc32_bitwise(const unsigned char *p, size_t n)
+{
+	uint32_t crc = 0xffffffff;
+	int i;
+
+	while (n-- > 0) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+	return (~crc);
+}
+
+static int
+check_known(void)
+{
+	const char *s = "123456789";
+	uint32_t crc;
+
+	crc = kern_crc32b_sw(s, strlen(s));
+	if (crc != 0xcbf43926 ||
+	    crc32_bitwise((const unsigned char *) s, strlen(s)) != crc) {
+		printf("check value: got 0x%08x, expected 0xcbf43926\n", crc);
+		return (1);
+	}
+	return (0);
+}
+
+/*
+ * Every length up to len at every alignment within a word, both in
+ * one go and split in two through kern_crc32b_update().
+ */
+static int
+check_buffer(const unsigned char *buf, size_t len)
+{
+	uint32_t ref, crc;
+	size_t l, split;
+	int a, fails = 0;
+
+	for (a = 0; a < 4; a++) {
+		for (l = 0; l + a <= len; l++) {
+			ref = crc32_bitwise(buf + a, l);
+			crc = kern_crc32b_sw((const char *) buf + a, l);
+			if (crc != ref) {
+				printf("align %d len %zu: got 0x%08x,"
+				    " expected 0x%08x\n", a, l, crc, ref);
+				fails++;
+				continue;
+			}
+
+			split = l / 3;
+			crc = kern_crc32b_update(0xffffffff,
+			    (const char *) buf + a, split);
+			crc = ~kern_crc32b_update(crc,
+			    (const char *) buf + a + split, l - split);
+			if (crc != ref) {
+				printf("align %d len %zu split %zu: got 0x%08x,"
+				    " expected 0x%08x\n", a, l, split, crc,
+				    ref);
+				fails++;
+			}
+		}
+	}
+	return (fails);
+}
+
+static uint32_t
+le32(const unsigned char *p)
+{
+
+	return ((uint32_t) p[0] | ((uint32_t) p[1] << 8) |
+	    ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24));
+}
+
+/*
+ * Walk the paks in a make_entry output file, checking the stored
+ * payload CRCs.
+ */
+static int
+check_pak_file(const char *path)
+{
+	unsigned char *buf;
+	uint32_t length, alignment, namelen, plen, flags, stored, crc;
+	size_t size, off, poff;
+	FILE *fp;
+	int paks = 0, fails = 0;
+
+	fp = fopen(path, "rb");
+	if (fp == NULL)
+		err(1, "%s", path);
+	if (fseek(fp, 0, SEEK_END) != 0)
+		err(1, "fseek");
+	size = ftell(fp);
+	rewind(fp);
+	buf = malloc(size);
+	if (buf == NULL)
+		err(1, "malloc");
+	if (fread(buf, 1, size, fp) != size)
+		err(1, "%s: read", path);
+	fclose(fp);
+
+	for (off = 0; off + HEADER_SIZE <= size; off += length) {
+		if (le32(buf + off) != ENTRY_MAGIC)
+			break;
+		stored = le32(buf + off + 4);
+		length = le32(buf + off + 12);
+		alignment = le32(buf + off + 16);
+		namelen = le32(buf + off + 20);
+		plen = le32(buf + off + 24);
+		flags = le32(buf + off + 28);
+		if (length == 0 || alignment == 0)
+			errx(1, "pak@%zu: bad header", off);
+
+		/* Payloads are aligned in flash; the file starts at -b */
+		poff = off + HEADER_SIZE + namelen;
+		poff = (poff + alignment - 1) / alignment * alignment;
+		if (poff + plen > size)
+			errx(1, "pak@%zu: payload runs off the end", off);
+		paks++;
+
+		if ((flags & FLASH_RESOURCE_FLAG_CRC32) == 0) {
+			printf("pak@%zu: no CRC\n", off);
+			fails++;
+			continue;
+		}
+		crc = crc32_bitwise(buf + poff, plen);
+		if (crc != stored) {
+			printf("pak@%zu: stored CRC 0x%08x, expected 0x%08x\n",
+			    off, stored, crc);
+			fails++;
+		}
+	}
+
+	if (paks == 0) {
+		printf("%s: no paks\n", path);
+		fails++;
+	}
+	printf("%s: %d paks checked\n", path, paks);
+	free(buf);
+	return (fails);
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *pak_file = NULL;
+	unsigned char *buf;
+	size_t len = 300;
+	unsigned int seed = 1;
+	size_t i;
+	int ch, fails = 0;
+
+	while ((ch = getopt(argc, argv, "n:s:f:")) != -1) {
+		switch (ch) {
+		case 'n':
+			len = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'f':
+			pak_file = optarg;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n buffer size] [-s seed]"
+			    " [-f pak file]\n", argv[0]);
+			exit(127);
+		}
+	}
+
+	buf = malloc(len + 4);
+	if (buf == NULL)
+		err(1, "malloc");
+
+	fails += check_known();
+
+	/* Random data, then all ones to exercise every table entry's top */
+	srandom(seed);
+	for (i = 0; i < len + 4; i++)
+		buf[i] = random() & 0xff;
+	fails += check_buffer(buf, len);
+	memset(buf, 0xff, len + 4);
+	fails += check_buffer(buf, len);
+
+	if (pak_file != NULL)
+		fails += check_pak_file(pak_file);
+
+	free(buf);
+	printf("crc_check: %s (%d failures)\n", fails ? "FAIL" : "ok", fails);
+	return (fails ? 1 : 0);
+}
@@ -0,0 +1,150 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "lz4_compress.h"
+
+/*
+ * A small greedy LZ4 block compressor.
+ *
+ * This isn't trying to be the reference compressor; it hashes
+ * every 4 byte sequence into a table of the last position it was
+ * seen, takes the first match it finds and extends it as far as it
+ * goes.  The output is a plain LZ4 block that the kernel side
+ * (kern/libraries/lz4) can decode.
+ *
+ * Block format rules it has to follow: the last 5 bytes are always
+ * literals, and the last match has to start at least 12 bytes before
+ * the end of the input.
+ */
+
+#define	LZ4_HASH_LOG		12
+#define	LZ4_MIN_MATCH		4
+#define	LZ4_LAST_LITERALS	5
+#define	LZ4_MF_LIMIT		12
+#define	LZ4_MAX_OFFSET		65535
+
+static uint32_t
+lz4_read32(const uint8_t *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return (v);
+}
+
+static uint32_t
+lz4_hash(uint32_t v)
+{
+	return ((v * 2654435761U) >> (32 - LZ4_HASH_LOG));
+}
+
+/*
+ * Write a length extension for a nibble that was 15.
+ */
+static int
+lz4_write_len(uint8_t **op, const uint8_t *oend, size_t len)
+{
+	while (len >= 255) {
+		if (*op >= oend)
+			return (-1);
+		*(*op)++ = 255;
+		len -= 255;
+	}
+	if (*op >= oend)
+		return (-1);
+	*(*op)++ = len;
+	return (0);
+}
+
+/*
+ * Emit a sequence: literals, then optionally a match.
+ */
+static int
+lz4_emit(uint8_t **op, const uint8_t *oend, const uint8_t *lit,
+    size_t lit_len, size_t offset, size_t match_len)
+{
+	uint8_t *token;
+	size_t ml;
+
+	if (*op >= oend)
+		return (-1);
+	token = (*op)++;
+	*token = (lit_len >= 15 ? 15 : lit_len) << 4;
+	if (lit_len >= 15 && lz4_write_len(op, oend, lit_len - 15) < 0)
+		return (-1);
+
+	if ((size_t) (oend - *op) < lit_len)
+		return (-1);
+	memcpy(*op, lit, lit_len);
+	*op += lit_len;
+
+	if (match_len == 0)
+		return (0);
+
+	if (oend - *op < 2)
+		return (-1);
+	*(*op)++ = offset & 0xff;
+	*(*op)++ = (offset >> 8) & 0xff;
+
+	ml = match_len - LZ4_MIN_MATCH;
+	*token |= (ml >= 15 ? 15 : ml);
+	if (ml >= 15 && lz4_write_len(op, oend, ml - 15) < 0)
+		return (-1);
+
+	return (0);
+}
+
+/*
+ * Compress src into dst as a single LZ4 block.
+ *
+ * Returns the compressed length, or 0 if it didn't fit in dst.
+ */
+size_t
+lz4_compress(const char *src, size_t src_len, char *dst, size_t dst_len)
+{
+	uint32_t table[1 << LZ4_HASH_LOG];
+	const uint8_t *in = (const uint8_t *) src;
+	uint8_t *op = (uint8_t *) dst;
+	const uint8_t *oend = op + dst_len;
+	size_t ip = 0, anchor = 0, ref, len, h;
+	size_t mflimit, matchlimit;
+	uint32_t seq;
+
+	memset(table, 0, sizeof(table));
+
+	mflimit = src_len > LZ4_MF_LIMIT ? src_len - LZ4_MF_LIMIT : 0;
+	matchlimit = src_len > LZ4_LAST_LITERALS ?
+	    src_len - LZ4_LAST_LITERALS : 0;
+
+	while (ip < mflimit) {
+		seq = lz4_read32(in + ip);
+		h = lz4_hash(seq);
+		/* table holds position + 1, 0 is empty */
+		ref = table[h];
+		table[h] = ip + 1;
+
+		if (ref == 0 || ip - (ref - 1) > LZ4_MAX_OFFSET ||
+		    lz4_read32(in + ref - 1) != seq) {
+			ip++;
+			continue;
+		}
+		ref--;
+
+		len = LZ4_MIN_MATCH;
+		while (ip + len < matchlimit && in[ref + len] == in[ip + len])
+			len++;
+
+		if (lz4_emit(&op, oend, in + anchor, ip - anchor, ip - ref,
+		    len) < 0)
+			return (0);
+		ip += len;
+		anchor = ip;
+	}
+
+	/* Trailing literals */
+	if (lz4_emit(&op, oend, in + anchor, src_len - anchor, 0, 0) < 0)
+		return (0);
+
+	return (op - (uint8_t *) dst);
+}
@@ -0,0 +1,7 @@
+#ifndef	__LZ4_COMPRESS_H__
+#define	__LZ4_COMPRESS_H__
+
+extern	size_t lz4_compress(const char *src, size_t src_len, char *dst,
+	    size_t dst_len);
+
+#endif	/* __LZ4_COMPRESS_H__ */
@@ -5,11 +5,24 @@
 #include <fcntl.h>
 #include <err.h>
 #include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 #include <sys/stat.h>
 #include <sys/endian.h>
 
 #include "../../kern/flash/flash_resource_header.h"
+#include "../../kern/libraries/crc32/crc32b.h"
+#include "../../kern/user/user_exec_reloc.h"
+
+#include "lz4_compress.h"
+
+/*
+ * ARMv7-M MPU limits: the smallest region is 32 bytes, and regions
+ * need to be at least 256 bytes to have subregions.
+ */
+#define	MPU_MIN_REGION_SIZE		32
+#define	MPU_MIN_SRD_REGION_SIZE		256
 
 /*
  * Return the next aligned value from the given address + alignment.
@@ -19,7 +32,7 @@ align_uint32(uint32_t val, uint32_t align)
 {
 	uint32_t v;
 
-	v = (val + (align - (val % align)));
+	v = (val + ((align - (val % align)) % align));
 
 	return (v);
 }
@@ -89,7 +102,8 @@ calculate_payload_size(size_t payload_len, size_t alignment)
 
 char *
 populate_header_buf(uint32_t type, const char *label, uint32_t payload_length,
-    uint32_t length, size_t *header_buf_len, uint32_t alignment)
+    uint32_t length, size_t *header_buf_len, uint32_t alignment,
+    uint32_t flags, uint32_t checksum)
 {
 	char *buf, *p;
 	size_t hdr_len;
@@ -106,13 +120,13 @@ populate_header_buf(uint32_t type, const char *label, uint32_t payload_length,
 
 	/* Assemble header */
 	val = htole32(ENTRY_MAGIC); memcpy(p, &val, sizeof(uint32_t)); p += sizeof(uint32_t);
-	val = htole32(0) /* cksum */; memcpy(p, &val, sizeof(uint32_t)); p += sizeof(uint32_t);
+	val = htole32(checksum); memcpy(p, &val, sizeof(uint32_t)); p += sizeof(uint32_t);
 	val = htole32(type); memcpy(p, &val, sizeof(uint32_t)); p += sizeof(uint32_t);
 	val = htole32(length); memcpy(p, &val, sizeof(uint32_t)); p += sizeof(uint32_t);
 	val = htole32(alignment); memcpy(p, &val, sizeof(uint32_t)); p += sizeof(uint32_t);
 	val = htole32(strlen(label)); memcpy(p, &val, sizeof(uint32_t)); p += sizeof(uint32_t);
 	val = htole32(payload_length); memcpy(p, &val, sizeof(uint32_t)); p += sizeof(uint32_t);
-	val = htole32(0) /* rsv0 */; memcpy(p, &val, sizeof(uint32_t)); p += sizeof(uint32_t);
+	val = htole32(flags); memcpy(p, &val, sizeof(uint32_t)); p += sizeof(uint32_t);
 
 	/* Add string, it isn't NUL terminated */
 	memcpy(p, label, strlen(label));
@@ -177,16 +191,371 @@ payload_read(const char *fn, size_t *payload_buf_size, size_t *payload_size,
 	return (ptr);
 }
 
+/*
+ * Calculate the MPU region covering a payload - a power of two
+ * region, with payloads of 256 bytes or more only using as many
+ * eighths (subregions) of it as they need.  This mirrors
+ * platform_mpu_region_size_calc() on the ARMv7-M side.
+ */
+static void
+mpu_region_calc(uint32_t len, uint32_t *size, uint32_t *alignment)
+{
+	uint32_t rs, sub;
+
+	rs = MPU_MIN_REGION_SIZE;
+	while (rs < len && rs < 0x80000000)
+		rs <<= 1;
+
+	*alignment = rs;
+	if (rs < MPU_MIN_SRD_REGION_SIZE) {
+		*size = rs;
+		return;
+	}
+	sub = rs / 8;
+	*size = ((len + sub - 1) / sub) * sub;
+}
+
+struct entry {
+	uint32_t type;
+	const char *label;
+	const char *src;
+	uint32_t flags;
+	int got_tag;
+
+	char *payload;
+	size_t raw_size;
+	size_t payload_size;
+	size_t payload_buf_size;
+	uint32_t alignment;
+
+	/* Layout, filled in by the packing pass */
+	int placed;
+	uint32_t offset;
+	uint32_t length;
+};
+
+#define	MAX_ENTRIES	32
+
+static struct entry entries[MAX_ENTRIES];
+static int num_entries = 0;
+
+static struct entry *
+entry_add(uint32_t type, const char *label, const char *src, uint32_t flags)
+{
+	struct entry *e;
+
+	if (num_entries >= MAX_ENTRIES) {
+		printf("ERROR: too many entries (max %d)\n", MAX_ENTRIES);
+		exit(127);
+	}
+	e = &entries[num_entries++];
+	memset(e, 0, sizeof(*e));
+	e->type = type;
+	e->label = label;
+	e->src = src;
+	e->flags = flags;
+	return (e);
+}
+
+/*
+ * Parse a "type:label:file[:opt[,opt]]" entry description.
+ * Options are "mpu" (MPU aligned XIP payload), "ram" (program is to be
+ * run from a RAM copy), "lz4" (compressed) and "reloc" (user program
+ * whose GOT entries should be pre-classified for the loader.)
+ */
+static void
+entry_parse(const char *arg)
+{
+	struct entry *e;
+	char *str, *typestr, *label, *src, *opts, *opt;
+	uint32_t flags = 0;
+	int got_tag = 0;
+
+	str = strdup(arg);
+	if (str == NULL)
+		err(1, "strdup");
+
+	typestr = strsep(&str, ":");
+	label = strsep(&str, ":");
+	src = strsep(&str, ":");
+	opts = strsep(&str, ":");
+	if (typestr == NULL || label == NULL || src == NULL) {
+		printf("ERROR: entry '%s' should be type:label:file[:opts]\n",
+		    arg);
+		exit(127);
+	}
+	while ((opt = strsep(&opts, ",")) != NULL) {
+		if (strcmp(opt, "mpu") == 0) {
+			flags |= FLASH_RESOURCE_FLAG_MPU_ALIGNED;
+		} else if (strcmp(opt, "ram") == 0) {
+			flags |= FLASH_RESOURCE_FLAG_RUN_FROM_RAM;
+		} else if (strcmp(opt, "lz4") == 0) {
+			flags |= FLASH_RESOURCE_COMP_LZ4 <<
+			    FLASH_RESOURCE_FLAG_COMP_S;
+		} else if (strcmp(opt, "reloc") == 0) {
+			got_tag = 1;
+		} else {
+			printf("ERROR: unknown entry option '%s'\n", opt);
+			exit(127);
+		}
+	}
+	if ((flags & FLASH_RESOURCE_FLAG_MPU_ALIGNED) &&
+	    (flags & FLASH_RESOURCE_FLAG_COMP_M)) {
+		printf("ERROR: entry '%s': compressed payloads can't be "
+		    "MPU aligned XIP\n", arg);
+		exit(127);
+	}
+
+	e = entry_add(strtoul(typestr, NULL, 0), label, src, flags);
+	e->got_tag = got_tag;
+}
+
+/*
+ * Figure out the pak length if the given entry starts at the given
+ * offset.  The header and label go first, then padding so the payload
+ * lands on the entry alignment in flash (ie base + offset), then the
+ * padded payload.
+ */
+static uint32_t
+entry_length_at(const struct entry *e, uint32_t base, uint32_t offset)
+{
+	uint32_t payload_addr;
+
+	payload_addr = align_uint32(base + offset + HEADER_SIZE +
+	    strlen(e->label), e->alignment);
+	return (payload_addr - (base + offset) + e->payload_buf_size);
+}
+
+/*
+ * Lay out the entries.
+ *
+ * MPU aligned entries are placed largest alignment first, as that
+ * keeps the gaps in front of the later (smaller) alignments small.
+ * The gap in front of each aligned payload is filled with as many
+ * of the plain entries as will fit without pushing the aligned
+ * payload onto the next boundary.  Whatever plain entries are left
+ * go on the end.
+ *
+ * Returns the total length.
+ */
+static uint32_t
+entries_pack(uint32_t base)
+{
+	struct entry *m, *e;
+	uint32_t cur = 0, target;
+	int i, j;
+
+	for (;;) {
+		/* Next unplaced MPU entry with the largest alignment */
+		m = NULL;
+		for (i = 0; i < num_entries; i++) {
+			e = &entries[i];
+			if (e->placed ||
+			    (e->flags & FLASH_RESOURCE_FLAG_MPU_ALIGNED) == 0)
+				continue;
+			if (m == NULL || e->alignment > m->alignment)
+				m = e;
+		}
+		if (m == NULL)
+			break;
+
+		/* Where its payload would go from here */
+		target = cur + entry_length_at(m, base, cur) -
+		    m->payload_buf_size;
+
+		/* Fill the gap, largest plain entries first */
+		for (;;) {
+			e = NULL;
+			for (j = 0; j < num_entries; j++) {
+				struct entry *f = &entries[j];
+				uint32_t flen;
+
+				if (f->placed ||
+				    (f->flags & FLASH_RESOURCE_FLAG_MPU_ALIGNED))
+					continue;
+				flen = entry_length_at(f, base, cur);
+				if (cur + flen + entry_length_at(m, base,
+				    cur + flen) - m->payload_buf_size != target)
+					continue;
+				if (e == NULL || f->payload_buf_size >
+				    e->payload_buf_size)
+					e = f;
+			}
+			if (e == NULL)
+				break;
+			e->offset = cur;
+			e->length = entry_length_at(e, base, cur);
+			e->placed = 1;
+			cur += e->length;
+		}
+
+		m->offset = cur;
+		m->length = entry_length_at(m, base, cur);
+		m->placed = 1;
+		cur += m->length;
+	}
+
+	/* And the rest */
+	for (i = 0; i < num_entries; i++) {
+		e = &entries[i];
+		if (e->placed)
+			continue;
+		e->offset = cur;
+		e->length = entry_length_at(e, base, cur);
+		e->placed = 1;
+		cur += e->length;
+	}
+
+	return (cur);
+}
+
+static uint32_t
+payload_word(const char *p, uint32_t idx)
+{
+	uint32_t val;
+
+	memcpy(&val, p + idx * sizeof(uint32_t), sizeof(val));
+	return (le32toh(val));
+}
+
+static void
+payload_word_set(char *p, uint32_t idx, uint32_t val)
+{
+	val = htole32(val);
+	memcpy(p + idx * sizeof(uint32_t), &val, sizeof(val));
+}
+
+/*
+ * Rewrite a user program's GOT entries from image offsets into
+ * (segment, offset in segment) pairs and flag it in the program
+ * header.  The loader then doesn't need to range check every entry
+ * against every segment at spawn time.
+ */
+static void
+entry_got_tag(struct entry *e)
+{
+	uint32_t got_offset, got_size, i, val, seg, flags;
+	uint32_t offset[USER_EXEC_GOT_SEG_NUM], size[USER_EXEC_GOT_SEG_NUM];
+
+	if (e->payload_size < USER_EXEC_HDR_NUM_WORDS * sizeof(uint32_t)) {
+		printf("ERROR: %s: too small for a program header\n",
+		    e->label);
+		exit(1);
+	}
+
+	offset[USER_EXEC_GOT_SEG_TEXT] =
+	    payload_word(e->payload, USER_EXEC_HDR_TEXT_OFFSET);
+	size[USER_EXEC_GOT_SEG_TEXT] =
+	    payload_word(e->payload, USER_EXEC_HDR_TEXT_SIZE);
+	offset[USER_EXEC_GOT_SEG_DATA] =
+	    payload_word(e->payload, USER_EXEC_HDR_DATA_OFFSET);
+	size[USER_EXEC_GOT_SEG_DATA] =
+	    payload_word(e->payload, USER_EXEC_HDR_DATA_SIZE);
+	offset[USER_EXEC_GOT_SEG_BSS] =
+	    payload_word(e->payload, USER_EXEC_HDR_BSS_OFFSET);
+	size[USER_EXEC_GOT_SEG_BSS] =
+	    payload_word(e->payload, USER_EXEC_HDR_BSS_SIZE);
+	offset[USER_EXEC_GOT_SEG_RODATA] =
+	    payload_word(e->payload, USER_EXEC_HDR_RODATA_OFFSET);
+	size[USER_EXEC_GOT_SEG_RODATA] =
+	    payload_word(e->payload, USER_EXEC_HDR_RODATA_SIZE);
+	got_offset = payload_word(e->payload, USER_EXEC_HDR_GOT_OFFSET);
+	got_size = payload_word(e->payload, USER_EXEC_HDR_GOT_SIZE);
+	flags = payload_word(e->payload, USER_EXEC_HDR_FLAGS);
+
+	if (flags & USER_EXEC_HDR_FLAG_GOT_TAGGED) {
+		printf("ERROR: %s: GOT is already tagged\n", e->label);
+		exit(1);
+	}
+	if ((got_offset % sizeof(uint32_t)) != 0 ||
+	    (got_size % sizeof(uint32_t)) != 0 ||
+	    got_offset + got_size > e->payload_size) {
+		printf("ERROR: %s: bad GOT (0x%x, %u bytes)\n", e->label,
+		    got_offset, got_size);
+		exit(1);
+	}
+
+	for (i = 0; i < got_size / sizeof(uint32_t); i++) {
+		val = payload_word(e->payload,
+		    (got_offset / sizeof(uint32_t)) + i);
+		for (seg = 0; seg < USER_EXEC_GOT_SEG_NUM; seg++) {
+			if (val >= offset[seg] &&
+			    val - offset[seg] < size[seg])
+				break;
+		}
+		if (seg == USER_EXEC_GOT_SEG_NUM ||
+		    val - offset[seg] > USER_EXEC_GOT_OFFSET_M) {
+			printf("ERROR: %s: GOT [%u] (0x%x) isn't in a "
+			    "segment\n", e->label, i, val);
+			exit(1);
+		}
+		payload_word_set(e->payload,
+		    (got_offset / sizeof(uint32_t)) + i,
+		    (seg << USER_EXEC_GOT_SEG_S) | (val - offset[seg]));
+	}
+
+	payload_word_set(e->payload, USER_EXEC_HDR_FLAGS,
+	    flags | USER_EXEC_HDR_FLAG_GOT_TAGGED);
+	printf("%s: tagged %u GOT entries\n", e->label,
+	    got_size / (uint32_t) sizeof(uint32_t));
+}
+
+/*
+ * LZ4 compress an entry payload in place.  If it doesn't get any
+ * smaller then it's left raw.
+ */
+static void
+entry_compress(struct entry *e)
+{
+	char *buf;
+	size_t buf_len, len;
+	uint32_t val;
+
+	buf_len = FLASH_RESOURCE_COMP_HDR_SIZE + e->payload_size +
+	    (e->payload_size / 255) + 16;
+	buf = calloc(1, calculate_payload_size(buf_len, PAK_ALIGNMENT));
+	if (buf == NULL)
+		err(1, "calloc");
+
+	len = lz4_compress(e->payload, e->payload_size,
+	    buf + FLASH_RESOURCE_COMP_HDR_SIZE,
+	    buf_len - FLASH_RESOURCE_COMP_HDR_SIZE);
+	if (len == 0 ||
+	    len + FLASH_RESOURCE_COMP_HDR_SIZE >= e->payload_size) {
+		printf("%s: doesn't compress, storing raw\n", e->label);
+		e->flags &= ~FLASH_RESOURCE_FLAG_COMP_M;
+		free(buf);
+		return;
+	}
+
+	val = htole32(e->payload_size);
+	memcpy(buf, &val, sizeof(val));
+
+	free(e->payload);
+	e->payload = buf;
+	e->payload_size = len + FLASH_RESOURCE_COMP_HDR_SIZE;
+	e->payload_buf_size = calculate_payload_size(e->payload_size,
+	    PAK_ALIGNMENT);
+}
+
 void
 usage(const char *progname)
 {
-	printf("%s: [-s source] [-d destination] [-t typeid] [-l label]\n",
+	printf("%s: [-b base] [-m] [-s source] [-d destination] [-t typeid] "
+	    "[-l label] [-e type:label:file[:mpu|ram|lz4|reloc]]\n",
 	     progname);
 	printf("\n");
+	printf("\t-b <base> - flash address the output will be written at\n");
+	printf("\t-m - align/pad the -s payload for the MPU (requires -b)\n");
 	printf("\t-s <source> - source payload file\n");
 	printf("\t-d <destination> - output file\n");
 	printf("\t-t <typeid> - type field (32 bit integer)\n");
 	printf("\t-l <label> - string label for lookup/naming\n");
+	printf("\t-e <type:label:file[:mpu|ram|lz4|reloc]> - add an entry; may be repeated\n");
+	printf("\t   mpu - MPU align/pad the payload (requires -b)\n");
+	printf("\t   ram - program is copied to RAM and run from there\n");
+	printf("\t   lz4 - LZ4 compress the payload\n");
+	printf("\t   reloc - pre-classify a user program's GOT entries\n");
 }
 
 int
@@ -194,18 +563,31 @@ main(int argc, char **argv)
 {
 	const char *dest = NULL, *src = NULL, *label = NULL, *typestr = NULL;
 	const char *argv0;
-	char *payload, *hdr;
-	size_t payload_size, payload_buf_size, hdr_buf_size, size;
+	struct entry *e;
+	char *buf, *hdr;
+	uint32_t crc;
+	size_t hdr_buf_size, size;
+	uint32_t base = 0, padding = 0, payload_addr;
+	size_t raw_total = 0, stored_total = 0;
 	ssize_t ret;
-	uint32_t type;
-	int fd;
-	int ch;
+	int fd, mpu = 0, have_base = 0;
+	int ch, i;
 
 	argv0 = argv[0];
 
 	/* parse command line args */
-	while ((ch = getopt(argc, argv, "s:d:t:l:h")) != -1) {
+	while ((ch = getopt(argc, argv, "b:e:ms:d:t:l:h")) != -1) {
 		switch (ch) {
+		case 'b':
+			base = strtoul(optarg, NULL, 0);
+			have_base = 1;
+			break;
+		case 'e':
+			entry_parse(optarg);
+			break;
+		case 'm':
+			mpu = 1;
+			break;
 		case 's':
 			src = optarg;
 			break;
@@ -227,47 +609,134 @@ main(int argc, char **argv)
 	argc -= optind;
 	argv += optind;
 
-	if (src == NULL) {
-		printf("ERROR: missing -s (source payload)\n");
-		exit(127);
-	}
 	if (dest == NULL) {
 		printf("ERROR: missing -d (destination filename)\n");
 		exit(127);
 	}
-	if (typestr == NULL) {
-		printf("ERROR: missing -t (type integer)\n");
+
+	/* The original single entry form */
+	if (src != NULL || typestr != NULL || label != NULL) {
+		if (src == NULL) {
+			printf("ERROR: missing -s (source payload)\n");
+			exit(127);
+		}
+		if (typestr == NULL) {
+			printf("ERROR: missing -t (type integer)\n");
+			exit(127);
+		}
+		if (label == NULL) {
+			printf("ERROR: missing -l (label)\n");
+			exit(127);
+		}
+		(void) entry_add(strtoul(typestr, NULL, 0), label, src,
+		    mpu ? FLASH_RESOURCE_FLAG_MPU_ALIGNED : 0);
+	}
+
+	if (num_entries == 0) {
+		printf("ERROR: no entries (-s/-t/-l or -e)\n");
 		exit(127);
 	}
-	if (label == NULL) {
-		printf("ERROR: missing -l (label)\n");
+
+	if (base % PAK_ALIGNMENT) {
+		printf("ERROR: base 0x%x isn't %d byte aligned\n", base,
+		    PAK_ALIGNMENT);
 		exit(127);
 	}
 
-	type = strtoul(typestr, NULL, 0);
+	/* read payloads into bufs, buffer sizes are aligned */
+	for (i = 0; i < num_entries; i++) {
+		e = &entries[i];
+
+		if (e->flags & FLASH_RESOURCE_FLAG_MPU_ALIGNED) {
+			uint32_t mpu_size;
+
+			if (have_base == 0) {
+				printf("ERROR: MPU aligned entries need -b\n");
+				exit(127);
+			}
+			e->payload = payload_read(e->src, &e->payload_buf_size,
+			    &e->payload_size, PAK_ALIGNMENT);
+			if (e->payload == NULL)
+				break;
+
+			/* Pad the payload out to the MPU region size */
+			mpu_region_calc(e->payload_size, &mpu_size,
+			    &e->alignment);
+			if (mpu_size > e->payload_buf_size) {
+				e->payload = realloc(e->payload, mpu_size);
+				if (e->payload == NULL)
+					err(1, "realloc");
+				memset(e->payload + e->payload_buf_size, 0,
+				    mpu_size - e->payload_buf_size);
+				e->payload_buf_size = mpu_size;
+			}
+		} else {
+			e->payload = payload_read(e->src, &e->payload_buf_size,
+			    &e->payload_size, PAK_ALIGNMENT);
+			e->alignment = PAK_ALIGNMENT;
+		}
+		if (e->payload == NULL)
+			break;
+
+		if (e->got_tag)
+			entry_got_tag(e);
 
-	/* read payload into a buf, buffer size is aligned */
-	payload = payload_read(src, &payload_buf_size, &payload_size,
-	     PAK_ALIGNMENT);
-	if (payload == NULL) {
+		e->raw_size = e->payload_size;
+		if (e->flags & FLASH_RESOURCE_FLAG_COMP_M)
+			entry_compress(e);
+
+		raw_total += e->raw_size;
+		stored_total += e->payload_size;
+	}
+	if (i != num_entries) {
 		printf("ERROR: didn't manage to read the payload!\n");
 		exit(1);
 	}
 
-	/* calculate total size */
-	size = calculate_buffer_size(payload_size, strlen(label),
-	     PAK_ALIGNMENT);
+	/* calculate the layout and total size */
+	size = entries_pack(base);
 
-	/* populate header contents, buffer size is also aligned */
-	hdr = populate_header_buf(type, label, payload_size, size,
-	    &hdr_buf_size, PAK_ALIGNMENT);
-	if (hdr == NULL) {
-		printf("ERROR: didn't manage to populate the header!\n");
-		exit(1);
+	buf = calloc(1, size);
+	if (buf == NULL) {
+		err(1, "calloc (%zu bytes)", size);
 	}
 
-	printf("hdr len=%jd, payload len=%jd, total len %jd\n",
-	    hdr_buf_size, payload_buf_size, size);
+	for (i = 0; i < num_entries; i++) {
+		e = &entries[i];
+
+		/* CRC-32 of the payload itself, checked at boot */
+		crc = kern_crc32b_sw(e->payload, e->payload_size);
+
+		/* populate header contents, buffer size is also aligned */
+		hdr = populate_header_buf(e->type, e->label, e->payload_size,
+		    e->length, &hdr_buf_size, e->alignment,
+		    e->flags | FLASH_RESOURCE_FLAG_CRC32, crc);
+		if (hdr == NULL) {
+			printf("ERROR: didn't manage to populate the header!\n");
+			exit(1);
+		}
+
+		payload_addr = align_uint32(base + e->offset + HEADER_SIZE +
+		    strlen(e->label), e->alignment);
+
+		memcpy(buf + e->offset, hdr, hdr_buf_size);
+		memcpy(buf + (payload_addr - base), e->payload,
+		    e->payload_buf_size);
+		free(hdr);
+
+		padding += e->length - e->payload_size - HEADER_SIZE -
+		    strlen(e->label);
+
+		printf("%s: offset %u, payload @ 0x%08x (%zu bytes, "
+		    "alignment %u, crc 0x%08x), total len %u\n",
+		    e->label, e->offset, payload_addr, e->payload_size,
+		    e->alignment, crc, e->length);
+	}
+
+	printf("%d entries, total len %zu, %u bytes padding\n",
+	    num_entries, size, padding);
+	printf("payloads: %zu bytes raw, %zu bytes stored (%zd saved)\n",
+	    raw_total, stored_total, (ssize_t) (raw_total - stored_total));
 
 	/* Time to write out our buffer */
 	fd = open(dest, O_WRONLY | O_CREAT | O_TRUNC, 0644);
@@ -276,19 +745,16 @@ main(int argc, char **argv)
 	}
 
 	/* write out our assembled buffer */
-	ret = write(fd, hdr, hdr_buf_size);
-	if (ret != hdr_buf_size) {
-		err(1, "%s: write (size mismatch)", __func__);
-	}
-	ret = write(fd, payload, payload_buf_size);
-	if (ret != payload_buf_size) {
+	ret = write(fd, buf, size);
+	if (ret != size) {
 		err(1, "%s: write (size mismatch)", __func__);
 	}
 
 	/* done! */
 
 	close(fd);
-	free(payload);
-	free(hdr);
+	for (i = 0; i < num_entries; i++)
+		free(entries[i].payload);
+	free(buf);
 	return (0);
 }
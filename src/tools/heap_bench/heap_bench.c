@@ -0,0 +1,432 @@
+/*
+ * Host side test and benchmark for the user heap allocator
+ * (user/lib/tlsf.)
+ *
+ * This runs the same random malloc/free workloads against the TLSF
+ * allocator and a simple first-fit free list allocator over the same
+ * sized pool, checking heap consistency and allocation contents as
+ * it goes, and reports timing, worst case operation cost and how
+ * much of the pool was still usable at the end.
+ *
+ * Usage: heap_bench [-p pool size] [-n operations] [-s seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <err.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "tlsf.h"
+
+#define	BENCH_MAX_LIVE		512
+
+/*
+ * A first-fit allocator: an address ordered free list, with
+ * coalescing on free.  It's what a small embedded heap usually
+ * starts out as.
+ */
+struct ff_block {
+	size_t size;			/* payload size */
+	struct ff_block *next;		/* only valid whilst free */
+};
+
+#define	FF_HDR_SIZE	16
+
+struct ff_heap {
+	struct ff_block *free;
+	uint32_t steps_max;
+};
+
+static void
+ff_init(struct ff_heap *h, void *mem, size_t size)
+{
+	h->free = mem;
+	h->free->size = size - FF_HDR_SIZE;
+	h->free->next = NULL;
+	h->steps_max = 0;
+}
+
+static void *
+ff_malloc(struct ff_heap *h, size_t size)
+{
+	struct ff_block **pp, *b, *rem;
+	uint32_t steps = 0;
+
+	size = (size + 15) & ~(size_t) 15;
+	for (pp = &h->free; *pp != NULL; pp = &(*pp)->next) {
+		steps++;
+		b = *pp;
+		if (b->size < size)
+			continue;
+		if (b->size >= size + FF_HDR_SIZE + 16) {
+			rem = (struct ff_block *) ((char *) b + FF_HDR_SIZE +
+			    size);
+			rem->size = b->size - size - FF_HDR_SIZE;
+			rem->next = b->next;
+			b->size = size;
+			*pp = rem;
+		} else
+			*pp = b->next;
+		if (steps > h->steps_max)
+			h->steps_max = steps;
+		return ((char *) b + FF_HDR_SIZE);
+	}
+	if (steps > h->steps_max)
+		h->steps_max = steps;
+	return (NULL);
+}
+
+static void
+ff_free(struct ff_heap *h, void *ptr)
+{
+	struct ff_block *b, *prev = NULL, *cur;
+	uint32_t steps = 0;
+
+	b = (struct ff_block *) ((char *) ptr - FF_HDR_SIZE);
+	for (cur = h->free; cur != NULL && cur < b; cur = cur->next) {
+		steps++;
+		prev = cur;
+	}
+	if (steps > h->steps_max)
+		h->steps_max = steps;
+
+	b->next = cur;
+	if (cur != NULL &&
+	    (char *) b + FF_HDR_SIZE + b->size == (char *) cur) {
+		b->size += FF_HDR_SIZE + cur->size;
+		b->next = cur->next;
+	}
+	if (prev != NULL &&
+	    (char *) prev + FF_HDR_SIZE + prev->size == (char *) b) {
+		prev->size += FF_HDR_SIZE + b->size;
+		prev->next = b->next;
+	} else if (prev != NULL)
+		prev->next = b;
+	else
+		h->free = b;
+}
+
+static size_t
+ff_largest_free(const struct ff_heap *h)
+{
+	const struct ff_block *b;
+	size_t largest = 0;
+
+	for (b = h->free; b != NULL; b = b->next)
+		if (b->size > largest)
+			largest = b->size;
+	return (largest);
+}
+
+/*
+ * The workload: a table of live allocations, randomly allocating
+ * (mostly small, sometimes large) or freeing a random entry.
+ */
+struct bench_live {
+	void *ptr;
+	size_t size;
+	uint8_t fill;
+};
+
+struct bench_result {
+	double ns;
+	double op_max_ns;
+	uint32_t failures;
+	size_t largest_free;
+};
+
+static size_t
+bench_size(void)
+{
+	uint32_t r = random();
+
+	if ((r & 0xf) == 0)
+		return (256 + (r >> 4) % 4096);
+	return (1 + (r >> 4) % 128);
+}
+
+static uint64_t
+bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+static bool
+bench_verify(const struct bench_live *l)
+{
+	const uint8_t *p = l->ptr;
+	size_t i;
+
+	for (i = 0; i < l->size; i++)
+		if (p[i] != l->fill)
+			return (false);
+	return (true);
+}
+
+/*
+ * Run the workload against either allocator.  The TLSF heap is
+ * consistency checked every check_every operations (0 to skip.)
+ */
+static void
+bench_run(bool use_tlsf, void *pool, size_t pool_size, uint32_t nops,
+    uint32_t seed, uint32_t check_every, struct bench_result *res)
+{
+	static struct bench_live live[BENCH_MAX_LIVE];
+	struct tlsf t;
+	struct tlsf_walk w;
+	struct ff_heap ff;
+	uint64_t op_start, op_ns, total = 0;
+	uint32_t i, j;
+
+	memset(live, 0, sizeof(live));
+	memset(res, 0, sizeof(*res));
+	srandom(seed);
+
+	if (use_tlsf) {
+		tlsf_init(&t);
+		if (tlsf_add_pool(&t, pool, pool_size) == false)
+			errx(1, "tlsf_add_pool failed");
+	} else
+		ff_init(&ff, pool, pool_size);
+
+	for (i = 0; i < nops; i++) {
+		j = random() % BENCH_MAX_LIVE;
+
+		op_start = bench_now_ns();
+		if (live[j].ptr != NULL) {
+			if (use_tlsf)
+				tlsf_free(&t, live[j].ptr);
+			else
+				ff_free(&ff, live[j].ptr);
+			live[j].ptr = NULL;
+			op_ns = bench_now_ns() - op_start;
+		} else {
+			live[j].size = bench_size();
+			if (use_tlsf)
+				live[j].ptr = tlsf_malloc(&t, live[j].size);
+			else
+				live[j].ptr = ff_malloc(&ff, live[j].size);
+			op_ns = bench_now_ns() - op_start;
+			if (live[j].ptr == NULL)
+				res->failures++;
+			else {
+				if (use_tlsf &&
+				    tlsf_block_size(live[j].ptr) <
+				    live[j].size)
+					errx(1, "tlsf: short block");
+				live[j].fill = random();
+				memset(live[j].ptr, live[j].fill,
+				    live[j].size);
+			}
+		}
+		total += op_ns;
+		if (op_ns > res->op_max_ns)
+			res->op_max_ns = op_ns;
+
+		if (live[j].ptr != NULL && bench_verify(&live[j]) == false)
+			errx(1, "%s: allocation %u corrupted",
+			    use_tlsf ? "tlsf" : "first-fit", j);
+
+		if (use_tlsf && check_every != 0 && (i % check_every) == 0 &&
+		    tlsf_check(&t, &w) == false)
+			errx(1, "tlsf: heap inconsistent after %u ops", i);
+	}
+
+	res->ns = (double) total / nops;
+
+	for (j = 0; j < BENCH_MAX_LIVE; j++) {
+		if (live[j].ptr == NULL)
+			continue;
+		if (bench_verify(&live[j]) == false)
+			errx(1, "allocation %u corrupted", j);
+	}
+
+	/* Fragmentation: the largest block left with everything live */
+	if (use_tlsf) {
+		if (tlsf_check(&t, &w) == false)
+			errx(1, "tlsf: heap inconsistent");
+		res->largest_free = w.largest_free;
+	} else
+		res->largest_free = ff_largest_free(&ff);
+
+	for (j = 0; j < BENCH_MAX_LIVE; j++) {
+		if (live[j].ptr == NULL)
+			continue;
+		if (use_tlsf)
+			tlsf_free(&t, live[j].ptr);
+		else
+			ff_free(&ff, live[j].ptr);
+	}
+
+	if (use_tlsf) {
+		/* Everything freed should coalesce back to a block per pool */
+		if (tlsf_check(&t, &w) == false ||
+		    w.free_blocks != (uint32_t) t.num_pools ||
+		    t.stats.used_bytes != 0)
+			errx(1, "tlsf: didn't coalesce back to one block"
+			    " (%u free blocks, %u bytes used)",
+			    w.free_blocks, t.stats.used_bytes);
+		if (check_every == 0)
+			printf("tlsf: %u allocs, %u frees, %u failures, "
+			    "%u bytes used max\n", t.stats.allocs,
+			    t.stats.frees, t.stats.failures,
+			    t.stats.used_max);
+	} else
+		printf("first-fit: longest list walk %u blocks\n",
+		    ff.steps_max);
+}
+
+/*
+ * Directed checks on edge cases the random workload is unlikely
+ * to hit.
+ */
+static void
+test_edges(void *pool, size_t pool_size)
+{
+	struct tlsf t;
+	struct tlsf_walk w;
+	void *a, *b, *c;
+
+	tlsf_init(&t);
+	if (tlsf_add_pool(&t, (char *) pool + 3, 20) == true)
+		errx(1, "edge: tiny pool was accepted");
+	if (tlsf_add_pool(&t, (char *) pool + 3, pool_size - 3) == false)
+		errx(1, "edge: unaligned pool was rejected");
+
+	if (tlsf_malloc(&t, 0) != NULL)
+		errx(1, "edge: malloc(0) succeeded");
+	if (tlsf_malloc(&t, 1U << TLSF_FL_MAX_LOG2) != NULL)
+		errx(1, "edge: oversized malloc succeeded");
+
+	a = tlsf_malloc(&t, 1);
+	b = tlsf_malloc(&t, 100);
+	c = tlsf_malloc(&t, 1000);
+	if (a == NULL || b == NULL || c == NULL)
+		errx(1, "edge: small allocations failed");
+	if (((uintptr_t) a | (uintptr_t) b | (uintptr_t) c) &
+	    (TLSF_ALIGN - 1))
+		errx(1, "edge: misaligned allocation");
+
+	/* Free out of order so both coalescing directions run */
+	tlsf_free(&t, b);
+	tlsf_free(&t, a);
+	tlsf_free(&t, c);
+	tlsf_free(&t, NULL);
+	if (tlsf_check(&t, &w) == false ||
+	    w.free_blocks != (uint32_t) t.num_pools)
+		errx(1, "edge: didn't coalesce");
+
+	printf("edge cases: ok (%d pools over %zu bytes)\n", t.num_pools,
+	    pool_size);
+}
+
+/*
+ * Growing the heap the way wtf_malloc() does: a full heap gets a
+ * new pool of tlsf_pool_size() bytes, which must then satisfy the
+ * request that didn't fit.  The pool is MPU aligned in the real
+ * thing; malloc() alignment is enough here.
+ */
+static void
+test_grow(void)
+{
+	static const size_t sizes[] = {
+		1, 100, 1000, 1023, 1025, 3000, 4000, 5000, 8000, 8193,
+		12000, 20000, 65535, 100000,
+	};
+	struct tlsf t;
+	size_t i, n, psize;
+	char base[64];
+	void *mem, *p;
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		for (n = sizes[i]; n <= sizes[i] + 64; n += 7) {
+			tlsf_init(&t);
+			/* A tiny, full first pool */
+			if (tlsf_add_pool(&t, base, sizeof(base)) == false)
+				errx(1, "grow: base pool rejected");
+			while (tlsf_malloc(&t, 8) != NULL)
+				;
+
+			psize = tlsf_pool_size(n);
+			if (psize == 0)
+				errx(1, "grow: no pool size for %zu", n);
+			mem = malloc(psize);
+			if (mem == NULL)
+				err(1, "malloc");
+			if (tlsf_add_pool(&t, mem, psize) == false)
+				errx(1, "grow: %zu byte pool rejected", psize);
+			p = tlsf_malloc(&t, n);
+			if (p == NULL)
+				errx(1, "grow: %zu bytes didn't fit in a %zu"
+				    " byte pool", n, psize);
+			if (tlsf_block_size(p) < n)
+				errx(1, "grow: short block");
+			free(mem);
+		}
+	}
+
+	if (tlsf_pool_size(0) != 0 ||
+	    tlsf_pool_size(1U << TLSF_FL_MAX_LOG2) != 0)
+		errx(1, "grow: impossible sizes got a pool size");
+
+	printf("heap grow: ok\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct bench_result tr, fr;
+	size_t pool_size = 64 * 1024;
+	uint32_t nops = 1000000, seed = 1;
+	void *pool;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "p:n:s:")) != -1) {
+		switch (ch) {
+		case 'p':
+			pool_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			nops = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			errx(1, "usage: heap_bench [-p pool size] "
+			    "[-n operations] [-s seed]");
+		}
+	}
+	if (nops == 0)
+		errx(1, "need at least one operation");
+
+	pool = malloc(pool_size);
+	if (pool == NULL)
+		err(1, "malloc");
+
+	test_edges(pool, pool_size);
+	test_grow();
+
+	/* A checked run first, then timed runs */
+	bench_run(true, pool, pool_size, nops / 10 + 1, seed, 1, &tr);
+
+	bench_run(true, pool, pool_size, nops, seed, 0, &tr);
+	bench_run(false, pool, pool_size, nops, seed, 0, &fr);
+
+	printf("%-10s %10s %12s %10s %14s\n", "allocator", "ns/op",
+	    "worst ns/op", "failures", "largest free");
+	printf("%-10s %10.1f %12.0f %10u %14zu\n", "tlsf", tr.ns,
+	    tr.op_max_ns, tr.failures, tr.largest_free);
+	printf("%-10s %10.1f %12.0f %10u %14zu\n", "first-fit", fr.ns,
+	    fr.op_max_ns, fr.failures, fr.largest_free);
+
+	free(pool);
+	return (0);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef	__WTF_IMPORT_H__
+#define	__WTF_IMPORT_H__
+
+#include <stdint.h>
+
+/*
+ * Shared library imports for user programs.
+ *
+ * Libraries are XIP paks of their own with an export table of
+ * functions.  A program lists what it imports with WTF_IMPORT();
+ * each one is an entry in the .imports section (which the linker
+ * script places in .data and points the program header at) and a
+ * veneer with the function's name.
+ *
+ * At spawn the loader gives each task its own copy of the library
+ * GOT, data and bss, then fills in the function address and library
+ * GOT for each import.  The veneer switches r9 to the library GOT,
+ * calls the function and switches it back.
+ *
+ * The veneer pushes r9 and lr, so imported functions can only take
+ * arguments in registers (ie up to four words.)
+ *
+ * This layout matches struct user_exec_import in the kernel.
+ */
+struct wtf_import {
+	char lib[16];
+	uint32_t index;
+	uint32_t fn;
+	uint32_t got;
+};
+
+#define	WTF_IMPORT(lib, idx, name)					\
+	struct wtf_import __wtf_import_##name				\
+	    __attribute__((section(".imports"), used)) =		\
+	    { lib, idx, 0, 0 };						\
+	asm(".text\n"							\
+	    ".thumb\n"							\
+	    ".align 2\n"						\
+	    ".global " #name "\n"					\
+	    ".type " #name ", %function\n"				\
+	    ".thumb_func\n"						\
+	    #name ":\n"							\
+	    "	ldr	r12, 1f\n"					\
+	    "	ldr	r12, [r9, r12]\n"				\
+	    "	push	{r9, lr}\n"					\
+	    "	ldr	r9, [r12, #24]\n"				\
+	    "	ldr	r12, [r12, #20]\n"				\
+	    "	blx	r12\n"						\
+	    "	pop	{r9, pc}\n"					\
+	    ".align 2\n"						\
+	    "1:	.word	__wtf_import_" #name "(GOT)\n"			\
+	    ".size " #name ", . - " #name "\n")
+
+#endif	/* __WTF_IMPORT_H__ */
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef	__WTF_INFO_H__
+#define	__WTF_INFO_H__
+
+#include <stdint.h>
+
+#include "wtf_syscall.h"
+
+#include "../../kern/core/info_page_defs.h"
+
+/*
+ * Kernel info page accessors.
+ *
+ * Fetch the page once with wtf_info_page(); after that reading the
+ * time or task id is just loads from it, no syscall.  The time
+ * fields are read under the page's sequence count.
+ */
+
+typedef const volatile struct kern_info_page wtf_info_page_t;
+
+static inline wtf_info_page_t *
+wtf_info_page(void)
+{
+
+	return ((wtf_info_page_t *) (uintptr_t)
+	    WTF_SYSCALL(WTF_SYSCALL_FAST_GET_INFO_PAGE, 0, 0, 0, 0));
+}
+
+/**
+ * The kernel tick in milliseconds; wraps.
+ */
+static inline uint32_t
+wtf_info_tick_msec(wtf_info_page_t *ip)
+{
+	uint32_t seq, val;
+
+	do {
+		seq = ip->seq;
+		val = ip->tick_msec;
+	} while ((seq & 1) != 0 || ip->seq != seq);
+	return (val);
+}
+
+/**
+ * Monotonic milliseconds since boot; doesn't wrap.
+ */
+static inline uint64_t
+wtf_info_uptime_msec(wtf_info_page_t *ip)
+{
+	uint32_t seq, lo, hi;
+
+	do {
+		seq = ip->seq;
+		lo = ip->uptime_msec_lo;
+		hi = ip->uptime_msec_hi;
+	} while ((seq & 1) != 0 || ip->seq != seq);
+	return (((uint64_t) hi << 32) | lo);
+}
+
+static inline uint32_t
+wtf_info_cpu_freq(wtf_info_page_t *ip)
+{
+	uint32_t seq, val;
+
+	do {
+		seq = ip->seq;
+		val = ip->cpu_freq_hz;
+	} while ((seq & 1) != 0 || ip->seq != seq);
+	return (val);
+}
+
+static inline uint32_t
+wtf_info_task_id(wtf_info_page_t *ip)
+{
+
+	return (ip->task_id);
+}
+
+#endif	/* __WTF_INFO_H__ */
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef	__WTF_MSGQ_H__
+#define	__WTF_MSGQ_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "wtf_syscall.h"
+
+/*
+ * Message queues.  Queues are named and global; ids are small
+ * integers and 0 is never valid.
+ */
+
+/* Don't sleep if the queue is full / empty; mirrors KERN_MSGQ_FLAG_* */
+#define	WTF_MSGQ_FLAG_NONBLOCK		0x00000001
+
+/**
+ * struct wtf_msg - a received message.
+ *
+ * This mirrors struct kern_msg (kern/ipc/msgq.h).  If buf is set then
+ * it's a shared memory region now owned by the receiver.
+ */
+struct wtf_msg {
+	uint32_t type;
+	uint32_t arg[3];
+	uint32_t buf;
+	uint32_t buf_len;
+	uint32_t cookie;
+	uint32_t sender;
+	uint32_t timestamp;
+};
+
+static inline uint32_t
+wtf_msgq_strlen(const char *s)
+{
+	uint32_t len = 0;
+
+	while (s[len] != '\0')
+		len++;
+	return (len);
+}
+
+/**
+ * Lookup a message queue by name.
+ *
+ * @retval queue id, or 0 if not found
+ */
+static inline uint32_t
+wtf_msgq_lookup(const char *name)
+{
+
+	return (WTF_SYSCALL(WTF_SYSCALL_MSGQ_LOOKUP, (uintptr_t) name,
+	    wtf_msgq_strlen(name), 0, 0));
+}
+
+/**
+ * Create a named message queue.
+ *
+ * @retval queue id, or 0 on error
+ */
+static inline uint32_t
+wtf_msgq_create(const char *name, uint32_t depth)
+{
+
+	return (WTF_SYSCALL(WTF_SYSCALL_MSGQ_CREATE, (uintptr_t) name,
+	    wtf_msgq_strlen(name), depth, 0));
+}
+
+/**
+ * Send a small message; blocks if the queue is full.
+ *
+ * @retval 0 if sent, or a kernel error
+ */
+static inline uint32_t
+wtf_msgq_send(uint32_t qid, uint32_t type, uint32_t a0, uint32_t a1)
+{
+
+	return (WTF_SYSCALL(WTF_SYSCALL_MSGQ_SEND, qid, type, a0, a1));
+}
+
+/**
+ * Receive a message.
+ *
+ * @param[in] qid queue id
+ * @param[out] msg received message
+ * @param[in] flags WTF_MSGQ_FLAG_*
+ * @param[out] shm_id if not NULL, the region id of any attached buffer
+ * @retval 0 if received, or a kernel error
+ */
+static inline uint32_t
+wtf_msgq_recv(uint32_t qid, struct wtf_msg *msg, uint32_t flags,
+    uint32_t *shm_id)
+{
+	uint64_t ret;
+
+	ret = WTF_SYSCALL64(WTF_SYSCALL_MSGQ_RECV, qid, (uintptr_t) msg,
+	    flags, 0);
+	if (shm_id != NULL)
+		*shm_id = ret >> 32;
+	return ((uint32_t) ret);
+}
+
+#endif	/* __WTF_MSGQ_H__ */
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef	__WTF_MUTEX_H__
+#define	__WTF_MUTEX_H__
+
+#include <stdint.h>
+
+#include "wtf_syscall.h"
+
+/*
+ * A userland mutex built on the futex syscalls.
+ *
+ * The lock word is 0 when unlocked, 1 when locked and 2 when locked
+ * with (possibly) someone sleeping on it.  Taking and dropping an
+ * uncontended lock is an LDREX/STREX pair and no syscall; only a
+ * contended lock goes into the kernel to sleep, and only an unlock
+ * with sleepers goes in to wake one up.
+ *
+ * The word can live in a shared memory region to lock between
+ * tasks.  There's no owner tracking and so no priority inheritance.
+ *
+ * Exception entry and return clear the exclusive monitor, so a
+ * context switch between the LDREX and STREX just makes the STREX
+ * fail and go around again.
+ */
+
+typedef struct {
+	volatile uint32_t val;
+} wtf_mutex_t;
+
+#define	WTF_MUTEX_INITIALIZER		{ 0 }
+
+#define	WTF_MUTEX_UNLOCKED		0
+#define	WTF_MUTEX_LOCKED		1
+#define	WTF_MUTEX_CONTENDED		2
+
+/*
+ * Compare and swap; returns the value that was there.
+ */
+static inline uint32_t
+wtf_atomic_cas(volatile uint32_t *p, uint32_t old, uint32_t new)
+{
+	uint32_t cur, fail;
+
+	do {
+		__asm__ volatile("ldrex %0, [%1]"
+		    : "=r" (cur) : "r" (p) : "memory");
+		if (cur != old) {
+			__asm__ volatile("clrex" ::: "memory");
+			break;
+		}
+		__asm__ volatile("strex %0, %2, [%1]"
+		    : "=&r" (fail) : "r" (p), "r" (new) : "memory");
+	} while (fail != 0);
+	return (cur);
+}
+
+/*
+ * Swap; returns the value that was there.
+ */
+static inline uint32_t
+wtf_atomic_swap(volatile uint32_t *p, uint32_t new)
+{
+	uint32_t cur, fail;
+
+	do {
+		__asm__ volatile("ldrex %0, [%1]"
+		    : "=r" (cur) : "r" (p) : "memory");
+		__asm__ volatile("strex %0, %2, [%1]"
+		    : "=&r" (fail) : "r" (p), "r" (new) : "memory");
+	} while (fail != 0);
+	return (cur);
+}
+
+static inline void
+wtf_mutex_init(wtf_mutex_t *m)
+{
+
+	m->val = WTF_MUTEX_UNLOCKED;
+}
+
+/**
+ * Take the lock if it's free.
+ *
+ * @retval 1 if the lock was taken, 0 otherwise
+ */
+static inline int
+wtf_mutex_trylock(wtf_mutex_t *m)
+{
+
+	if (wtf_atomic_cas(&m->val, WTF_MUTEX_UNLOCKED, WTF_MUTEX_LOCKED) ==
+	    WTF_MUTEX_UNLOCKED) {
+		__asm__ volatile("dmb" ::: "memory");
+		return (1);
+	}
+	return (0);
+}
+
+/**
+ * Take the lock, sleeping in the kernel whilst it's held.
+ */
+static inline void
+wtf_mutex_lock(wtf_mutex_t *m)
+{
+	uint32_t c;
+
+	c = wtf_atomic_cas(&m->val, WTF_MUTEX_UNLOCKED, WTF_MUTEX_LOCKED);
+	if (c != WTF_MUTEX_UNLOCKED) {
+		/*
+		 * Mark it contended so the holder knows to wake us,
+		 * and sleep as long as it stays that way.
+		 */
+		if (c != WTF_MUTEX_CONTENDED)
+			c = wtf_atomic_swap(&m->val, WTF_MUTEX_CONTENDED);
+		while (c != WTF_MUTEX_UNLOCKED) {
+			(void) WTF_SYSCALL(WTF_SYSCALL_FUTEX_WAIT,
+			    (uintptr_t) &m->val, WTF_MUTEX_CONTENDED, 0, 0);
+			c = wtf_atomic_swap(&m->val, WTF_MUTEX_CONTENDED);
+		}
+	}
+	__asm__ volatile("dmb" ::: "memory");
+}
+
+/**
+ * Drop the lock, waking up one sleeper if there are any.
+ */
+static inline void
+wtf_mutex_unlock(wtf_mutex_t *m)
+{
+
+	__asm__ volatile("dmb" ::: "memory");
+	if (wtf_atomic_swap(&m->val, WTF_MUTEX_UNLOCKED) ==
+	    WTF_MUTEX_CONTENDED)
+		(void) WTF_SYSCALL(WTF_SYSCALL_FUTEX_WAKE,
+		    (uintptr_t) &m->val, 1, 0, 0);
+}
+
+#endif	/* __WTF_MUTEX_H__ */
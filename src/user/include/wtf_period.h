@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef	__WTF_PERIOD_H__
+#define	__WTF_PERIOD_H__
+
+#include <stdint.h>
+
+#include "wtf_syscall.h"
+#include "wtf_info.h"
+
+/*
+ * Drift free periodic loops.
+ *
+ *   wtf_period_init(&p, ip, 100);
+ *   while (1) {
+ *       do_work();
+ *       if (wtf_period_wait(&p) != 0)
+ *           ... ran late, periods were skipped ...
+ *   }
+ *
+ * Each deadline is a fixed number of periods from the start, so the
+ * time taken by the loop body and by waking up doesn't add up like
+ * it does with a relative sleep.  A body that runs past a deadline
+ * skips the missed periods rather than running them back to back.
+ *
+ * The current tick is read from the kernel info page, so the only
+ * syscall is the sleep itself.
+ */
+
+struct wtf_period {
+	wtf_info_page_t *ip;
+	uint32_t next;
+	uint32_t period;
+	uint32_t overruns;
+};
+
+/**
+ * Sleep until an absolute kernel tick (see wtf_info_tick_msec()).
+ *
+ * @retval 0 if slept, 1 if the tick had already passed, -1 on error
+ */
+static inline int
+wtf_sleep_until(uint32_t tick_msec)
+{
+
+	return ((int) WTF_SYSCALL(WTF_SYSCALL_SLEEP_UNTIL, tick_msec,
+	    0, 0, 0));
+}
+
+/**
+ * Start a periodic loop; the first deadline is one period from now.
+ *
+ * @param[in] p period state
+ * @param[in] ip info page, from wtf_info_page()
+ * @param[in] period_msec period in milliseconds
+ */
+static inline void
+wtf_period_init(struct wtf_period *p, wtf_info_page_t *ip,
+    uint32_t period_msec)
+{
+
+	if (period_msec == 0)
+		period_msec = 1;
+	p->ip = ip;
+	p->period = period_msec;
+	p->next = wtf_info_tick_msec(ip) + period_msec;
+	p->overruns = 0;
+}
+
+/**
+ * Sleep until the next period starts.
+ *
+ * Arriving exactly on the deadline is on time and doesn't sleep;
+ * only deadlines strictly in the past count as missed.
+ *
+ * @retval number of periods missed since the last call, 0 if on time
+ */
+static inline uint32_t
+wtf_period_wait(struct wtf_period *p)
+{
+	uint32_t now, missed = 0;
+
+	now = wtf_info_tick_msec(p->ip);
+	if ((int32_t) (now - p->next) > 0) {
+		missed = (now - p->next - 1) / p->period + 1;
+		p->next += missed * p->period;
+		p->overruns += missed;
+	}
+
+	if (now != p->next)
+		(void) wtf_sleep_until(p->next);
+	p->next += p->period;
+	return (missed);
+}
+
+#endif	/* __WTF_PERIOD_H__ */
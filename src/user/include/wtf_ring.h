@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef	__WTF_RING_H__
+#define	__WTF_RING_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "wtf_syscall.h"
+
+#include "../../kern/ipc/ring_defs.h"
+
+/*
+ * Async syscall ring accessors.
+ *
+ * Fill in submissions with wtf_ring_get_sqe(), hand them all to the
+ * kernel with wtf_ring_submit(), then walk the completions with
+ * wtf_ring_peek_cqe() / wtf_ring_cqe_seen().  There's one ring per
+ * task and it's only meant to be driven from one thread.
+ *
+ * The ring fields are all accessed through volatile pointers, which
+ * keeps them ordered with respect to each other; the kernel only
+ * runs on this core.
+ */
+
+struct wtf_ring {
+	volatile struct kern_ring_hdr *hdr;
+	volatile struct kern_ring_sqe *sqes;
+	volatile struct kern_ring_cqe *cqes;
+	uint32_t sq_tail;
+};
+
+/**
+ * Set up the task's rings.
+ *
+ * @param[out] ring ring to fill in
+ * @param[in] sq_entries submission entries, a power of two
+ * @param[in] cq_entries completion entries, a power of two
+ * @param[in] flags KERN_RING_SETUP_F_*
+ * @retval 0 on success, -1 on error
+ */
+static inline int
+wtf_ring_setup(struct wtf_ring *ring, uint32_t sq_entries,
+    uint32_t cq_entries, uint32_t flags)
+{
+	uintptr_t addr;
+
+	addr = WTF_SYSCALL(WTF_SYSCALL_RING_SETUP, sq_entries, cq_entries,
+	    flags, 0);
+	if (addr == 0)
+		return (-1);
+
+	ring->hdr = (volatile struct kern_ring_hdr *) addr;
+	ring->sqes = (volatile struct kern_ring_sqe *)
+	    (addr + ring->hdr->sq_off);
+	ring->cqes = (volatile struct kern_ring_cqe *)
+	    (addr + ring->hdr->cq_off);
+	ring->sq_tail = ring->hdr->sq_tail;
+	return (0);
+}
+
+/**
+ * Get the next free submission entry, or NULL if the submission
+ * ring is full.  It isn't visible to the kernel until
+ * wtf_ring_submit() is called.
+ */
+static inline volatile struct kern_ring_sqe *
+wtf_ring_get_sqe(struct wtf_ring *ring)
+{
+	volatile struct kern_ring_sqe *s;
+
+	if (ring->sq_tail - ring->hdr->sq_head >= ring->hdr->sq_entries)
+		return (NULL);
+	s = &ring->sqes[ring->sq_tail & (ring->hdr->sq_entries - 1)];
+	ring->sq_tail++;
+	return (s);
+}
+
+/**
+ * Publish the pending submissions.
+ *
+ * If the kernel is polling the ring and we're not waiting for
+ * anything then there's no syscall; otherwise ring the doorbell and
+ * wait for min_complete completions.
+ *
+ * @retval 0 on success, or a kern_error_t
+ */
+static inline uint32_t
+wtf_ring_submit(struct wtf_ring *ring, uint32_t min_complete)
+{
+
+	ring->hdr->sq_tail = ring->sq_tail;
+	if ((ring->hdr->flags & KERN_RING_SETUP_F_SQ_POLL) &&
+	    min_complete == 0)
+		return (0);
+	return (WTF_SYSCALL(WTF_SYSCALL_RING_ENTER, min_complete, 0, 0, 0));
+}
+
+/**
+ * Get the next completion, or NULL if there isn't one.
+ */
+static inline volatile struct kern_ring_cqe *
+wtf_ring_peek_cqe(struct wtf_ring *ring)
+{
+	uint32_t head = ring->hdr->cq_head;
+
+	if (head == ring->hdr->cq_tail)
+		return (NULL);
+	return (&ring->cqes[head & (ring->hdr->cq_entries - 1)]);
+}
+
+/**
+ * Hand the completion returned by wtf_ring_peek_cqe() back to the
+ * kernel.
+ */
+static inline void
+wtf_ring_cqe_seen(struct wtf_ring *ring)
+{
+
+	ring->hdr->cq_head++;
+}
+
+#endif	/* __WTF_RING_H__ */
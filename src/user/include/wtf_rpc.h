@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef	__WTF_RPC_H__
+#define	__WTF_RPC_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "wtf_syscall.h"
+#include "wtf_msgq.h"
+
+#include "../../kern/rpc/rpc_defs.h"
+
+/*
+ * Userland driver RPC.
+ *
+ * This takes the same METHOD(iface, id, name, nargs, flags) list as
+ * kern/rpc/rpc.h, eg:
+ *
+ * #define	FOO_RPC_METHODS(METHOD)				\
+ *	METHOD(foo, 1, write, 2, KERN_RPC_CALL)			\
+ *	METHOD(foo, 2, poke, 1, KERN_RPC_ONEWAY)
+ *
+ * WTF_RPC_CLIENT(foo, FOO_RPC_METHODS) generates foo_call_write(c, ...)
+ * / foo_call_poke(c, ...) which marshal the call into a message on
+ * the driver's queue and (for KERN_RPC_CALL) wait for the reply on
+ * the client's own reply queue.  Each client (ie each task making
+ * calls) sets up a struct wtf_rpc_client with wtf_rpc_client_init().
+ *
+ * WTF_RPC_SERVER(foo, FOO_RPC_METHODS) generates foo_rpc_serve(qid),
+ * which the driver task calls to service requests forever, calling
+ * the foo_write() / foo_poke() functions the driver implements.
+ *
+ * Requests go entirely in registers (SYSCALL_ID_MSGQ_SEND), which
+ * carries two argument words, so userland methods take at most two
+ * arguments.
+ */
+
+/**
+ * struct wtf_rpc_client - a client's connection to a driver.
+ *
+ * @server_qid the driver's request queue
+ * @reply_qid this client's reply queue
+ */
+struct wtf_rpc_client {
+	uint32_t server_qid;
+	uint32_t reply_qid;
+};
+
+/**
+ * Connect to a driver.
+ *
+ * @param[out] c client state
+ * @param[in] server driver request queue name
+ * @param[in] reply name for this client's reply queue; must be unique
+ * @retval true if connected, false if the driver isn't there or the
+ *   reply queue couldn't be created
+ */
+static inline bool
+wtf_rpc_client_init(struct wtf_rpc_client *c, const char *server,
+    const char *reply)
+{
+
+	c->server_qid = wtf_msgq_lookup(server);
+	if (c->server_qid == 0)
+		return (false);
+	/* Calls are synchronous, so one reply is ever outstanding */
+	c->reply_qid = wtf_msgq_create(reply, 1);
+	return (c->reply_qid != 0);
+}
+
+/*
+ * Send a request and, unless it's oneway, wait for the reply.
+ */
+static inline uint32_t
+wtf_rpc_call(struct wtf_rpc_client *c, uint32_t id, uint32_t flags,
+    uint32_t a0, uint32_t a1)
+{
+	struct wtf_msg m;
+	uint32_t type;
+
+	type = KERN_RPC_MSG_TYPE(id,
+	    (flags & KERN_RPC_ONEWAY) ? 0 : c->reply_qid);
+	if (wtf_msgq_send(c->server_qid, type, a0, a1) != 0)
+		return (KERN_RPC_RET_FAILED);
+	if (flags & KERN_RPC_ONEWAY)
+		return (0);
+
+	if (wtf_msgq_recv(c->reply_qid, &m, 0, NULL) != 0 || m.type != id)
+		return (KERN_RPC_RET_FAILED);
+	return (m.arg[0]);
+}
+
+#define	WTF_RPC_PARAMS_0
+#define	WTF_RPC_PARAMS_1	, uint32_t a0
+#define	WTF_RPC_PARAMS_2	, uint32_t a0, uint32_t a1
+#define	WTF_RPC_PARAMS_3	, uint32_t a0, uint32_t a1, uint32_t a2
+
+#define	WTF_RPC_PACK_0		0, 0
+#define	WTF_RPC_PACK_1		a0, 0
+#define	WTF_RPC_PACK_2		a0, a1
+#define	WTF_RPC_PACK_3		a0, a1
+
+#define	WTF_RPC_GEN_CALL(iface, id, name, nargs, flags)		\
+	static inline uint32_t						\
+	iface##_call_##name(struct wtf_rpc_client *c			\
+	    WTF_RPC_PARAMS_##nargs)					\
+	{								\
+		_Static_assert((nargs) <= 2, #iface "_" #name		\
+		    ": userland RPC methods take at most two arguments");\
+		return (wtf_rpc_call(c, (id), (flags),			\
+		    WTF_RPC_PACK_##nargs));				\
+	}
+
+#define	WTF_RPC_GEN_PROTO(iface, id, name, nargs, flags)		\
+	extern uint32_t iface##_##name(KERN_RPC_PARAMS_##nargs);
+
+#define	WTF_RPC_GEN_DISPATCH(iface, id, name, nargs, flags)		\
+	case (id):							\
+		return (iface##_##name(KERN_RPC_UNPACK_##nargs(msg)));
+
+/* Per-interface generators */
+
+#define	WTF_RPC_CLIENT(iface, METHODS)					\
+	METHODS(WTF_RPC_GEN_CALL)
+
+#define	WTF_RPC_SERVER(iface, METHODS)					\
+	METHODS(WTF_RPC_GEN_PROTO)					\
+	static uint32_t							\
+	iface##_rpc_dispatch(const struct wtf_msg *msg)			\
+	{								\
+		switch (KERN_RPC_MSG_ID(msg->type)) {			\
+		METHODS(WTF_RPC_GEN_DISPATCH)				\
+		default:						\
+			return (KERN_RPC_RET_BADMETHOD);		\
+		}							\
+	}								\
+	static inline void						\
+	iface##_rpc_serve(uint32_t qid)					\
+	{								\
+		struct wtf_msg msg;					\
+		uint32_t ret, reply_qid;				\
+									\
+		while (1) {						\
+			if (wtf_msgq_recv(qid, &msg, 0, NULL) != 0)	\
+				continue;				\
+			ret = iface##_rpc_dispatch(&msg);		\
+			reply_qid = KERN_RPC_MSG_REPLY_QID(msg.type);	\
+			if (reply_qid != 0)				\
+				(void) wtf_msgq_send(reply_qid,		\
+				    KERN_RPC_MSG_ID(msg.type), ret, 0);	\
+		}							\
+	}
+
+#endif	/* __WTF_RPC_H__ */
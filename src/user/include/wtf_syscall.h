@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef	__WTF_SYSCALL_H__
+#define	__WTF_SYSCALL_H__
+
+#include <stdint.h>
+
+/*
+ * Userland syscall stubs.
+ *
+ * The syscall ABI is:
+ *
+ *   svc #<syscall id>
+ *   r0..r3 - four 32 bit arguments
+ *   r0/r1  - 64 bit return value (low/high); most syscalls only
+ *            return 32 bits in r0
+ *
+ * r2, r3, ip and the flags are clobbered; everything else is
+ * preserved.  The id is an 8 bit SVC immediate so it has to be a
+ * compile time constant - these are macros rather than functions
+ * so they're always inlined, whatever the optimisation level.
+ *
+ * The ids mirror kern/syscalls/syscall.h.
+ */
+#define	WTF_SYSCALL_CONSOLE_WRITE	0x01
+#define	WTF_SYSCALL_SLEEP		0x02
+#define	WTF_SYSCALL_TASK_EXIT		0x04
+#define	WTF_SYSCALL_MSGQ_SEND		0x05
+#define	WTF_SYSCALL_MSGQ_RECV		0x06
+#define	WTF_SYSCALL_MSGQ_LOOKUP		0x07
+#define	WTF_SYSCALL_MSGQ_CREATE		0x08
+#define	WTF_SYSCALL_SHM_CREATE		0x09
+#define	WTF_SYSCALL_SHM_GRANT		0x0a
+#define	WTF_SYSCALL_SHM_REVOKE		0x0b
+#define	WTF_SYSCALL_SHM_ADDR		0x0c
+#define	WTF_SYSCALL_TASK_SPAWN		0x0d
+#define	WTF_SYSCALL_HEAP_INFO		0x0e
+#define	WTF_SYSCALL_HEAP_GROW		0x0f
+#define	WTF_SYSCALL_NOP			0x10
+#define	WTF_SYSCALL_RING_SETUP		0x11
+#define	WTF_SYSCALL_RING_ENTER		0x12
+#define	WTF_SYSCALL_FUTEX_WAIT		0x13
+#define	WTF_SYSCALL_FUTEX_WAKE		0x14
+#define	WTF_SYSCALL_WAIT_ANY		0x15
+#define	WTF_SYSCALL_SLEEP_UNTIL		0x16
+#define	WTF_SYSCALL_SHM_DESTROY		0x17
+#define	WTF_SYSCALL_MSGQ_SEND_SHM	0x18
+
+/*
+ * Fast syscalls - these run straight from the SVC exception and
+ * are a lot cheaper, but there's only a handful of them.
+ */
+#define	WTF_SYSCALL_FAST_NOP		0x80
+#define	WTF_SYSCALL_FAST_GET_TIME	0x81
+#define	WTF_SYSCALL_FAST_GET_CYCLES	0x82
+#define	WTF_SYSCALL_FAST_GET_TASK_ID	0x83
+#define	WTF_SYSCALL_FAST_GET_INFO_PAGE	0x84
+
+/**
+ * Make a syscall, returning the full 64 bit return value.
+ */
+#define	WTF_SYSCALL64(id, a1, a2, a3, a4) ({				\
+	register uint32_t __r0 asm("r0") = (uint32_t) (a1);		\
+	register uint32_t __r1 asm("r1") = (uint32_t) (a2);		\
+	register uint32_t __r2 asm("r2") = (uint32_t) (a3);		\
+	register uint32_t __r3 asm("r3") = (uint32_t) (a4);		\
+	asm volatile("svc %[num]"					\
+	    : "+r" (__r0), "+r" (__r1), "+r" (__r2), "+r" (__r3)	\
+	    : [num] "I" (id)						\
+	    : "ip", "cc", "memory");					\
+	((uint64_t) __r1 << 32) | __r0;					\
+})
+
+/**
+ * Make a syscall, returning the low 32 bits of the return value.
+ */
+#define	WTF_SYSCALL(id, a1, a2, a3, a4)					\
+	((uint32_t) WTF_SYSCALL64(id, a1, a2, a3, a4))
+
+#endif	/* __WTF_SYSCALL_H__ */
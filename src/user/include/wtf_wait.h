@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef	__WTF_WAIT_H__
+#define	__WTF_WAIT_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "wtf_syscall.h"
+
+#include "../../kern/ipc/wait_defs.h"
+
+/**
+ * Wait for any of a set of signals, message queues or a deadline.
+ *
+ * The deadline is an absolute tick; eg wtf_info_tick_msec() + 10
+ * for 10ms from now.
+ *
+ * @param[in] args what to wait for
+ * @param[out] sigs if not NULL, the signals that were posted
+ * @retval KERN_WAIT_READY_* bitmap, or 0 on error
+ */
+static inline uint32_t
+wtf_wait_any(const struct kern_wait_args *args, uint32_t *sigs)
+{
+	uint64_t ret;
+
+	ret = WTF_SYSCALL64(WTF_SYSCALL_WAIT_ANY, (uintptr_t) args, 0, 0, 0);
+	if (sigs != NULL)
+		*sigs = ret >> 32;
+	return ((uint32_t) ret);
+}
+
+#endif	/* __WTF_WAIT_H__ */
@@ -0,0 +1,463 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "tlsf.h"
+
+/*
+ * Block layout.  Every block starts with a header (the physical
+ * previous block and this block's payload size + flags); free
+ * blocks keep their free list pointers at the start of the payload.
+ *
+ * Each pool ends with a zero sized, used sentinel block so the last
+ * real block always has a next block to look at.
+ */
+struct tlsf_block {
+	struct tlsf_block *prev_phys;
+	size_t size;
+
+	/* Only valid whilst the block is free */
+	struct tlsf_block *next_free;
+	struct tlsf_block *prev_free;
+};
+
+#define	TLSF_BLOCK_FREE		0x1
+#define	TLSF_BLOCK_PREV_FREE	0x2
+#define	TLSF_BLOCK_SIZE_M	(~((size_t) TLSF_ALIGN - 1))
+
+#define	TLSF_ALIGN_UP(x)	(((x) + (TLSF_ALIGN - 1)) & ~((size_t) TLSF_ALIGN - 1))
+#define	TLSF_ALIGN_DOWN(x)	((x) & ~((size_t) TLSF_ALIGN - 1))
+
+#define	TLSF_HDR_SIZE		TLSF_ALIGN_UP(offsetof(struct tlsf_block, next_free))
+#define	TLSF_MIN_SIZE		TLSF_ALIGN_UP(sizeof(struct tlsf_block) - TLSF_HDR_SIZE)
+#define	TLSF_MAX_SIZE		(((size_t) 1 << TLSF_FL_MAX_LOG2) - TLSF_ALIGN)
+
+static inline size_t
+block_size(const struct tlsf_block *b)
+{
+	return (b->size & TLSF_BLOCK_SIZE_M);
+}
+
+static inline void *
+block_payload(const struct tlsf_block *b)
+{
+	return ((char *) b + TLSF_HDR_SIZE);
+}
+
+static inline struct tlsf_block *
+block_from_payload(const void *ptr)
+{
+	return ((struct tlsf_block *) ((const char *) ptr - TLSF_HDR_SIZE));
+}
+
+static inline struct tlsf_block *
+block_next(const struct tlsf_block *b)
+{
+	return ((struct tlsf_block *) ((char *) block_payload(b) +
+	    block_size(b)));
+}
+
+/* Index of the highest set bit; x must be non-zero */
+static inline int
+tlsf_fls(size_t x)
+{
+	if (sizeof(x) > sizeof(unsigned int))
+		return ((int) (sizeof(unsigned long) * 8) - 1 -
+		    __builtin_clzl((unsigned long) x));
+	return ((int) (sizeof(unsigned int) * 8) - 1 -
+	    __builtin_clz((unsigned int) x));
+}
+
+/* Index of the lowest set bit; x must be non-zero */
+static inline int
+tlsf_ffs(uint32_t x)
+{
+	return (__builtin_ctz(x));
+}
+
+/*
+ * Map a block size to the list it lives on.
+ */
+static inline void
+mapping_insert(size_t size, int *fl, int *sl)
+{
+	int f;
+
+	if (size < TLSF_SMALL_BLOCK) {
+		*fl = 0;
+		*sl = (int) (size / (TLSF_SMALL_BLOCK / TLSF_SL_COUNT));
+		return;
+	}
+	f = tlsf_fls(size);
+	*sl = (int) (size >> (f - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT;
+	*fl = f - (TLSF_FL_SHIFT - 1);
+}
+
+/*
+ * Map a request size to the first list whose blocks are all big
+ * enough, ie round it up to the next second level boundary.
+ */
+static inline void
+mapping_search(size_t size, int *fl, int *sl)
+{
+	if (size >= TLSF_SMALL_BLOCK)
+		size += ((size_t) 1 << (tlsf_fls(size) - TLSF_SL_LOG2)) - 1;
+	mapping_insert(size, fl, sl);
+}
+
+static void
+free_list_remove(struct tlsf *t, struct tlsf_block *b, int fl, int sl)
+{
+	if (b->prev_free != NULL)
+		b->prev_free->next_free = b->next_free;
+	else
+		t->free[fl][sl] = b->next_free;
+	if (b->next_free != NULL)
+		b->next_free->prev_free = b->prev_free;
+
+	if (t->free[fl][sl] == NULL) {
+		t->sl_bitmap[fl] &= ~(1U << sl);
+		if (t->sl_bitmap[fl] == 0)
+			t->fl_bitmap &= ~(1U << fl);
+	}
+}
+
+static void
+free_list_insert(struct tlsf *t, struct tlsf_block *b)
+{
+	int fl, sl;
+
+	mapping_insert(block_size(b), &fl, &sl);
+	b->prev_free = NULL;
+	b->next_free = t->free[fl][sl];
+	if (b->next_free != NULL)
+		b->next_free->prev_free = b;
+	t->free[fl][sl] = b;
+	t->sl_bitmap[fl] |= (1U << sl);
+	t->fl_bitmap |= (1U << fl);
+}
+
+static void
+block_remove(struct tlsf *t, struct tlsf_block *b)
+{
+	int fl, sl;
+
+	mapping_insert(block_size(b), &fl, &sl);
+	free_list_remove(t, b, fl, sl);
+}
+
+/*
+ * Find a free block of at least size bytes and take it off its list.
+ */
+static struct tlsf_block *
+block_find(struct tlsf *t, size_t size)
+{
+	struct tlsf_block *b;
+	uint32_t map;
+	int fl, sl;
+
+	mapping_search(size, &fl, &sl);
+	if (fl >= TLSF_FL_COUNT)
+		return (NULL);
+
+	map = t->sl_bitmap[fl] & (~0U << sl);
+	if (map == 0) {
+		if (fl + 1 >= TLSF_FL_COUNT)
+			return (NULL);
+		map = t->fl_bitmap & (~0U << (fl + 1));
+		if (map == 0)
+			return (NULL);
+		fl = tlsf_ffs(map);
+		map = t->sl_bitmap[fl];
+	}
+	sl = tlsf_ffs(map);
+
+	b = t->free[fl][sl];
+	free_list_remove(t, b, fl, sl);
+	return (b);
+}
+
+static void
+block_mark_used(struct tlsf_block *b)
+{
+	b->size &= ~TLSF_BLOCK_FREE;
+	block_next(b)->size &= ~TLSF_BLOCK_PREV_FREE;
+}
+
+static void
+block_mark_free(struct tlsf_block *b)
+{
+	struct tlsf_block *next;
+
+	b->size |= TLSF_BLOCK_FREE;
+	next = block_next(b);
+	next->size |= TLSF_BLOCK_PREV_FREE;
+	next->prev_phys = b;
+}
+
+/*
+ * Split off anything past size bytes of b as a new free block.
+ */
+static void
+block_trim(struct tlsf *t, struct tlsf_block *b, size_t size)
+{
+	struct tlsf_block *rem;
+	size_t rem_size;
+
+	if (block_size(b) < size + TLSF_HDR_SIZE + TLSF_MIN_SIZE)
+		return;
+
+	rem_size = block_size(b) - size - TLSF_HDR_SIZE;
+	b->size = size | (b->size & ~TLSF_BLOCK_SIZE_M);
+
+	rem = block_next(b);
+	rem->prev_phys = b;
+	rem->size = rem_size;
+	block_mark_free(rem);
+	free_list_insert(t, rem);
+}
+
+static size_t
+adjust_request_size(size_t size)
+{
+	if (size == 0 || size > TLSF_MAX_SIZE)
+		return (0);
+	size = TLSF_ALIGN_UP(size);
+	if (size < TLSF_MIN_SIZE)
+		size = TLSF_MIN_SIZE;
+	return (size);
+}
+
+void
+tlsf_init(struct tlsf *t)
+{
+	int i, j;
+
+	t->fl_bitmap = 0;
+	for (i = 0; i < TLSF_FL_COUNT; i++) {
+		t->sl_bitmap[i] = 0;
+		for (j = 0; j < TLSF_SL_COUNT; j++)
+			t->free[i][j] = NULL;
+	}
+	t->num_pools = 0;
+	for (i = 0; i < TLSF_MAX_POOLS; i++)
+		t->pool[i] = NULL;
+
+	t->stats.pools = 0;
+	t->stats.pool_bytes = 0;
+	t->stats.used_bytes = 0;
+	t->stats.used_max = 0;
+	t->stats.allocs = 0;
+	t->stats.frees = 0;
+	t->stats.failures = 0;
+}
+
+bool
+tlsf_add_pool(struct tlsf *t, void *mem, size_t size)
+{
+	struct tlsf_block *b, *sentinel;
+	uintptr_t start, end;
+	size_t bsize;
+	bool added = false;
+
+	start = TLSF_ALIGN_UP((uintptr_t) mem);
+	end = TLSF_ALIGN_DOWN((uintptr_t) mem + size);
+
+	/*
+	 * Anything bigger than the largest block is added as several
+	 * pools, each with its own sentinel.
+	 */
+	while (end > start &&
+	    end - start >= 2 * TLSF_HDR_SIZE + TLSF_MIN_SIZE &&
+	    t->num_pools < TLSF_MAX_POOLS) {
+		bsize = end - start - 2 * TLSF_HDR_SIZE;
+		if (bsize > TLSF_MAX_SIZE)
+			bsize = TLSF_MAX_SIZE;
+
+		b = (struct tlsf_block *) start;
+		b->prev_phys = NULL;
+		b->size = bsize;
+
+		sentinel = block_next(b);
+		sentinel->prev_phys = b;
+		sentinel->size = 0;
+
+		block_mark_free(b);
+		free_list_insert(t, b);
+
+		t->pool[t->num_pools++] = b;
+		t->stats.pools++;
+		t->stats.pool_bytes += bsize + 2 * TLSF_HDR_SIZE;
+		start += bsize + 2 * TLSF_HDR_SIZE;
+		added = true;
+	}
+
+	return (added);
+}
+
+size_t
+tlsf_pool_size(size_t size)
+{
+	size_t adj, step;
+
+	adj = adjust_request_size(size);
+	if (adj == 0)
+		return (0);
+
+	/* Round up the same way mapping_search() does */
+	if (adj >= TLSF_SMALL_BLOCK) {
+		step = (size_t) 1 << (tlsf_fls(adj) - TLSF_SL_LOG2);
+		adj = (adj + step - 1) & ~(step - 1);
+	}
+	if (adj > TLSF_MAX_SIZE)
+		return (0);
+
+	/* The pool's block header and its sentinel */
+	return (adj + 2 * TLSF_HDR_SIZE);
+}
+
+void *
+tlsf_malloc(struct tlsf *t, size_t size)
+{
+	struct tlsf_block *b;
+	size_t adj;
+
+	adj = adjust_request_size(size);
+	b = (adj != 0) ? block_find(t, adj) : NULL;
+	if (b == NULL) {
+		t->stats.failures++;
+		return (NULL);
+	}
+
+	block_trim(t, b, adj);
+	block_mark_used(b);
+
+	t->stats.allocs++;
+	t->stats.used_bytes += block_size(b) + TLSF_HDR_SIZE;
+	if (t->stats.used_bytes > t->stats.used_max)
+		t->stats.used_max = t->stats.used_bytes;
+
+	return (block_payload(b));
+}
+
+void
+tlsf_free(struct tlsf *t, void *ptr)
+{
+	struct tlsf_block *b, *prev, *next;
+
+	if (ptr == NULL)
+		return;
+
+	b = block_from_payload(ptr);
+	t->stats.frees++;
+	t->stats.used_bytes -= block_size(b) + TLSF_HDR_SIZE;
+
+	/* Coalesce with the previous block */
+	if (b->size & TLSF_BLOCK_PREV_FREE) {
+		prev = b->prev_phys;
+		block_remove(t, prev);
+		prev->size += block_size(b) + TLSF_HDR_SIZE;
+		b = prev;
+	}
+
+	/* .. and the next one */
+	next = block_next(b);
+	if (next->size & TLSF_BLOCK_FREE) {
+		block_remove(t, next);
+		b->size += block_size(next) + TLSF_HDR_SIZE;
+	}
+
+	block_mark_free(b);
+	free_list_insert(t, b);
+}
+
+size_t
+tlsf_block_size(const void *ptr)
+{
+	return (block_size(block_from_payload(ptr)));
+}
+
+/*
+ * Check a free block is on the list it maps to.
+ */
+static bool
+tlsf_check_listed(const struct tlsf *t, const struct tlsf_block *b)
+{
+	const struct tlsf_block *f;
+	int fl, sl;
+
+	mapping_insert(block_size(b), &fl, &sl);
+	if ((t->fl_bitmap & (1U << fl)) == 0 ||
+	    (t->sl_bitmap[fl] & (1U << sl)) == 0)
+		return (false);
+	for (f = t->free[fl][sl]; f != NULL; f = f->next_free) {
+		if (f == b)
+			return (true);
+	}
+	return (false);
+}
+
+bool
+tlsf_check(const struct tlsf *t, struct tlsf_walk *w)
+{
+	const struct tlsf_block *b, *prev;
+	bool prev_free;
+	int i;
+
+	w->blocks = 0;
+	w->free_blocks = 0;
+	w->free_bytes = 0;
+	w->largest_free = 0;
+
+	for (i = 0; i < t->num_pools; i++) {
+		prev = NULL;
+		prev_free = false;
+		for (b = t->pool[i]; block_size(b) != 0; b = block_next(b)) {
+			if (b->prev_phys != prev && prev_free)
+				return (false);
+			if (!! (b->size & TLSF_BLOCK_PREV_FREE) != prev_free)
+				return (false);
+
+			w->blocks++;
+			prev_free = !! (b->size & TLSF_BLOCK_FREE);
+			if (prev_free) {
+				/* Free blocks are always coalesced */
+				if (prev != NULL &&
+				    (prev->size & TLSF_BLOCK_FREE))
+					return (false);
+				if (tlsf_check_listed(t, b) == false)
+					return (false);
+				w->free_blocks++;
+				w->free_bytes += block_size(b);
+				if (block_size(b) > w->largest_free)
+					w->largest_free = block_size(b);
+			}
+			prev = b;
+		}
+		/* Sentinel */
+		if (!! (b->size & TLSF_BLOCK_PREV_FREE) != prev_free ||
+		    (b->size & TLSF_BLOCK_FREE))
+			return (false);
+	}
+
+	return (true);
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef	__TLSF_H__
+#define	__TLSF_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * A TLSF ("two level segregated fit") allocator.
+ *
+ * malloc and free are O(1): free blocks are kept on lists indexed
+ * by a first level (power of two) and second level (linear split of
+ * that power of two) size class, with a bitmap for each level so the
+ * smallest non-empty list that's big enough is found with a couple
+ * of count-leading/trailing-zero instructions.  Worst case internal
+ * fragmentation is bounded by the second level split (1/8th.)
+ *
+ * It doesn't allocate memory itself; it manages pools handed to it
+ * with tlsf_add_pool().  There's no locking.
+ *
+ * This is plain C with no OS dependencies so it's shared between
+ * userland and the host side heap benchmark (tools/heap_bench.)
+ */
+
+#define	TLSF_ALIGN_LOG2		3
+#define	TLSF_ALIGN		(1 << TLSF_ALIGN_LOG2)
+
+/* Second level lists per first level class */
+#define	TLSF_SL_LOG2		3
+#define	TLSF_SL_COUNT		(1 << TLSF_SL_LOG2)
+
+/* Sizes below this are all in first level class 0 */
+#define	TLSF_FL_SHIFT		(TLSF_SL_LOG2 + TLSF_ALIGN_LOG2)
+#define	TLSF_SMALL_BLOCK	(1 << TLSF_FL_SHIFT)
+
+/*
+ * Largest block is just under 1 << TLSF_FL_MAX_LOG2; bigger pools
+ * are split up.  This is sized for the SRAM on the parts we run on
+ * and keeps the control structure small, as it lives in every task.
+ */
+#define	TLSF_FL_MAX_LOG2	17
+#define	TLSF_FL_COUNT		(TLSF_FL_MAX_LOG2 - TLSF_FL_SHIFT + 1)
+
+#define	TLSF_MAX_POOLS		8
+
+struct tlsf_block;
+
+/**
+ * struct tlsf_stats - heap statistics.
+ *
+ * @pools number of pools added
+ * @pool_bytes total bytes handed to tlsf_add_pool()
+ * @used_bytes bytes currently allocated, including block headers
+ * @used_max high watermark of used_bytes
+ * @allocs successful allocations
+ * @frees frees
+ * @failures allocations which failed
+ */
+struct tlsf_stats {
+	uint32_t pools;
+	uint32_t pool_bytes;
+	uint32_t used_bytes;
+	uint32_t used_max;
+	uint32_t allocs;
+	uint32_t frees;
+	uint32_t failures;
+};
+
+struct tlsf {
+	uint32_t fl_bitmap;
+	uint8_t sl_bitmap[TLSF_FL_COUNT];
+	struct tlsf_block *free[TLSF_FL_COUNT][TLSF_SL_COUNT];
+
+	int num_pools;
+	struct tlsf_block *pool[TLSF_MAX_POOLS];
+
+	struct tlsf_stats stats;
+};
+
+/**
+ * struct tlsf_walk - result of walking all the pools.
+ *
+ * @blocks total blocks
+ * @free_blocks free blocks
+ * @free_bytes free payload bytes
+ * @largest_free largest free block payload
+ */
+struct tlsf_walk {
+	uint32_t blocks;
+	uint32_t free_blocks;
+	uint32_t free_bytes;
+	uint32_t largest_free;
+};
+
+extern	void tlsf_init(struct tlsf *t);
+
+/**
+ * Add memory to the heap.
+ *
+ * @retval true if (at least some of) the memory was added
+ * @retval false if it was too small or there are too many pools
+ */
+extern	bool tlsf_add_pool(struct tlsf *t, void *mem, size_t size);
+
+/**
+ * Size of a new (aligned) pool which is guaranteed to satisfy an
+ * allocation of the given size.  Requests are rounded up to the
+ * next second level size class, so this is more than size plus
+ * the block overhead.
+ *
+ * @retval pool size in bytes, or 0 if size can't be allocated
+ */
+extern	size_t tlsf_pool_size(size_t size);
+
+extern	void * tlsf_malloc(struct tlsf *t, size_t size);
+extern	void tlsf_free(struct tlsf *t, void *ptr);
+
+/**
+ * Usable size of an allocation; at least what was asked for.
+ */
+extern	size_t tlsf_block_size(const void *ptr);
+
+/**
+ * Walk every block in every pool, checking the block headers and
+ * free lists are consistent.  This is O(n) and is for debugging
+ * and the benchmark, not the allocation path.
+ *
+ * @retval true if the heap is consistent
+ */
+extern	bool tlsf_check(const struct tlsf *t, struct tlsf_walk *w);
+
+#endif	/* __TLSF_H__ */
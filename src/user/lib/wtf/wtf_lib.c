@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <wtf_syscall.h>
+
+#include "wtf_lib.h"
+
+/*
+ * Library code is built the same way as program code (PIC, GOT in
+ * r9); the import veneer in the calling program sets r9 to this
+ * task's copy of the library GOT before calling in here.
+ */
+
+void
+wtf_console_write(const char *str, uint32_t len)
+{
+	(void) WTF_SYSCALL(WTF_SYSCALL_CONSOLE_WRITE, (uintptr_t) str, len, 0,
+	    0);
+}
+
+void
+wtf_sleep(uint32_t msec)
+{
+	(void) WTF_SYSCALL(WTF_SYSCALL_SLEEP, msec, 0, 0, 0);
+}
+
+uint32_t
+wtf_strlen(const char *str)
+{
+	uint32_t len = 0;
+
+	while (str[len] != '\0')
+		len++;
+	return (len);
+}
+
+void
+wtf_puts(const char *str)
+{
+	wtf_console_write(str, wtf_strlen(str));
+}
+
+/*
+ * The export table.  These are image offsets once linked; the
+ * loader adds the library's address.
+ */
+const void * const wtf_lib_exports[WTF_LIB_NUM_EXPORTS]
+    __attribute__((section(".exports"), used)) = {
+	[WTF_LIB_EXPORT_CONSOLE_WRITE] = wtf_console_write,
+	[WTF_LIB_EXPORT_SLEEP] = wtf_sleep,
+	[WTF_LIB_EXPORT_STRLEN] = wtf_strlen,
+	[WTF_LIB_EXPORT_PUTS] = wtf_puts,
+	[WTF_LIB_EXPORT_MALLOC] = wtf_malloc,
+	[WTF_LIB_EXPORT_FREE] = wtf_free,
+	[WTF_LIB_EXPORT_HEAP_STATS] = wtf_heap_stats,
+};
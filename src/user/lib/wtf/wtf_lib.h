@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef	__WTF_LIB_H__
+#define	__WTF_LIB_H__
+
+#include <stdint.h>
+
+/*
+ * The wtf shared library - console and timer wrappers, and a
+ * per-task heap.
+ *
+ * Programs import these by export index:
+ *
+ *   WTF_IMPORT(WTF_LIB_LABEL, WTF_LIB_EXPORT_CONSOLE_WRITE,
+ *       wtf_console_write);
+ */
+#define	WTF_LIB_LABEL			"LIBWTF.BIN"
+
+#define	WTF_LIB_EXPORT_CONSOLE_WRITE	0
+#define	WTF_LIB_EXPORT_SLEEP		1
+#define	WTF_LIB_EXPORT_STRLEN		2
+#define	WTF_LIB_EXPORT_PUTS		3
+#define	WTF_LIB_EXPORT_MALLOC		4
+#define	WTF_LIB_EXPORT_FREE		5
+#define	WTF_LIB_EXPORT_HEAP_STATS	6
+#define	WTF_LIB_NUM_EXPORTS		7
+
+/**
+ * struct wtf_heap_stats - a snapshot of the calling task's heap.
+ *
+ * @regions number of regions (the initial heap plus each grow)
+ * @size total bytes managed
+ * @used bytes allocated, including allocator overhead
+ * @used_max high watermark of used
+ * @allocs successful allocations
+ * @frees frees
+ * @failures allocations which failed, even after growing
+ */
+struct wtf_heap_stats {
+	uint32_t regions;
+	uint32_t size;
+	uint32_t used;
+	uint32_t used_max;
+	uint32_t allocs;
+	uint32_t frees;
+	uint32_t failures;
+};
+
+extern	void wtf_console_write(const char *str, uint32_t len);
+extern	void wtf_sleep(uint32_t msec);
+extern	uint32_t wtf_strlen(const char *str);
+extern	void wtf_puts(const char *str);
+extern	void * wtf_malloc(uint32_t size);
+extern	void wtf_free(void *ptr);
+extern	void wtf_heap_stats(struct wtf_heap_stats *st);
+
+#endif	/* __WTF_LIB_H__ */
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2022 Adrian Chadd <adrian@freebsd.org>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-Licence-Identifier: GPL-3.0-or-later
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <wtf_syscall.h>
+
+#include "tlsf.h"
+
+#include "wtf_lib.h"
+
+/*
+ * Per-task heap.
+ *
+ * The allocator state lives in the library's bss, which every task
+ * gets its own copy of, so each task has its own heap.  It's set up
+ * on first use from TASK_MEM_ID_USER_HEAP; when that runs out more
+ * RAM is asked for with the HEAP_GROW syscall, which extends the
+ * heap in place and hands back the new space as another pool.
+ *
+ * XXX TODO: there's no locking; tasks are single threaded for now.
+ */
+
+/* Smallest grow, so small allocations don't each need a syscall */
+#define	WTF_HEAP_GROW_MIN	4096
+
+static struct tlsf wtf_heap;
+static bool wtf_heap_ready = false;
+
+static void
+wtf_heap_setup(void)
+{
+	uint32_t region[2];
+
+	tlsf_init(&wtf_heap);
+	wtf_heap_ready = true;
+
+	if (WTF_SYSCALL(WTF_SYSCALL_HEAP_INFO, (uintptr_t) region, 0, 0,
+	    0) != 0)
+		return;
+	if (region[1] != 0)
+		(void) tlsf_add_pool(&wtf_heap, (void *) (uintptr_t) region[0], region[1]);
+}
+
+static bool
+wtf_heap_grow(uint32_t size)
+{
+	uint32_t region[2];
+
+	/* Enough for the request after size class rounding */
+	size = tlsf_pool_size(size);
+	if (size == 0)
+		return (false);
+	if (size < WTF_HEAP_GROW_MIN)
+		size = WTF_HEAP_GROW_MIN;
+
+	if (WTF_SYSCALL(WTF_SYSCALL_HEAP_GROW, size, (uintptr_t) region, 0,
+	    0) != 0)
+		return (false);
+	return (tlsf_add_pool(&wtf_heap, (void *) (uintptr_t) region[0], region[1]));
+}
+
+void *
+wtf_malloc(uint32_t size)
+{
+	void *ptr;
+
+	if (wtf_heap_ready == false)
+		wtf_heap_setup();
+
+	ptr = tlsf_malloc(&wtf_heap, size);
+	if (ptr != NULL || size == 0)
+		return (ptr);
+
+	if (wtf_heap_grow(size) == false)
+		return (NULL);
+
+	/* The first attempt was already counted as a failure */
+	ptr = tlsf_malloc(&wtf_heap, size);
+	if (ptr != NULL)
+		wtf_heap.stats.failures--;
+	return (ptr);
+}
+
+void
+wtf_free(void *ptr)
+{
+	tlsf_free(&wtf_heap, ptr);
+}
+
+void
+wtf_heap_stats(struct wtf_heap_stats *st)
+{
+	if (wtf_heap_ready == false)
+		wtf_heap_setup();
+
+	st->regions = wtf_heap.stats.pools;
+	st->size = wtf_heap.stats.pool_bytes;
+	st->used = wtf_heap.stats.used_bytes;
+	st->used_max = wtf_heap.stats.used_max;
+	st->allocs = wtf_heap.stats.allocs;
+	st->frees = wtf_heap.stats.frees;
+	st->failures = wtf_heap.stats.failures;
+}
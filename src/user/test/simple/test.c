@@ -21,18 +21,15 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-volatile uint32_t count = 0;
+#include <wtf_import.h>
+#include <wtf_syscall.h>
+#include <wtf_period.h>
+#include <wtf_lib.h>
 
-/*
- * I'm not yet sure how I return a value here; it's quite possible
- * I need to commit some more naked inline assembly sins to get everything
- * lined up right.
- */
-static __attribute__((noinline)) void
-syscall_test(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4)
-{
-	asm("svc #0x01");
-}
+/* Console output goes via the shared library */
+WTF_IMPORT(WTF_LIB_LABEL, WTF_LIB_EXPORT_CONSOLE_WRITE, wtf_console_write);
+
+volatile uint32_t count = 0;
 
 /**
  * Until we can do SVC's, all we can really do here is spin!
@@ -43,6 +40,10 @@ _start(void)
 //	uint32_t count = 0;
 	const char *teststr_1 = "test: test string 3!\r\n";
 	const char *teststr_2 = "test: test string 4!\r\n";
+	struct wtf_period period;
+
+	/* Once a second, without drifting by the time the loop takes */
+	wtf_period_init(&period, wtf_info_page(), 1000);
 
 	while (1) {
 #if 0
@@ -50,16 +51,16 @@ _start(void)
 		 * Test invalid syscall; for now just for doing diagnostics, it doesn't
 		 * error out at all.
 		 */
-		syscall_test(0x12345678, 0x13579bdf, 0x2468ace0, 0x39647afb);
+		(void) WTF_SYSCALL(0xff, 0x12345678, 0x13579bdf, 0x2468ace0,
+		    0x39647afb);
 
 #endif
-		/* CONSOLE_WRITE syscall */
-		syscall_test(0x00000001, (uintptr_t) ((count & 1) ? teststr_1 : teststr_2), 22, 0);
-		/* TIMER_SLEEP syscall, 1 sec */
-		syscall_test(0x00000002, 1000, 0, 0);
+		/* CONSOLE_WRITE syscall, via LIBWTF.BIN */
+		wtf_console_write((count & 1) ? teststr_1 : teststr_2, 22);
+		/* SLEEP_UNTIL syscall, to the next 1 sec boundary */
+		(void) wtf_period_wait(&period);
 		count++;
 	}
 
-	/* TASK_EXIT syscall */
-	syscall_test(0x00000004, 0, 0, 0);
+	(void) WTF_SYSCALL(WTF_SYSCALL_TASK_EXIT, 0, 0, 0, 0);
 }